@@ -14,32 +14,69 @@
 #define MAX_BRIDGE_VERSION 11  // Maximum bridge version fully supported
 #define MAX_SLOT_VERSION 3  // Maximum slot version fully supported
 #define MAX_PHYSICS_VERSION 1  // Maximum physics engine version fully supported
+#define POLYPARSER_VERSION "1.1"  // Bump whenever converted output changes, it invalidates the conversion cache
 
 // Standard library
 #include <iostream>
 #include <fstream>
 #include <utility>
 #include <vector>
+#include <array>
+#include <bitset>
 #include <chrono>
 #include <filesystem>
 #include <string>
-#include <codecvt>
+#include <string_view>
+#include <memory_resource>
+#include <memory>
+#include <deque>
+#include <algorithm>
+#include <numeric>
+#include <unordered_map>
+#include <cmath>
+#include <limits>
+#include <cstring>
+#include <charconv>
+#include <iomanip>
 
 // People might have this
 #include <getopt.h>
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/sendfile.h>
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#include <sys/inotify.h>
+#endif
+
+// SIMD
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>  // AVX2 paths are compiled per function and picked at runtime
+#define POLYPARSER_X86_TARGETS
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 // 3rd-party libraries
 #include <nlohmann/json.hpp>
+// Compression codecs are optional, CMake defines these when it finds the libraries
+#ifdef POLYPARSER_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef POLYPARSER_HAVE_ZSTD
+#include <zstd.h>
+#endif
 #include "inc/fifo_map.hpp"  // For ordered JSON
 
-// #include <yaml.h>  TODO - YAML support
-
 #include "inc/base64.h"
 
 // JSON map workaround
 template<class K, class V, class dummy_compare, class A>
 using workaround_fifo_map = nlohmann::fifo_map<K, V, nlohmann::fifo_map_compare<K>, A>;
-using json = nlohmann::basic_json<workaround_fifo_map>;
+// Every number in a layout is a single precision float, so store them as such: nlohmann's Grisu2 then prints the
+// shortest text that round-trips the float (0.1) rather than the widened double (0.10000000149011612).
+using json = nlohmann::basic_json<workaround_fifo_map, std::vector, std::string, bool, std::int64_t, std::uint64_t, float>;
 
 bool silent = false;
 int unusualNumbers = 1;
@@ -158,6 +195,63 @@ enum EntryType {
     ExternalReferenceByString = 0x10
 };
 
+// Arena allocation
+//   Every string and vector in the layout type tree allocates through Arena::Allocator, which captures the memory
+//   resource that is current on the constructing thread. By default that is the global heap, so nothing changes
+//   unless an Arena::Scope is alive: then a whole parse (thousands of GUID strings and small vectors) is carved out
+//   of one monotonic region and released in one shot when the scope ends, without touching malloc in between.
+//   Anything built inside a scope must be destroyed before the scope itself.
+namespace Arena {
+    inline thread_local std::pmr::memory_resource *current = std::pmr::new_delete_resource();
+
+    template<typename T>
+    struct Allocator {
+        using value_type = T;
+        // Moves steal the buffer along with its resource; copies land on whatever resource is current for the copier.
+        using propagate_on_container_move_assignment = std::true_type;
+        using propagate_on_container_swap = std::true_type;
+
+        std::pmr::memory_resource *resource;
+
+        Allocator() noexcept : resource(current) {}
+        template<typename U>
+        Allocator(const Allocator<U> &other) noexcept : resource(other.resource) {}  // NOLINT(google-explicit-constructor)
+
+        T* allocate(std::size_t n) {
+            return static_cast<T*>(this->resource->allocate(n * sizeof(T), alignof(T)));
+        }
+        void deallocate(T* p, std::size_t n) noexcept {
+            this->resource->deallocate(p, n * sizeof(T), alignof(T));
+        }
+        Allocator select_on_container_copy_construction() const {
+            return Allocator();
+        }
+        template<typename U>
+        bool operator==(const Allocator<U> &other) const noexcept {
+            return this->resource == other.resource;
+        }
+    };
+
+    // Routes every type tree allocation made on this thread into one monotonic region while alive.
+    class Scope {
+    public:
+        explicit Scope(std::size_t initialSize = 1 << 16) : region(initialSize), previous(current) {
+            current = &this->region;
+        }
+        ~Scope() {
+            current = this->previous;
+        }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    private:
+        std::pmr::monotonic_buffer_resource region;
+        std::pmr::memory_resource *previous;
+    };
+}
+using ArenaString = std::basic_string<char, std::char_traits<char>, Arena::Allocator<char>>;
+template<typename T>
+using ArenaVector = std::vector<T, Arena::Allocator<T>>;
+
 struct Vec3 {
     float x, y, z;
 };
@@ -174,50 +268,50 @@ struct BridgeJoint {
     Vec3 pos{};
     bool is_anchor{};
     bool is_split{};
-    std::string guid;
+    ArenaString guid;
 };
 struct BridgeEdge {
     BridgeMaterialType material_type{};
-    std::string node_a_guid;
-    std::string node_b_guid;
+    ArenaString node_a_guid;
+    ArenaString node_b_guid;
     SplitJointPart joint_a_part{};
     SplitJointPart joint_b_part{};
-    std::string guid;
+    ArenaString guid;
 };
 struct BridgeSpring {
     float normalized_value{};
-    std::string node_a_guid;
-    std::string node_b_guid;
-    std::string guid;
+    ArenaString node_a_guid;
+    ArenaString node_b_guid;
+    ArenaString guid;
 };
 struct BridgeSplitJoint {
-    std::string guid;
+    ArenaString guid;
     SplitJointState state{};
 };
 struct Piston {
     float normalized_value{};  // Fixed when initialized.
-    std::string node_a_guid;
-    std::string node_b_guid;
-    std::string guid;
+    ArenaString node_a_guid;
+    ArenaString node_b_guid;
+    ArenaString guid;
 };
 struct HydraulicPhase {
     float time_delay{};
-    std::string guid;
+    ArenaString guid;
 };
 struct ZAxisVehicle {
     Vec2 pos{};
-    std::string prefab_name;
-    std::string guid;
+    ArenaString prefab_name;
+    ArenaString guid;
     float time_delay{};
     float speed{};
     Quaternion rot{};
     float rotation_degrees{};
 };
 struct Vehicle {
-    std::string display_name;
+    ArenaString display_name;
     Vec2 pos{};
     Quaternion rot{};
-    std::string prefab_name;
+    ArenaString prefab_name;
     float target_speed{};
     float mass{};
     float braking_force_multiplier{};
@@ -231,8 +325,8 @@ struct Vehicle {
     bool idle_on_downhill{};
     bool flipped{};
     bool ordered_checkpoints{};
-    std::string guid;
-    std::vector<std::string> checkpoint_guids;
+    ArenaString guid;
+    ArenaVector<ArenaString> checkpoint_guids;
 };
 struct VehicleStopTrigger {
     Vec2 pos{};
@@ -240,33 +334,33 @@ struct VehicleStopTrigger {
     float height{};
     float rotation_degrees{};
     bool flipped{};
-    std::string prefab_name;
-    std::string stop_vehicle_guid;
+    ArenaString prefab_name;
+    ArenaString stop_vehicle_guid;
 };
 struct ThemeObject {
     Vec2 pos;
-    std::string prefab_name;
+    ArenaString prefab_name;
     bool unknown_value;
 };
 struct EventUnit {
-    std::string guid;
+    ArenaString guid;
 };
 struct EventStage {
-    std::vector<EventUnit> units;
+    ArenaVector<EventUnit> units;
 };
 struct EventTimeline {
-    std::string checkpoint_guid;
-    std::vector<EventStage> stages;
+    ArenaString checkpoint_guid;
+    ArenaVector<EventStage> stages;
 };
 struct Checkpoint {
     Vec2 pos{};
-    std::string prefab_name;
-    std::string vehicle_guid;
-    std::string vehicle_restart_phase_guid;
+    ArenaString prefab_name;
+    ArenaString vehicle_guid;
+    ArenaString vehicle_restart_phase_guid;
     bool trigger_timeline{};
     bool stop_vehicle{};
     bool reverse_vehicle_on_restart{};
-    std::string guid;
+    ArenaString guid;
 };
 struct Platform {
     Vec2 pos;
@@ -276,14 +370,14 @@ struct Platform {
     bool solid;
 };
 struct HydraulicsControllerPhase {
-    std::string hydraulics_phase_guid;
-    std::vector<std::string> piston_guids;
-    std::vector<BridgeSplitJoint> bridge_split_joints;
+    ArenaString hydraulics_phase_guid;
+    ArenaVector<ArenaString> piston_guids;
+    ArenaVector<BridgeSplitJoint> bridge_split_joints;
     bool disable_new_additions{};
 };
 struct TerrainIsland {
     Vec3 pos{};
-    std::string prefab_name;
+    ArenaString prefab_name;
     float height_added{};
     float right_edge_water_height{};
     TerrainIslandType terrain_island_type{};
@@ -294,7 +388,7 @@ struct TerrainIsland {
 };
 struct Ramp {
     Vec2 pos;
-    std::vector<Vec2> control_points;
+    ArenaVector<Vec2> control_points;
     float height;
     int num_segments;
     SplineType spline_type;
@@ -302,22 +396,22 @@ struct Ramp {
     bool flipped_horizontal;
     bool hide_legs;
     bool flipped_legs;
-    std::vector<Vec2> line_points;
+    ArenaVector<Vec2> line_points;
 };
 struct VehicleRestartPhase {
     float time_delay{};
-    std::string guid;
-    std::string vehicle_guid;
+    ArenaString guid;
+    ArenaString vehicle_guid;
 };
 struct FlyingObject {
     Vec3 pos{};
     Vec3 scale{};
-    std::string prefab_name;
+    ArenaString prefab_name;
 };
 struct Rock {
     Vec3 pos{};
     Vec3 scale{};
-    std::string prefab_name;
+    ArenaString prefab_name;
     bool flipped;
 };
 struct WaterBlock {
@@ -328,12 +422,12 @@ struct WaterBlock {
 };
 struct Bridge {
     int version{};
-    std::vector<BridgeJoint> joints;
-    std::vector<BridgeEdge> edges;
-    std::vector<BridgeSpring> springs;
-    std::vector<Piston> pistons;
-    std::vector<BridgeJoint> anchors;
-    std::vector<HydraulicsControllerPhase> phases;
+    ArenaVector<BridgeJoint> joints;
+    ArenaVector<BridgeEdge> edges;
+    ArenaVector<BridgeSpring> springs;
+    ArenaVector<Piston> pistons;
+    ArenaVector<BridgeJoint> anchors;
+    ArenaVector<HydraulicsControllerPhase> phases;
 };
 struct Budget {
     int cash;
@@ -373,96 +467,187 @@ struct CustomShape {
     float bounciness{};  // v14+, otherwise set to 0.5f
     float pin_motor_strength{};  // v24+, otherwise set to 0f
     float pin_target_velocity{};  // ^ ^ ^
-    std::vector<Vec2> points_local_space;
-    std::vector<Vec3> static_pins;
-    std::vector<std::string> dynamic_anchor_guids;
+    ArenaVector<Vec2> points_local_space;
+    ArenaVector<Vec3> static_pins;
+    ArenaVector<ArenaString> dynamic_anchor_guids;
 };
 struct Workshop {
-    std::string id;
-    std::string leaderboard_id;
-    std::string title;
-    std::string description;
+    ArenaString id;
+    ArenaString leaderboard_id;
+    ArenaString title;
+    ArenaString description;
     bool autoplay{};
-    std::vector<std::string> tags;
+    ArenaVector<ArenaString> tags;
 };
 struct SupportPillar {
     Vec3 pos{};
     Vec3 scale{};
-    std::string prefab_name;
+    ArenaString prefab_name;
 };
 struct Pillar {
     Vec3 pos{};
     float height{};
-    std::string prefab_name;
+    ArenaString prefab_name;
 };
 // PTF support
 struct Mod {
-    std::string name;
-    std::string version;
-    std::string settings;
+    ArenaString name;
+    ArenaString version;
+    ArenaString settings;
 };
 struct ModSaveData {
     char* data;
-    std::string name;
-    std::string version;
+    ArenaString name;
+    ArenaString version;
 };
 struct ModData {
-    std::vector<Mod> mods;
-    std::vector<ModSaveData> mod_save_data;
+    ArenaVector<Mod> mods;
+    ArenaVector<ModSaveData> mod_save_data;
 };
 struct Layout {
     int32_t version{};
-    std::string stubKey;
-    std::vector<BridgeJoint> anchors;
-    std::vector<HydraulicPhase> phases;
+    ArenaString stubKey;
+    ArenaVector<BridgeJoint> anchors;
+    ArenaVector<HydraulicPhase> phases;
     Bridge bridge;
-    std::vector<ZAxisVehicle> zAxisVehicles;
-    std::vector<Vehicle> vehicles;
-    std::vector<VehicleStopTrigger> vehicleStopTriggers;
-    std::vector<ThemeObject> themeObjects_OBSOLETE;
-    std::vector<EventTimeline> eventTimelines;
-    std::vector<Checkpoint> checkpoints;
-    std::vector<Platform> platforms;
-    std::vector<TerrainIsland> terrainStretches;
-    std::vector<Ramp> ramps;
-    std::vector<VehicleRestartPhase> vehicleRestartPhases;
-    std::vector<FlyingObject> flyingObjects;
-    std::vector<Rock> rocks;
-    std::vector<WaterBlock> waterBlocks;
+    ArenaVector<ZAxisVehicle> zAxisVehicles;
+    ArenaVector<Vehicle> vehicles;
+    ArenaVector<VehicleStopTrigger> vehicleStopTriggers;
+    ArenaVector<ThemeObject> themeObjects_OBSOLETE;
+    ArenaVector<EventTimeline> eventTimelines;
+    ArenaVector<Checkpoint> checkpoints;
+    ArenaVector<Platform> platforms;
+    ArenaVector<TerrainIsland> terrainStretches;
+    ArenaVector<Ramp> ramps;
+    ArenaVector<VehicleRestartPhase> vehicleRestartPhases;
+    ArenaVector<FlyingObject> flyingObjects;
+    ArenaVector<Rock> rocks;
+    ArenaVector<WaterBlock> waterBlocks;
     Budget budget{};
     Settings settings{};
-    std::vector<CustomShape> customShapes;
+    ArenaVector<CustomShape> customShapes;
     Workshop workshop{};
-    std::vector<SupportPillar> supportPillars;
-    std::vector<Pillar> pillars;
+    ArenaVector<SupportPillar> supportPillars;
+    ArenaVector<Pillar> pillars;
     bool isModded{};
     ModData modData;
+
+    uint64_t canonicalHash() const;
 };
 // Save slot support
+// The thumbnail is not loaded with the slot, only located: offset and size describe where its bytes sit in the
+// (uncompressed) slot file, so they can be copied straight from there when they are actually needed.
+struct SlotThumbnail {
+    std::string path;
+    uint64_t offset{};
+    uint32_t size{};
+};
 struct SaveSlot {
     int version{};
     int physicsVersion{};
     int slotId{};
-    std::string displayName;
-    std::string fileName;
+    ArenaString displayName;
+    ArenaString fileName;
     int budget{};
     long lastWriteTimeTicks{};
     Bridge bridge;
     bool unlimitedMaterials{};
     bool unlimitedBudget{};
-    char* thumbnail{};
+    SlotThumbnail thumbnail;
 };
+// The name is a view into the deserializer's scratch buffer and is only valid until the next peek.
 struct EntryTypeReturn {
     EntryType type;
-    std::string name;
+    std::string_view name;
+};
+
+// Entry descriptors
+//   Every OdinSerializer entry starts with one BinaryEntryType byte, and everything the slot reader needs to know
+//   about it (what kind of entry it is, whether a name string follows, how wide a fixed-size value is) depends only
+//   on that byte. The table below is built at compile time with one slot per possible byte value, so peeking an entry
+//   is a single indexed load instead of a switch. Bytes outside the enum map to InvalidType.
+struct EntryDescriptor {
+    EntryType type = EntryType::InvalidType;
+    bool named = false;
+    bool peekable = false;     // TypeName and TypeID only ever follow a node start and are read by readTypeEntry
+    uint8_t payloadWidth = 0;  // size of the fixed-width value after the name, 0 for none or variable length
 };
+constexpr EntryDescriptor describe_entry(BinaryEntryType bt) {
+    switch (bt) {
+        case BinaryEntryType::NamedStartOfReferenceNode:
+        case BinaryEntryType::NamedStartOfStructNode:
+            return {EntryType::StartOfNode, true, true, 0};
+        case BinaryEntryType::UnnamedStartOfReferenceNode:
+        case BinaryEntryType::UnnamedStartOfStructNode:
+            return {EntryType::StartOfNode, false, true, 0};
+        case BinaryEntryType::EndOfNode: return {EntryType::EndOfNodeType, false, true, 0};
+        case BinaryEntryType::StartOfArray: return {EntryType::StartOfArrayType, false, true, 8};
+        case BinaryEntryType::EndOfArray: return {EntryType::EndOfArrayType, false, true, 0};
+        case BinaryEntryType::PrimitiveArray: return {EntryType::PrimitiveArrayType, false, true, 0};
+        case BinaryEntryType::NamedInternalReference: return {EntryType::InternalReference, true, true, 4};
+        case BinaryEntryType::UnnamedInternalReference: return {EntryType::InternalReference, false, true, 4};
+        case BinaryEntryType::NamedExternalReferenceByIndex: return {EntryType::ExternalReferenceByIndex, true, true, 4};
+        case BinaryEntryType::UnnamedExternalReferenceByIndex: return {EntryType::ExternalReferenceByIndex, false, true, 4};
+        case BinaryEntryType::NamedExternalReferenceByGuid: return {EntryType::ExternalReferenceByGuid, true, true, 16};
+        case BinaryEntryType::UnnamedExternalReferenceByGuid: return {EntryType::ExternalReferenceByGuid, false, true, 16};
+        case BinaryEntryType::NamedSByte: return {EntryType::Integer, true, true, 1};
+        case BinaryEntryType::UnnamedSByte: return {EntryType::Integer, false, true, 1};
+        case BinaryEntryType::NamedByte: return {EntryType::Integer, true, true, 1};
+        case BinaryEntryType::UnnamedByte: return {EntryType::Integer, false, true, 1};
+        case BinaryEntryType::NamedShort: return {EntryType::Integer, true, true, 2};
+        case BinaryEntryType::UnnamedShort: return {EntryType::Integer, false, true, 2};
+        case BinaryEntryType::NamedUShort: return {EntryType::Integer, true, true, 2};
+        case BinaryEntryType::UnnamedUShort: return {EntryType::Integer, false, true, 2};
+        case BinaryEntryType::NamedInt: return {EntryType::Integer, true, true, 4};
+        case BinaryEntryType::UnnamedInt: return {EntryType::Integer, false, true, 4};
+        case BinaryEntryType::NamedUInt: return {EntryType::Integer, true, true, 4};
+        case BinaryEntryType::UnnamedUInt: return {EntryType::Integer, false, true, 4};
+        case BinaryEntryType::NamedLong: return {EntryType::Integer, true, true, 8};
+        case BinaryEntryType::UnnamedLong: return {EntryType::Integer, false, true, 8};
+        case BinaryEntryType::NamedULong: return {EntryType::Integer, true, true, 8};
+        case BinaryEntryType::UnnamedULong: return {EntryType::Integer, false, true, 8};
+        case BinaryEntryType::NamedFloat: return {EntryType::FloatingPoint, true, true, 4};
+        case BinaryEntryType::UnnamedFloat: return {EntryType::FloatingPoint, false, true, 4};
+        case BinaryEntryType::NamedDouble: return {EntryType::FloatingPoint, true, true, 8};
+        case BinaryEntryType::UnnamedDouble: return {EntryType::FloatingPoint, false, true, 8};
+        case BinaryEntryType::NamedDecimal: return {EntryType::FloatingPoint, true, true, 16};
+        case BinaryEntryType::UnnamedDecimal: return {EntryType::FloatingPoint, false, true, 16};
+        case BinaryEntryType::NamedChar: return {EntryType::String, true, true, 2};
+        case BinaryEntryType::UnnamedChar: return {EntryType::String, false, true, 2};
+        case BinaryEntryType::NamedString: return {EntryType::String, true, true, 0};
+        case BinaryEntryType::UnnamedString: return {EntryType::String, false, true, 0};
+        case BinaryEntryType::NamedGuid: return {EntryType::Guid, true, true, 16};
+        case BinaryEntryType::UnnamedGuid: return {EntryType::Guid, false, true, 16};
+        case BinaryEntryType::NamedBoolean: return {EntryType::Boolean, true, true, 1};
+        case BinaryEntryType::UnnamedBoolean: return {EntryType::Boolean, false, true, 1};
+        case BinaryEntryType::NamedNull: return {EntryType::Null, true, true, 0};
+        case BinaryEntryType::UnnamedNull: return {EntryType::Null, false, true, 0};
+        case BinaryEntryType::TypeName:
+        case BinaryEntryType::TypeID:
+            return {EntryType::InvalidType, false, false, 0};
+        case BinaryEntryType::EndOfStream: return {EntryType::EndOfStreamType, false, true, 0};
+        case BinaryEntryType::NamedExternalReferenceByString: return {EntryType::ExternalReferenceByString, true, true, 0};
+        case BinaryEntryType::UnnamedExternalReferenceByString: return {EntryType::ExternalReferenceByString, false, true, 0};
+        default: return {};
+    }
+}
+constexpr std::array<EntryDescriptor, 256> ENTRY_DESCRIPTORS = [] {
+    std::array<EntryDescriptor, 256> table{};
+    for (int i = 0; i < 256; i++) {
+        table[i] = describe_entry((BinaryEntryType)i);
+    }
+    return table;
+}();
+static_assert(ENTRY_DESCRIPTORS[BinaryEntryType::NamedInt].named && ENTRY_DESCRIPTORS[BinaryEntryType::NamedInt].payloadWidth == 4);
+static_assert(ENTRY_DESCRIPTORS[BinaryEntryType::UnnamedBoolean].type == EntryType::Boolean);
+static_assert(ENTRY_DESCRIPTORS[0xFF].type == EntryType::InvalidType);
 struct TypeEntryReturn {
     std::string typeName;
     std::string assemblyName;
 };
 
 namespace Utils {
-    std::string prettyPrintStubKeyToTheme(const std::string &stubKey) {
+    std::string prettyPrintStubKeyToTheme(std::string_view stubKey) {
         if (stubKey == "PineMountains") {
             return "\x1B[38;5;28mPine Mountains\x1B[0m";  // greenish
         } else if (stubKey == "Volcano") {
@@ -562,12 +747,15 @@ namespace Utils {
         }
     }
 
-    std::string add_commas(int value) {
-        std::stringstream ss;
-        ss << value;
-        std::string s = ss.str();
-        for (int i = (int)s.length() - 3; i > 0; i -= 3) {
-            s = s.insert(i, ",");
+    std::string add_commas(int64_t value) {
+        std::string digits = std::to_string(value);
+        std::size_t sign = digits[0] == '-';
+        std::string s;
+        s.reserve(digits.size() + digits.size() / 3);
+        s.append(digits, 0, sign);
+        for (std::size_t i = sign; i < digits.size(); i++) {
+            if (i > sign && (digits.size() - i) % 3 == 0) s.push_back(',');
+            s.push_back(digits[i]);
         }
         return s;
     }
@@ -580,11 +768,11 @@ namespace Utils {
         return "\x1B[38;5;219m" + std::to_string(value) + "\x1B[0m";
     }
 
-    std::vector<std::string> splitString(const std::string& string, const std::string& delimiter) {
-        std::vector<std::string> result;
+    std::vector<std::string_view> splitString(std::string_view string, std::string_view delimiter) {
+        std::vector<std::string_view> result;
         auto start = 0U;
         auto end = string.find(delimiter);
-        while (end != std::string::npos) {
+        while (end != std::string_view::npos) {
             result.push_back(string.substr(start, end - start));
             start = end + delimiter.length();
             end = string.find(delimiter, start);
@@ -615,187 +803,1155 @@ namespace Utils {
 }
 namespace U = Utils;  // lazy
 
-class Deserializer {
-public:
-    std::string path;
-    std::ifstream file;
-    explicit Deserializer(std::string path) {
-        this->path = std::move(path);
-
-        std::ifstream _file(this->path, std::ios::binary);
-        if (!_file.is_open()) {
-            Utils::log_error_d("Failed to open file: " + this->path);
-            exit(1);
-        }
-        this->file = std::move(_file);
+// GUID text <-> binary
+//   The file formats store GUIDs as 36 characters of text, and so does the type tree. Where GUIDs are used as keys,
+//   GuidCodec packs them into 16 bytes (in the order the digits appear in the text), a whole list at a time with
+//   parseAll; the serializers format them back to write every GUID in the same lowercase form.
+//   The 32 hex digits are validated and converted 16 (SSE2) or 32 (AVX2, picked at runtime) at a time, with a scalar
+//   fallback for other targets.
+struct BinaryGuid {
+    uint8_t bytes[16]{};
+    bool operator==(const BinaryGuid &other) const {
+        return std::memcmp(this->bytes, other.bytes, 16) == 0;
     }
-    ~Deserializer() {
-        this->file.close();
+};
+struct BinaryGuidHash {
+    std::size_t operator()(const BinaryGuid &guid) const {
+        uint64_t lo, hi;
+        std::memcpy(&lo, guid.bytes, 8);
+        std::memcpy(&hi, guid.bytes + 8, 8);
+        uint64_t h = (lo ^ (hi * 0x9E3779B97F4A7C15ULL)) * 0xBF58476D1CE4E5B9ULL;
+        return (std::size_t)(h ^ (h >> 31));
     }
-    Layout deserializeLayout() {
-        Layout layout;
-        // NOTE: This has to be ordered, as it reads the file in the order it is written
-
-        // first, we get the version, which is used to determine which fields are present
-        this->getVersion(layout.version, layout.isModded);
-
-        if (layout.isModded) {
-            Utils::log_info_d("Using modded layout support");
-        }
+};
+namespace GuidCodec {
+    constexpr std::size_t TEXT_LENGTH = 36;
+
+    // Copies the 32 hex digits out from between the dashes; false if the dashes aren't where they should be.
+    inline bool gatherDigits(const char *text, char *digits) {
+        if (text[8] != '-' || text[13] != '-' || text[18] != '-' || text[23] != '-') return false;
+        std::memcpy(digits, text, 8);
+        std::memcpy(digits + 8, text + 9, 4);
+        std::memcpy(digits + 12, text + 14, 4);
+        std::memcpy(digits + 16, text + 19, 4);
+        std::memcpy(digits + 20, text + 24, 12);
+        return true;
+    }
+    inline void scatterDigits(const char *digits, char *text) {
+        std::memcpy(text, digits, 8);
+        text[8] = '-';
+        std::memcpy(text + 9, digits + 8, 4);
+        text[13] = '-';
+        std::memcpy(text + 14, digits + 12, 4);
+        text[18] = '-';
+        std::memcpy(text + 19, digits + 16, 4);
+        text[23] = '-';
+        std::memcpy(text + 24, digits + 20, 12);
+    }
+
+    inline int hexValue(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+    inline bool parseDigitsScalar(const char *digits, uint8_t *out) {
+        for (int i = 0; i < 16; i++) {
+            int hi = hexValue(digits[i * 2]);
+            int lo = hexValue(digits[i * 2 + 1]);
+            if ((hi | lo) < 0) return false;
+            out[i] = (uint8_t)(hi << 4 | lo);
+        }
+        return true;
+    }
+    inline void formatDigitsScalar(const uint8_t *bytes, char *digits) {
+        static const char hex[] = "0123456789abcdef";
+        for (int i = 0; i < 16; i++) {
+            digits[i * 2] = hex[bytes[i] >> 4];
+            digits[i * 2 + 1] = hex[bytes[i] & 0xF];
+        }
+    }
+
+#ifdef __SSE2__
+    // ASCII hex -> nibble values. Bytes >= 0x80 compare as negative, so they fail both range checks.
+    inline __m128i hexNibblesSSE2(__m128i c, int &validMask) {
+        __m128i isDigit = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(c, _mm_set1_epi8('9' + 1)));
+        __m128i lower = _mm_or_si128(c, _mm_set1_epi8(0x20));
+        __m128i isAlpha = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)), _mm_cmplt_epi8(lower, _mm_set1_epi8('f' + 1)));
+        validMask = _mm_movemask_epi8(_mm_or_si128(isDigit, isAlpha));
+        return _mm_or_si128(_mm_and_si128(isDigit, _mm_sub_epi8(c, _mm_set1_epi8('0'))),
+                            _mm_and_si128(isAlpha, _mm_sub_epi8(lower, _mm_set1_epi8('a' - 10))));
+    }
+    // Each 16-bit lane holds (high digit, low digit); fold it into the low byte as high << 4 | low.
+    inline __m128i foldNibblePairsSSE2(__m128i n) {
+        return _mm_and_si128(_mm_or_si128(_mm_slli_epi16(n, 4), _mm_srli_epi16(n, 8)), _mm_set1_epi16(0x00FF));
+    }
+    inline bool parseDigitsSSE2(const char *digits, uint8_t *out) {
+        int valid0, valid1;
+        __m128i n0 = hexNibblesSSE2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(digits)), valid0);
+        __m128i n1 = hexNibblesSSE2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(digits + 16)), valid1);
+        if ((valid0 & valid1) != 0xFFFF) return false;
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_packus_epi16(foldNibblePairsSSE2(n0), foldNibblePairsSSE2(n1)));
+        return true;
+    }
+    inline __m128i nibblesToHexSSE2(__m128i n) {
+        __m128i ascii = _mm_add_epi8(n, _mm_set1_epi8('0'));
+        return _mm_add_epi8(ascii, _mm_and_si128(_mm_cmpgt_epi8(n, _mm_set1_epi8(9)), _mm_set1_epi8('a' - '0' - 10)));
+    }
+    inline void formatDigitsSSE2(const uint8_t *bytes, char *digits) {
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes));
+        __m128i hi = _mm_and_si128(_mm_srli_epi16(b, 4), _mm_set1_epi8(0x0F));
+        __m128i lo = _mm_and_si128(b, _mm_set1_epi8(0x0F));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(digits), nibblesToHexSSE2(_mm_unpacklo_epi8(hi, lo)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(digits + 16), nibblesToHexSSE2(_mm_unpackhi_epi8(hi, lo)));
+    }
+#endif
+
+#ifdef POLYPARSER_X86_TARGETS
+    __attribute__((target("avx2"))) inline bool parseDigitsAVX2(const char *digits, uint8_t *out) {
+        __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(digits));
+        __m256i isDigit = _mm256_and_si256(_mm256_cmpgt_epi8(c, _mm256_set1_epi8('0' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), c));
+        __m256i lower = _mm256_or_si256(c, _mm256_set1_epi8(0x20));
+        __m256i isAlpha = _mm256_and_si256(_mm256_cmpgt_epi8(lower, _mm256_set1_epi8('a' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('f' + 1), lower));
+        if (_mm256_movemask_epi8(_mm256_or_si256(isDigit, isAlpha)) != -1) return false;
+        __m256i n = _mm256_or_si256(_mm256_and_si256(isDigit, _mm256_sub_epi8(c, _mm256_set1_epi8('0'))),
+                                    _mm256_and_si256(isAlpha, _mm256_sub_epi8(lower, _mm256_set1_epi8('a' - 10))));
+        __m256i folded = _mm256_and_si256(_mm256_or_si256(_mm256_slli_epi16(n, 4), _mm256_srli_epi16(n, 8)), _mm256_set1_epi16(0x00FF));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_packus_epi16(_mm256_castsi256_si128(folded), _mm256_extracti128_si256(folded, 1)));
+        return true;
+    }
+    inline bool hasAVX2() {
+        static const bool supported = __builtin_cpu_supports("avx2");
+        return supported;
+    }
+#endif
+
+    inline bool parseDigits(const char *digits, uint8_t *out) {
+#ifdef POLYPARSER_X86_TARGETS
+        if (hasAVX2()) return parseDigitsAVX2(digits, out);
+#endif
+#ifdef __SSE2__
+        return parseDigitsSSE2(digits, out);
+#else
+        return parseDigitsScalar(digits, out);
+#endif
+    }
+    inline void formatDigits(const uint8_t *bytes, char *digits) {
+#ifdef __SSE2__
+        formatDigitsSSE2(bytes, digits);
+#else
+        formatDigitsScalar(bytes, digits);
+#endif
+    }
+
+    // Accepts either case; false (leaving out untouched) unless text is exactly 8-4-4-4-12 hex digits.
+    inline bool parse(std::string_view text, BinaryGuid &out) {
+        char digits[32];
+        if (text.size() != TEXT_LENGTH || !gatherDigits(text.data(), digits)) return false;
+        uint8_t bytes[16];
+        if (!parseDigits(digits, bytes)) return false;
+        std::memcpy(out.bytes, bytes, 16);
+        return true;
+    }
+    inline bool isValid(std::string_view text) {
+        BinaryGuid guid;
+        return parse(text, guid);
+    }
+    // Writes exactly TEXT_LENGTH lowercase characters, no terminator.
+    inline void format(const BinaryGuid &guid, char *text) {
+        char digits[32];
+        formatDigits(guid.bytes, digits);
+        scatterDigits(digits, text);
+    }
+    inline ArenaString toString(const BinaryGuid &guid) {
+        ArenaString text(TEXT_LENGTH, '\0');
+        format(guid, text.data());
+        return text;
+    }
+    // A well-formed GUID in the lowercase form .NET writes, formatted into buffer; anything else comes back as is.
+    inline std::string_view canonical(std::string_view text, char (&buffer)[TEXT_LENGTH]) {
+        BinaryGuid guid;
+        if (!parse(text, guid)) return text;
+        format(guid, buffer);
+        return {buffer, TEXT_LENGTH};
+    }
+
+    // Parses every string in texts into out (which must hold texts.size() entries), flagging each in valid.
+    // Returns how many were malformed. The AVX2 check is hoisted out of the loop.
+    template<typename Strings>
+    std::size_t parseAll(const Strings &texts, BinaryGuid *out, bool *valid) {
+        std::size_t invalid = 0;
+        auto run = [&](auto parseFn) {
+            std::size_t i = 0;
+            for (const auto &text : texts) {
+                char digits[32];
+                valid[i] = text.size() == TEXT_LENGTH && gatherDigits(text.data(), digits) && parseFn(digits, out[i].bytes);
+                invalid += !valid[i];
+                i++;
+            }
+        };
+#ifdef POLYPARSER_X86_TARGETS
+        if (hasAVX2()) {
+            run(parseDigitsAVX2);
+            return invalid;
+        }
+#endif
+#ifdef __SSE2__
+        run(parseDigitsSSE2);
+#else
+        run(parseDigitsScalar);
+#endif
+        return invalid;
+    }
+}
 
-        Utils::ensureReasonable(layout.version, 0, 100, 0, 50);
-        Utils::log_info_d("Deserializing layout version %s", U::intc(layout.version).c_str());
-        if (layout.version > MAX_VERSION) {
-            Utils::log_warn_d("Layout saved with a newer version of the layout format. This may cause problems.");
+// UTF-16 -> UTF-8
+//   Odin writes any string that isn't pure ASCII as little-endian UTF-16. In practice slot names and type names are
+//   still almost entirely ASCII, so the transcoder checks a whole vector of code units at a time and, when none of
+//   them is above 0x7F, narrows them with a single pack. Only blocks containing other characters fall back to the
+//   scalar encoder. Unpaired surrogates become U+FFFD instead of aborting the read.
+namespace Utf16 {
+    // Worst case output size for a given number of code units (every unit a 3-byte BMP character).
+    constexpr std::size_t maxUtf8Length(std::size_t units) {
+        return units * 3;
+    }
+
+    inline uint16_t loadUnit(const char *src, std::size_t i) {
+        return (uint16_t)((unsigned char)src[i * 2] | (unsigned char)src[i * 2 + 1] << 8);
+    }
+    // Encodes the character starting at unit i and returns how many units it used.
+    inline std::size_t encodeScalar(const char *src, std::size_t i, std::size_t units, char *&out) {
+        uint32_t cp = loadUnit(src, i);
+        std::size_t used = 1;
+        if (cp >= 0xD800 && cp <= 0xDFFF) {
+            uint32_t low = i + 1 < units ? loadUnit(src, i + 1) : 0;
+            if (cp <= 0xDBFF && low >= 0xDC00 && low <= 0xDFFF) {
+                cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                used = 2;
+            } else {
+                cp = 0xFFFD;
+            }
         }
-        // then we get the stub key, which is the theme of the layout, e.g. "Western"
-        layout.stubKey = this->getStubKey();
-        Utils::log_info_d("Layout stub key: %s", layout.stubKey.c_str());
-        // then we get the name of the layout, e.g. "Western"
-        // this is just used for aesthetics
-        Utils::log_info_d("Layout theme name: %s", Utils::prettyPrintStubKeyToTheme(layout.stubKey).c_str());
-
-        if (layout.version >= 19) {
-            // if the version is 19 or higher, we need to deserialize the anchors
-            layout.anchors = this->deserializeAnchors();
+        if (cp < 0x80) {
+            *out++ = (char)cp;
+        } else if (cp < 0x800) {
+            *out++ = (char)(0xC0 | cp >> 6);
+            *out++ = (char)(0x80 | (cp & 0x3F));
+        } else if (cp < 0x10000) {
+            *out++ = (char)(0xE0 | cp >> 12);
+            *out++ = (char)(0x80 | (cp >> 6 & 0x3F));
+            *out++ = (char)(0x80 | (cp & 0x3F));
+        } else {
+            *out++ = (char)(0xF0 | cp >> 18);
+            *out++ = (char)(0x80 | (cp >> 12 & 0x3F));
+            *out++ = (char)(0x80 | (cp >> 6 & 0x3F));
+            *out++ = (char)(0x80 | (cp & 0x3F));
+        }
+        return used;
+    }
+
+    // Each transcode* function converts `units` little-endian code units from src into dst, which must have room for
+    // maxUtf8Length(units) bytes, and returns the number of bytes written.
+    inline std::size_t transcodeScalar(const char *src, std::size_t units, char *dst) {
+        char *out = dst;
+        for (std::size_t i = 0; i < units;) {
+            i += encodeScalar(src, i, units, out);
+        }
+        return out - dst;
+    }
+
+#ifdef __SSE2__
+    inline std::size_t transcodeSSE2(const char *src, std::size_t units, char *dst) {
+        char *out = dst;
+        const __m128i nonAscii = _mm_set1_epi16((short)0xFF80);
+        std::size_t i = 0;
+        while (i < units) {
+            if (i + 8 <= units) {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 2));
+                if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(v, nonAscii), _mm_setzero_si128())) == 0xFFFF) {
+                    _mm_storel_epi64(reinterpret_cast<__m128i*>(out), _mm_packus_epi16(v, v));
+                    out += 8;
+                    i += 8;
+                    continue;
+                }
+                // encode the rest of this block one character at a time, then try the fast path again
+                std::size_t end = i + 8;
+                while (i < end) i += encodeScalar(src, i, units, out);
+                continue;
+            }
+            i += encodeScalar(src, i, units, out);
+        }
+        return out - dst;
+    }
+#endif
+
+#ifdef POLYPARSER_X86_TARGETS
+    __attribute__((target("avx2"))) inline std::size_t transcodeAVX2(const char *src, std::size_t units, char *dst) {
+        char *out = dst;
+        const __m256i nonAscii = _mm256_set1_epi16((short)0xFF80);
+        std::size_t i = 0;
+        while (i < units) {
+            if (i + 16 <= units) {
+                __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i * 2));
+                if (_mm256_testz_si256(v, nonAscii)) {
+                    __m128i packed = _mm_packus_epi16(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), packed);
+                    out += 16;
+                    i += 16;
+                    continue;
+                }
+                std::size_t end = i + 16;
+                while (i < end) i += encodeScalar(src, i, units, out);
+                continue;
+            }
+            i += encodeScalar(src, i, units, out);
         }
+        return out - dst;
+    }
+#endif
 
-        if (layout.version >= 5) {
-            // if the version is 5 or higher, we need to deserialize the hydraulic phases
-            layout.phases = this->deserializePhases();
-        }
+    inline std::size_t transcode(const char *src, std::size_t units, char *dst) {
+#ifdef POLYPARSER_X86_TARGETS
+        if (GuidCodec::hasAVX2()) return transcodeAVX2(src, units, dst);
+#endif
+#ifdef __SSE2__
+        return transcodeSSE2(src, units, dst);
+#else
+        return transcodeScalar(src, units, dst);
+#endif
+    }
+}
 
-        // if the version is greater than 4, we can call the deserializeBridge function.
-        if (layout.version > 4) {
-            layout.bridge = this->deserializeBridge();
-        } else {
-            Utils::log_warn_d("Deserializing bridge with version under 5, consider upgrading");
-            // otherwise, we have a lot less bridge data to deal with.
-            // first, we deserialize the joints.
-            int count = this->readInt32();
-            Utils::log_info_d("Bridge joint count: %s", U::intc(count).c_str());
-            for (int i = 0; i < count; i++) {
-                layout.bridge.joints.push_back(this->deserializeJoint());
+// Hashing
+//   XXH64, fed incrementally so files can be hashed while they are read. Not cryptographic, but with the input size
+//   alongside it is plenty to tell layouts apart.
+namespace Hash {
+    class Xxh64 {
+    public:
+        explicit Xxh64(uint64_t seed = 0) : seed(seed) {
+            this->acc[0] = seed + P1 + P2;
+            this->acc[1] = seed + P2;
+            this->acc[2] = seed;
+            this->acc[3] = seed - P1;
+        }
+        void update(const void *data, std::size_t size) {
+            auto bytes = static_cast<const unsigned char *>(data);
+            this->total += size;
+            if (this->buffered + size < 32) {
+                std::memcpy(this->buffer + this->buffered, bytes, size);
+                this->buffered += size;
+                return;
             }
-
-            // next, the edges.
-            count = this->readInt32();
-            Utils::log_info_d("Bridge edge count: %s", U::intc(count).c_str());
-            for (int i = 0; i < count; i++) {
-                layout.bridge.edges.push_back(this->deserializeEdge(layout.bridge.version));
+            if (this->buffered > 0) {
+                std::size_t fill = 32 - this->buffered;
+                std::memcpy(this->buffer + this->buffered, bytes, fill);
+                this->consume(this->buffer);
+                bytes += fill;
+                size -= fill;
+                this->buffered = 0;
             }
-
-            // last, the pistons.
-            count = this->readInt32();
-            Utils::log_info_d("Bridge piston count: %s", U::intc(count).c_str());
-            for (int i = 0; i < count; i++) {
-                layout.bridge.pistons.push_back(this->deserializePiston(layout.bridge.version));
+            for (; size >= 32; bytes += 32, size -= 32) this->consume(bytes);
+            std::memcpy(this->buffer, bytes, size);
+            this->buffered = size;
+        }
+        void update(std::string_view text) {
+            this->update(text.data(), text.size());
+        }
+        template<typename T>
+        void updateValue(T value) {
+            this->update(&value, sizeof(T));
+        }
+        uint64_t digest() const {
+            uint64_t h;
+            if (this->total >= 32) {
+                h = rotl(this->acc[0], 1) + rotl(this->acc[1], 7) + rotl(this->acc[2], 12) + rotl(this->acc[3], 18);
+                for (uint64_t lane : this->acc) h = (h ^ round(0, lane)) * P1 + P4;
+            } else {
+                h = this->seed + P5;
             }
+            h += this->total;
+            const unsigned char *p = this->buffer;
+            std::size_t left = this->buffered;
+            for (; left >= 8; p += 8, left -= 8) h = rotl(h ^ round(0, load<uint64_t>(p)), 27) * P1 + P4;
+            if (left >= 4) {
+                h = rotl(h ^ (uint64_t)load<uint32_t>(p) * P1, 23) * P2 + P3;
+                p += 4;
+                left -= 4;
+            }
+            for (; left > 0; p++, left--) h = rotl(h ^ *p * P5, 11) * P1;
+            h ^= h >> 33;
+            h *= P2;
+            h ^= h >> 29;
+            h *= P3;
+            h ^= h >> 32;
+            return h;
+        }
+    private:
+        static constexpr uint64_t P1 = 0x9E3779B185EBCA87ULL;
+        static constexpr uint64_t P2 = 0xC2B2AE3D27D4EB4FULL;
+        static constexpr uint64_t P3 = 0x165667B19E3779F9ULL;
+        static constexpr uint64_t P4 = 0x85EBCA77C2B2AE63ULL;
+        static constexpr uint64_t P5 = 0x27D4EB2F165667C5ULL;
+        uint64_t seed;
+        uint64_t acc[4]{};
+        uint64_t total = 0;
+        unsigned char buffer[32]{};
+        std::size_t buffered = 0;
+
+        static uint64_t rotl(uint64_t x, int r) {
+            return (x << r) | (x >> (64 - r));
+        }
+        static uint64_t round(uint64_t acc, uint64_t input) {
+            return rotl(acc + input * P2, 31) * P1;
+        }
+        template<typename T>
+        static T load(const unsigned char *p) {
+            T value;
+            std::memcpy(&value, p, sizeof(T));
+            return value;
         }
-
-        // After that, if the version is 7 or greater, we can deserialize the Z-axis vehicles (boats, etc.).
-        if (layout.version >= 7) {
-            layout.zAxisVehicles = this->deserializeZAxisVehicles(layout.version);
+        void consume(const unsigned char *block) {
+            for (int i = 0; i < 4; i++) this->acc[i] = round(this->acc[i], load<uint64_t>(block + i * 8));
         }
+    };
 
-        // Then, we can deserialize the vehicles.
-        layout.vehicles = this->deserializeVehicles();
-
-        // Next, we deserialize the vehicle stop triggers.
-        layout.vehicleStopTriggers = this->deserializeVehicleStopTriggers();
+    inline std::string hex(uint64_t value) {
+        char text[17];
+        std::snprintf(text, sizeof(text), "%016llx", (unsigned long long)value);
+        return text;
+    }
+}
 
-        // If the version is below 20, we deserialize the theme objects, though it's obsolete.
-        // This isn't actually collected or used when the layout is loaded in the game, but it's still useful for debugging.
-        if (layout.version < 20) {
-            layout.themeObjects_OBSOLETE = this->deserializeThemeObjects_OBSOLETE();
+// Streaming compression
+//   Files ending in .gz or .zst are (de)compressed on the fly while they are read or written, so a compressed
+//   .layout or .layout.json never has to exist uncompressed on disk. InputFile and OutputFile are plain
+//   std::istream/std::ostream objects; for uncompressed paths they simply use the file's own buffer.
+namespace Compression {
+    enum Codec {
+        NO_CODEC,
+        GZIP_CODEC,
+        ZSTD_CODEC
+    };
+
+    Codec codecForPath(std::string_view path) {
+        if (path.ends_with(".gz")) return GZIP_CODEC;
+        if (path.ends_with(".zst")) return ZSTD_CODEC;
+        return NO_CODEC;
+    }
+
+    // The path without its compression suffix, used to find the underlying format
+    std::string_view stripSuffix(std::string_view path) {
+        switch (codecForPath(path)) {
+            case GZIP_CODEC:
+                return path.substr(0, path.size() - 3);
+            case ZSTD_CODEC:
+                return path.substr(0, path.size() - 4);
+            default:
+                return path;
         }
+    }
 
-        // After that, we can deserialize the event timelines.
-        layout.eventTimelines = this->deserializeEventTimelines(layout.version);
-
-        // Then, we deserialize checkpoints.
-        layout.checkpoints = this->deserializeCheckpoints();
+    constexpr std::size_t BUFFER_SIZE = 1 << 16;
 
-        // Next, we deserialize terrain stretches.
-        layout.terrainStretches = this->deserializeTerrainIslands(layout.version);
+    [[noreturn]] void fail(const std::string &message) {
+        U::log_error("Compression error: %s", message.c_str());
+        exit(1);
+    }
 
-        // Deserialize the platforms.
-        layout.platforms = this->deserializePlatforms(layout.version);
+    // Collects written bytes and hands them to encode() a buffer at a time.
+    class OutputBuffer : public std::streambuf {
+    public:
+        explicit OutputBuffer(std::ostream &sink) : sink(sink), pending(BUFFER_SIZE), encoded(BUFFER_SIZE) {
+            this->setp(this->pending.data(), this->pending.data() + this->pending.size());
+        }
+        // Flushes everything left and ends the compressed stream.
+        void finish() {
+            if (this->finished) return;
+            this->encode(this->pbase(), this->pptr() - this->pbase(), true);
+            this->setp(this->pending.data(), this->pending.data() + this->pending.size());
+            this->finished = true;
+        }
+    protected:
+        std::ostream &sink;
+        std::vector<char> pending;
+        std::vector<char> encoded;
+
+        virtual void encode(const char *data, std::size_t size, bool last) = 0;
+
+        int_type overflow(int_type ch) override {
+            this->encode(this->pbase(), this->pptr() - this->pbase(), false);
+            this->setp(this->pending.data(), this->pending.data() + this->pending.size());
+            if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+                *this->pptr() = traits_type::to_char_type(ch);
+                this->pbump(1);
+            }
+            return traits_type::not_eof(ch);
+        }
+    private:
+        bool finished = false;
+    };
+
+    // Refills from the raw file and has decode() produce a buffer of output at a time.
+    class InputBuffer : public std::streambuf {
+    public:
+        explicit InputBuffer(std::istream &source) : source(source), raw(BUFFER_SIZE), decoded(BUFFER_SIZE) {}
+    protected:
+        std::istream &source;
+        std::vector<char> raw;
+        std::vector<char> decoded;
+        uint64_t consumed = 0;  // decoded bytes in buffers before the current one
+
+        // Returns the number of bytes written to out, 0 only at the end of the stream.
+        virtual std::size_t decode(char *out, std::size_t capacity) = 0;
+
+        std::size_t refill() {
+            this->source.read(this->raw.data(), (std::streamsize)this->raw.size());
+            return (std::size_t)this->source.gcount();
+        }
+
+        // Only reports the position (tellg), in bytes of decoded data; compressed streams can't seek.
+        pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override {
+            if (off != 0 || dir != std::ios_base::cur || !(which & std::ios_base::in)) return pos_type(off_type(-1));
+            return pos_type(off_type(this->consumed + (this->gptr() - this->eback())));
+        }
+
+        int_type underflow() override {
+            if (this->gptr() < this->egptr()) return traits_type::to_int_type(*this->gptr());
+            this->consumed += this->egptr() - this->eback();
+            std::size_t size = this->decode(this->decoded.data(), this->decoded.size());
+            // At the end the get area is emptied too, or the next call (or tellg) would count the last buffer twice.
+            this->setg(this->decoded.data(), this->decoded.data(), this->decoded.data() + size);
+            if (size == 0) return traits_type::eof();
+            return traits_type::to_int_type(*this->gptr());
+        }
+    };
+
+#ifdef POLYPARSER_HAVE_ZLIB
+    class GzipOutputBuffer : public OutputBuffer {
+    public:
+        explicit GzipOutputBuffer(std::ostream &sink) : OutputBuffer(sink) {
+            // 15 + 16 selects a gzip header and trailer rather than raw zlib
+            if (deflateInit2(&this->stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+                fail("could not initialize gzip");
+            }
+        }
+        ~GzipOutputBuffer() override {
+            deflateEnd(&this->stream);
+        }
+    protected:
+        void encode(const char *data, std::size_t size, bool last) override {
+            this->stream.next_in = (Bytef *)data;
+            this->stream.avail_in = (uInt)size;
+            while (true) {
+                this->stream.next_out = (Bytef *)this->encoded.data();
+                this->stream.avail_out = (uInt)this->encoded.size();
+                int result = deflate(&this->stream, last ? Z_FINISH : Z_NO_FLUSH);
+                if (result == Z_STREAM_ERROR) fail("gzip stream error");
+                this->sink.write(this->encoded.data(), (std::streamsize)(this->encoded.size() - this->stream.avail_out));
+                if (last ? result == Z_STREAM_END : this->stream.avail_out != 0) break;
+            }
+        }
+    private:
+        z_stream stream{};
+    };
 
-        // Then, the ramps.
-        layout.ramps = this->deserializeRamps(layout.version);
+    class GzipInputBuffer : public InputBuffer {
+    public:
+        explicit GzipInputBuffer(std::istream &source) : InputBuffer(source) {
+            // 15 + 32 accepts both gzip and zlib headers
+            if (inflateInit2(&this->stream, 15 + 32) != Z_OK) {
+                fail("could not initialize gzip");
+            }
+        }
+        ~GzipInputBuffer() override {
+            inflateEnd(&this->stream);
+        }
+    protected:
+        std::size_t decode(char *out, std::size_t capacity) override {
+            this->stream.next_out = (Bytef *)out;
+            this->stream.avail_out = (uInt)capacity;
+            while (this->stream.avail_out == capacity) {
+                bool drained = false;
+                if (this->stream.avail_in == 0) {
+                    std::size_t size = this->refill();
+                    if (size == 0) {
+                        if (this->ended) return 0;
+                        drained = true;  // inflate may still hold output from the last buffer
+                    }
+                    this->stream.next_in = (Bytef *)this->raw.data();
+                    this->stream.avail_in = (uInt)size;
+                }
+                if (this->ended) {
+                    // another gzip member follows the one that just ended
+                    inflateReset(&this->stream);
+                    this->ended = false;
+                }
+                int result = inflate(&this->stream, Z_NO_FLUSH);
+                if (result == Z_STREAM_END) {
+                    this->ended = true;
+                } else if (result != Z_OK && result != Z_BUF_ERROR) {
+                    fail("corrupt gzip data");
+                }
+                if (drained && !this->ended && this->stream.avail_out == capacity) fail("truncated gzip data");
+            }
+            return capacity - this->stream.avail_out;
+        }
+    private:
+        z_stream stream{};
+        bool ended = false;
+    };
+#endif
+
+#ifdef POLYPARSER_HAVE_ZSTD
+    class ZstdOutputBuffer : public OutputBuffer {
+    public:
+        explicit ZstdOutputBuffer(std::ostream &sink) : OutputBuffer(sink), context(ZSTD_createCCtx()) {
+            if (this->context == nullptr) fail("could not initialize zstd");
+        }
+        ~ZstdOutputBuffer() override {
+            ZSTD_freeCCtx(this->context);
+        }
+    protected:
+        void encode(const char *data, std::size_t size, bool last) override {
+            ZSTD_inBuffer input{data, size, 0};
+            while (true) {
+                ZSTD_outBuffer output{this->encoded.data(), this->encoded.size(), 0};
+                std::size_t remaining = ZSTD_compressStream2(this->context, &output, &input, last ? ZSTD_e_end : ZSTD_e_continue);
+                if (ZSTD_isError(remaining)) fail(ZSTD_getErrorName(remaining));
+                this->sink.write(this->encoded.data(), (std::streamsize)output.pos);
+                if (last ? remaining == 0 : input.pos == input.size) break;
+            }
+        }
+    private:
+        ZSTD_CCtx *context;
+    };
+
+    class ZstdInputBuffer : public InputBuffer {
+    public:
+        explicit ZstdInputBuffer(std::istream &source) : InputBuffer(source), context(ZSTD_createDCtx()) {
+            if (this->context == nullptr) fail("could not initialize zstd");
+        }
+        ~ZstdInputBuffer() override {
+            ZSTD_freeDCtx(this->context);
+        }
+    protected:
+        std::size_t decode(char *out, std::size_t capacity) override {
+            ZSTD_outBuffer output{out, capacity, 0};
+            while (output.pos == 0) {
+                bool drained = false;
+                if (this->input.pos == this->input.size) {
+                    std::size_t size = this->refill();
+                    if (size == 0) {
+                        if (this->pending == 0) return 0;
+                        drained = true;  // the decoder may still hold output from the last buffer
+                    }
+                    this->input = {this->raw.data(), size, 0};
+                }
+                this->pending = ZSTD_decompressStream(this->context, &output, &this->input);
+                if (ZSTD_isError(this->pending)) fail(ZSTD_getErrorName(this->pending));
+                if (drained && output.pos == 0) fail("truncated zstd data");
+            }
+            return output.pos;
+        }
+    private:
+        ZSTD_DCtx *context;
+        ZSTD_inBuffer input{nullptr, 0, 0};
+        std::size_t pending = 1;  // non-zero until a frame has been completely decoded
+    };
+#endif
+
+    // Builds the codec buffer for path on top of stream, or returns null for uncompressed files.
+    template<typename Buffer, typename Stream>
+    std::unique_ptr<Buffer> makeBuffer(const std::string &path, [[maybe_unused]] Stream &stream) {
+        switch (codecForPath(path)) {
+            case GZIP_CODEC:
+#ifdef POLYPARSER_HAVE_ZLIB
+                if constexpr (std::is_same_v<Buffer, OutputBuffer>) return std::make_unique<GzipOutputBuffer>(stream);
+                else return std::make_unique<GzipInputBuffer>(stream);
+#else
+                fail("PolyParser was built without gzip support, can't handle " + path);
+#endif
+            case ZSTD_CODEC:
+#ifdef POLYPARSER_HAVE_ZSTD
+                if constexpr (std::is_same_v<Buffer, OutputBuffer>) return std::make_unique<ZstdOutputBuffer>(stream);
+                else return std::make_unique<ZstdInputBuffer>(stream);
+#else
+                fail("PolyParser was built without zstd support, can't handle " + path);
+#endif
+            default:
+                return nullptr;
+        }
+    }
 
-        // Hydraulic phases are here if the layout version is less than 5.
-        if (layout.version < 5) {
-            layout.phases = this->deserializePhases();
+    class InputFile : public std::istream {
+    public:
+        InputFile() : std::istream(nullptr) {}
+        explicit InputFile(const std::string &path) : InputFile() {
+            this->open(path);
         }
+        // A non-zero read_size replaces the file's default read buffer (it doesn't apply to compressed files, whose
+        // codec reads in its own chunks).
+        bool open(const std::string &path, std::size_t read_size = 0) {
+            if (read_size > 0 && codecForPath(path) == NO_CODEC) {
+                this->readBuffer.resize(read_size);
+                this->file.rdbuf()->pubsetbuf(this->readBuffer.data(), (std::streamsize)read_size);
+            }
+            this->file.open(path, std::ios::binary);
+            if (!this->file.is_open()) return false;
+            this->buffer = makeBuffer<InputBuffer>(path, this->file);
+            this->rdbuf(this->buffer ? (std::streambuf *)this->buffer.get() : this->file.rdbuf());
+            return true;
+        }
+        bool is_open() const {
+            return this->file.is_open();
+        }
+        void close() {
+            this->file.close();
+        }
+        // Moves past count bytes. Short skips just advance through the read buffer; long ones on uncompressed
+        // files seek, so the bytes are never read at all.
+        void skip(uint64_t count) {
+            if (this->buffer || count < BUFFER_SIZE) this->ignore((std::streamsize)count);
+            else this->seekg((std::streamoff)count, std::ios::cur);
+        }
+    private:
+        std::vector<char> readBuffer;  // declared before file, which reads into it
+        std::ifstream file;
+        std::unique_ptr<InputBuffer> buffer;
+    };
+
+    class OutputFile : public std::ostream {
+    public:
+        OutputFile() : std::ostream(nullptr) {}
+        explicit OutputFile(const std::string &path, std::ios::openmode mode = std::ios::binary) : OutputFile() {
+            this->open(path, mode);
+        }
+        ~OutputFile() override {
+            this->close();
+        }
+        bool open(const std::string &path, std::ios::openmode mode = std::ios::binary) {
+            // compressed data must never go through text mode newline translation
+            if (codecForPath(path) != NO_CODEC) mode |= std::ios::binary;
+            this->file.open(path, mode | std::ios::out);
+            if (!this->file.is_open()) return false;
+            this->buffer = makeBuffer<OutputBuffer>(path, this->file);
+            this->rdbuf(this->buffer ? (std::streambuf *)this->buffer.get() : this->file.rdbuf());
+            return true;
+        }
+        bool is_open() const {
+            return this->file.is_open();
+        }
+        void close() {
+            if (!this->file.is_open()) return;
+            if (this->buffer) this->buffer->finish();
+            this->file.close();
+        }
+    private:
+        std::ofstream file;
+        std::unique_ptr<OutputBuffer> buffer;
+    };
+
+    // Appends size bytes found at offset in the decoded contents of path to out.
+    bool readRange(const std::string &path, uint64_t offset, uint64_t size, std::string &out) {
+        InputFile file(path);
+        if (!file.is_open()) return false;
+        file.skip(offset);
+        std::size_t start = out.size();
+        out.resize(start + size);
+        file.read(out.data() + start, (std::streamsize)size);
+        if ((uint64_t)file.gcount() != size) {
+            out.resize(start);
+            return false;
+        }
+        return true;
+    }
+
+    // Writes size bytes found at offset in the decoded contents of path to a new file at out_path. When neither file
+    // is compressed the copy is done by the kernel (copy_file_range, or sendfile on older kernels), so the bytes never
+    // pass through this process.
+    bool copyRange(const std::string &path, uint64_t offset, uint64_t size, const std::string &out_path) {
+#ifdef __linux__
+        if (codecForPath(path) == NO_CODEC && codecForPath(out_path) == NO_CODEC) {
+            int in = ::open(path.c_str(), O_RDONLY);
+            if (in < 0) return false;
+            int out = ::open(out_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (out < 0) {
+                ::close(in);
+                return false;
+            }
+            auto position = (off64_t)offset;
+            uint64_t remaining = size;
+            bool use_sendfile = false;
+            while (remaining > 0) {
+                ssize_t copied;
+                if (!use_sendfile) {
+                    copied = copy_file_range(in, &position, out, nullptr, remaining, 0);
+                    if (copied < 0 && (errno == ENOSYS || errno == EXDEV || errno == EINVAL || errno == EOPNOTSUPP)) {
+                        use_sendfile = true;
+                        continue;
+                    }
+                } else {
+                    copied = sendfile(out, in, &position, remaining);
+                }
+                if (copied <= 0) break;
+                remaining -= copied;
+            }
+            ::close(in);
+            ::close(out);
+            return remaining == 0;
+        }
+#endif
+        std::string bytes;
+        if (!readRange(path, offset, size, bytes)) return false;
+        OutputFile out(out_path);
+        if (!out.is_open()) return false;
+        out.write(bytes.data(), (std::streamsize)bytes.size());
+        out.close();
+        return !out.fail();
+    }
+}
 
-        // Next, we deserialize the vehicle restart phases.
-        layout.vehicleRestartPhases = this->deserializeVehicleRestartPhases();
+// Conversion cache
+//   Converted documents are stored in a directory under a key made from the input file's bytes, PolyParser's
+//   version and everything else that changes the output (format, precision, ...). Converting the same bytes again
+//   just copies the stored document out, reflinking it where the filesystem allows. Each entry's modification time
+//   is its last use, and once the entries grow past the size limit the least recently used ones are removed.
+//   Entries live in an "entries" folder of the cache directory, and only files named like a key are ever counted or
+//   removed, so pointing --cache at a folder that holds anything else can't cost the user files.
+class ConversionCache {
+public:
+    ConversionCache(const std::string &directory, uint64_t max_bytes)
+            : directory((std::filesystem::path(directory) / "entries").string()), maxBytes(max_bytes) {
+        std::error_code error;
+        std::filesystem::create_directories(this->directory, error);
+        if (error) {
+            U::log_error("Could not create cache directory %s: %s", this->directory.c_str(), error.message().c_str());
+            exit(1);
+        }
+    }
 
-        // Next, flying objects such as airplanes, blimps, etc.
-        layout.flyingObjects = this->deserializeFlyingObjects();
+    // variant describes the conversion settings; inputs only share an entry if their variants match too.
+    std::string key(const std::string &input_path, std::string_view variant) const {
+        std::ifstream in(input_path, std::ios::binary);
+        if (!in.is_open()) {
+            U::log_error("Could not open %s", input_path.c_str());
+            exit(1);
+        }
+        Hash::Xxh64 content;
+        std::vector<char> chunk(1 << 16);
+        while (in.read(chunk.data(), (std::streamsize)chunk.size()) || in.gcount() > 0) {
+            content.update(chunk.data(), (std::size_t)in.gcount());
+        }
+        Hash::Xxh64 settings;
+        settings.update(POLYPARSER_VERSION);
+        settings.updateValue('\0');
+        settings.update(variant);
+        return Hash::hex(content.digest()) + "-" + Hash::hex(settings.digest());
+    }
+
+    // Copies the entry for key to output_path; false if there is none.
+    bool fetch(const std::string &key, const std::string &output_path) {
+        std::string entry = this->entryPath(key);
+        std::error_code error;
+        if (!std::filesystem::is_regular_file(entry, error)) return false;
+        if (!clone(entry, output_path)) return false;
+        std::filesystem::last_write_time(entry, std::filesystem::file_time_type::clock::now(), error);
+        return true;
+    }
+
+    // Adds the document at output_path under key, then trims the cache back to its size limit.
+    void store(const std::string &key, const std::string &output_path) {
+        std::string entry = this->entryPath(key);
+        // copy to a temporary name first so a concurrent fetch never sees half an entry
+        std::string temporary = entry + ".tmp" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+        if (!clone(output_path, temporary)) {
+            U::log_warn("Could not add %s to the conversion cache", output_path.c_str());
+            std::filesystem::remove(temporary);
+            return;
+        }
+        std::error_code error;
+        std::filesystem::rename(temporary, entry, error);
+        if (error) std::filesystem::remove(temporary, error);
+        this->evict();
+    }
+private:
+    std::string directory;
+    uint64_t maxBytes;
+
+    std::string entryPath(const std::string &key) const {
+        return (std::filesystem::path(this->directory) / key).string();
+    }
+    // Whether name has the <16 hex digits>-<16 hex digits> form key() gives.
+    static bool isKey(const std::string &name) {
+        if (name.size() != 33 || name[16] != '-') return false;
+        for (std::size_t i = 0; i < name.size(); i++) {
+            if (i != 16 && GuidCodec::hexValue(name[i]) < 0) return false;
+        }
+        return true;
+    }
+
+    // Reflinks source to destination when both are on a filesystem that supports it, otherwise copies the bytes.
+    static bool clone(const std::string &source, const std::string &destination) {
+#ifdef __linux__
+        int in = ::open(source.c_str(), O_RDONLY);
+        if (in >= 0) {
+            int out = ::open(destination.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            bool cloned = out >= 0 && ioctl(out, FICLONE, in) == 0;
+            if (out >= 0) ::close(out);
+            ::close(in);
+            if (cloned) return true;
+        }
+#endif
+        std::error_code error;
+        uint64_t size = std::filesystem::file_size(source, error);
+        if (error) return false;
+        std::filesystem::copy_file(source, destination, std::filesystem::copy_options::overwrite_existing, error);
+        return !error && std::filesystem::file_size(destination, error) == size;
+    }
+
+    void evict() {
+        struct Entry {
+            std::filesystem::path path;
+            uint64_t size;
+            std::filesystem::file_time_type used;
+        };
+        std::vector<Entry> entries;
+        uint64_t total = 0;
+        std::error_code error;
+        for (const auto &item : std::filesystem::directory_iterator(this->directory, error)) {
+            if (!item.is_regular_file(error) || !isKey(item.path().filename().string())) continue;
+            uint64_t size = item.file_size(error);
+            entries.push_back(Entry{item.path(), size, item.last_write_time(error)});
+            total += size;
+        }
+        if (total <= this->maxBytes) return;
+        std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) { return a.used < b.used; });
+        for (const Entry &entry : entries) {
+            if (total <= this->maxBytes) break;
+            if (std::filesystem::remove(entry.path, error)) total -= entry.size;
+        }
+        U::log_info_d("Trimmed conversion cache to %s KiB", U::intc((int)(total / 1024), 0, INT32_MAX, 0, INT32_MAX).c_str());
+    }
+};
 
-        // Then, we deserialize rocks.
-        layout.rocks = this->deserializeRocks();
+// Layout sections
+//   A layout is a header (version and stub key) followed by these sections back to back, with no offsets or lengths
+//   anywhere. Which of them are present, and in what order, depends only on the version; layout_sections gives the
+//   file order. The names are the Layout members they fill in.
+enum LayoutSection {
+    ANCHORS_SECTION,
+    PHASES_SECTION,
+    BRIDGE_SECTION,
+    Z_AXIS_VEHICLES_SECTION,
+    VEHICLES_SECTION,
+    VEHICLE_STOP_TRIGGERS_SECTION,
+    THEME_OBJECTS_SECTION,
+    EVENT_TIMELINES_SECTION,
+    CHECKPOINTS_SECTION,
+    TERRAIN_STRETCHES_SECTION,
+    PLATFORMS_SECTION,
+    RAMPS_SECTION,
+    VEHICLE_RESTART_PHASES_SECTION,
+    FLYING_OBJECTS_SECTION,
+    ROCKS_SECTION,
+    WATER_BLOCKS_SECTION,
+    BUDGET_SECTION,
+    SETTINGS_SECTION,
+    CUSTOM_SHAPES_SECTION,
+    WORKSHOP_SECTION,
+    SUPPORT_PILLARS_SECTION,
+    PILLARS_SECTION,
+    MOD_DATA_SECTION,
+    SECTION_COUNT
+};
+constexpr std::array<const char*, SECTION_COUNT> SECTION_NAMES = {
+    "anchors", "phases", "bridge", "zAxisVehicles", "vehicles", "vehicleStopTriggers", "themeObjects",
+    "eventTimelines", "checkpoints", "terrainStretches", "platforms", "ramps", "vehicleRestartPhases",
+    "flyingObjects", "rocks", "waterBlocks", "budget", "settings", "customShapes", "workshop", "supportPillars",
+    "pillars", "modData"
+};
 
-        // After that, we deserialize water blocks.
-        layout.waterBlocks = this->deserializeWaterBlocks(layout.version);
+// Returns SECTION_COUNT for unknown names.
+LayoutSection section_from_name(std::string_view name) {
+    for (int i = 0; i < SECTION_COUNT; i++) {
+        if (name == SECTION_NAMES[i]) return (LayoutSection)i;
+    }
+    return SECTION_COUNT;
+}
 
-        // If the version is less than 5, there's some garbage data here.
-        if (layout.version < 5) {
-            Utils::log_warn_d("Deserializing garbage data with version under 5");
-            int count = this->readInt32();
-            int count2;
-            for (int i = 0; i < count; i++) {
-                this->readString();
-                count2 = this->readInt32();
-                for (int j = 0; j < count2; j++) {
-                    this->readString();
-                }
-            }
-        }
+// A projection: which sections to decode and write. Everything else is skipped over in the file and left out of
+// the output.
+using SectionMask = std::bitset<SECTION_COUNT>;
+inline const SectionMask ALL_SECTIONS = SectionMask().set();
+
+// Parses a comma separated list of section names, e.g. "bridge,budget,workshop"; false on an unknown name.
+bool parse_section_list(std::string_view list, SectionMask &mask) {
+    mask.reset();
+    while (!list.empty()) {
+        std::size_t comma = std::min(list.find(','), list.size());
+        std::string_view name = list.substr(0, comma);
+        list.remove_prefix(std::min(comma + 1, list.size()));
+        if (name.empty()) continue;
+        LayoutSection section = section_from_name(name);
+        if (section == SECTION_COUNT) {
+            U::log_error("Unknown layout section '%s'", std::string(name).c_str());
+            return false;
+        }
+        mask.set(section);
+    }
+    return true;
+}
 
-        // Now, we can deserialize the budget.
-        layout.budget = this->deserializeBudget();
+std::vector<LayoutSection> layout_sections(int version, bool modded) {
+    std::vector<LayoutSection> sections;
+    if (version >= 19) sections.push_back(ANCHORS_SECTION);
+    if (version >= 5) sections.push_back(PHASES_SECTION);
+    sections.push_back(BRIDGE_SECTION);
+    if (version >= 7) sections.push_back(Z_AXIS_VEHICLES_SECTION);
+    sections.push_back(VEHICLES_SECTION);
+    sections.push_back(VEHICLE_STOP_TRIGGERS_SECTION);
+    if (version < 20) sections.push_back(THEME_OBJECTS_SECTION);
+    sections.push_back(EVENT_TIMELINES_SECTION);
+    sections.push_back(CHECKPOINTS_SECTION);
+    sections.push_back(TERRAIN_STRETCHES_SECTION);
+    sections.push_back(PLATFORMS_SECTION);
+    sections.push_back(RAMPS_SECTION);
+    if (version < 5) sections.push_back(PHASES_SECTION);  // hydraulic phases came after the ramps before version 5
+    sections.push_back(VEHICLE_RESTART_PHASES_SECTION);
+    sections.push_back(FLYING_OBJECTS_SECTION);
+    sections.push_back(ROCKS_SECTION);
+    sections.push_back(WATER_BLOCKS_SECTION);
+    sections.push_back(BUDGET_SECTION);
+    sections.push_back(SETTINGS_SECTION);
+    if (version >= 9) sections.push_back(CUSTOM_SHAPES_SECTION);
+    if (version >= 15) sections.push_back(WORKSHOP_SECTION);
+    if (version >= 17) sections.push_back(SUPPORT_PILLARS_SECTION);
+    if (version >= 18) sections.push_back(PILLARS_SECTION);
+    if (modded) sections.push_back(MOD_DATA_SECTION);  // PolyTechFramework appends its data after everything else
+    return sections;
+}
 
-        // Then, the settings.
-        layout.settings = this->deserializeSettings(layout.version);
+// Where each section of one layout file starts (in its decoded bytes), so any of them can be read without going
+// through the ones before it. Built by Deserializer::buildIndex; save/load keep it next to the layout, and it is
+// only trusted while the layout's size and modification time are unchanged.
+struct LayoutIndex {
+    static constexpr int FORMAT_VERSION = 1;
 
-        // Now, if the version is 9 or above, we have custom shapes to deal with.
-        if (layout.version >= 9) {
-            layout.customShapes = this->deserializeCustomShapes(layout.version);
+    int version{};
+    bool isModded{};
+    std::string stubKey;
+    uint64_t sourceSize{};
+    int64_t sourceModified{};
+    std::array<int64_t, SECTION_COUNT> offsets{};  // -1 for sections this version doesn't have
+
+    bool matches(const std::string &layout_path) const {
+        std::error_code error;
+        auto size = std::filesystem::file_size(layout_path, error);
+        if (error) return false;
+        auto modified = std::filesystem::last_write_time(layout_path, error);
+        if (error) return false;
+        return size == this->sourceSize && modified.time_since_epoch().count() == this->sourceModified;
+    }
+    bool save(const std::string &index_path) const {
+        json j;
+        j["formatVersion"] = FORMAT_VERSION;
+        j["version"] = this->version;
+        j["modded"] = this->isModded;
+        j["stubKey"] = this->stubKey;
+        j["size"] = this->sourceSize;
+        j["modified"] = this->sourceModified;
+        json &sections = j["sections"] = json::object();
+        for (int i = 0; i < SECTION_COUNT; i++) {
+            if (this->offsets[i] >= 0) sections[SECTION_NAMES[i]] = this->offsets[i];
+        }
+        std::ofstream out(index_path);
+        if (!out.is_open()) return false;
+        out << j;
+        return out.good();
+    }
+    // False if the file is missing or isn't an index this version of PolyParser wrote.
+    static bool load(const std::string &index_path, LayoutIndex &index) {
+        std::ifstream in(index_path);
+        if (!in.is_open()) return false;
+        json j = json::parse(in, nullptr, false);
+        if (j.is_discarded() || !j.is_object() || j.value("formatVersion", 0) != FORMAT_VERSION) return false;
+        try {
+            index.version = j.at("version").get<int>();
+            index.isModded = j.at("modded").get<bool>();
+            index.stubKey = j.at("stubKey").get<std::string>();
+            index.sourceSize = j.at("size").get<uint64_t>();
+            index.sourceModified = j.at("modified").get<int64_t>();
+            index.offsets.fill(-1);
+            for (auto &[name, offset] : j.at("sections").items()) {
+                LayoutSection section = section_from_name(name);
+                if (section != SECTION_COUNT) index.offsets[section] = offset.get<int64_t>();
+            }
+        } catch (const json::exception &) {
+            return false;
         }
+        return true;
+    }
+};
 
-        // Deserialize workshop binary (version 15+)
-        if (layout.version >= 15) {
-            layout.workshop = this->deserializeWorkshop(layout.version);
-        }
+class Deserializer {
+public:
+    std::string path;
+    Compression::InputFile file;
+    explicit Deserializer(std::string path) {
+        this->path = std::move(path);
 
-        // Deserialize support pillars (version 17+)
-        if (layout.version >= 17) {
-            layout.supportPillars = this->deserializeSupportPillars();
+        if (!this->file.open(this->path)) {
+            Utils::log_error_d("Failed to open file: " + this->path);
+            exit(1);
         }
-
-        // Finally, we can deserialize pillars. (version 18+)
-        if (layout.version >= 18) {
-            layout.pillars = this->deserializePillars();
+    }
+    ~Deserializer() {
+        this->file.close();
+    }
+    // Sections left out of fields are skipped over (see skipSection) and stay empty in the returned layout.
+    Layout deserializeLayout(const SectionMask &fields = ALL_SECTIONS) {
+        Layout layout;
+        // NOTE: This has to be ordered, as it reads the file in the order it is written
+        this->deserializeHeader(layout);
+        for (LayoutSection section : layout_sections(layout.version, layout.isModded)) {
+            if (fields[section]) {
+                this->deserializeSection(section, layout);
+            } else {
+                this->skipSection(section, layout);
+            }
         }
+        return layout;
+    }
 
-        // Now, some checks:
-        // First, we check to make sure we are at the end of the file.
-        long pos = (long)this->file.tellg();
-        // Modded layouts have extra mod data at the end.
-        if (!layout.isModded) return layout;  // We can end here if there's no mod data.
+    // Skims the whole file once and records where each section starts, so the result is just the offsets.
+    LayoutIndex buildIndex() {
+        LayoutIndex index;
+        index.offsets.fill(-1);
+        Layout header;
+        this->deserializeHeader(header);
+        index.version = header.version;
+        index.isModded = header.isModded;
+        index.stubKey = std::string(header.stubKey);
+        for (LayoutSection section : layout_sections(header.version, header.isModded)) {
+            index.offsets[section] = (int64_t)this->file.tellg();
+            this->skipSection(section, header);
+        }
+        std::error_code error;
+        index.sourceSize = (uint64_t)std::filesystem::file_size(this->path, error);
+        index.sourceModified = (int64_t)std::filesystem::last_write_time(this->path, error).time_since_epoch().count();
+        return index;
+    }
 
-        // MOD SUPPORT: PTF stores mod data at the end, indicated by a negative version at the start.
-        // Notify user that we're deserializing mod data.
-        Utils::log_info_d("Deserializing mod data...");
-        // Then, we deserialize the mod data.
-        layout.modData = this->deserializePTFModData();
-        // Then, we can return the layout.
-        return layout;
+    // Decodes one section into layout, jumping straight to it with an index built for this file.
+    void deserializeSection(const LayoutIndex &index, LayoutSection section, Layout &layout) {
+        if (index.offsets[section] < 0) return;  // not in this version of the format
+        layout.version = index.version;
+        layout.isModded = index.isModded;
+        unusualNumbers = 1;
+        this->seekTo((uint64_t)index.offsets[section]);
+        this->deserializeSection(section, layout);
     }
+
     static float fixPistonNormalizedValue(float value) {
         float out;
         if (value < 0.25f) {
@@ -810,6 +1966,277 @@ public:
         return out;
     }
 private:
+    bool skimming = false;  // set by skipSection: strings are skipped rather than read, and nothing is logged
+
+    void deserializeHeader(Layout &layout) {
+        unusualNumbers = 1;  // the allowance for unusual numbers is per file, not per process
+        // first, we get the version, which is used to determine which fields are present
+        this->getVersion(layout.version, layout.isModded);
+
+        if (layout.isModded) {
+            this->logInfo("Using modded layout support");
+        }
+
+        Utils::ensureReasonable(layout.version, 0, 100, 0, 50);
+        this->logInfo("Deserializing layout version %s", this->intc(layout.version).c_str());
+        if (layout.version > MAX_VERSION) {
+            this->logWarn("Layout saved with a newer version of the layout format. This may cause problems.");
+        }
+        // then we get the stub key, which is the theme of the layout, e.g. "Western"
+        layout.stubKey = this->getStubKey();
+        this->logInfo("Layout stub key: %s", layout.stubKey.c_str());
+        // then we get the name of the layout, e.g. "Western"
+        // this is just used for aesthetics
+        this->logInfo("Layout theme name: %s", Utils::prettyPrintStubKeyToTheme(layout.stubKey).c_str());
+    }
+
+    // Moves past one section without keeping any of it. The format has no section lengths, but most sections are a
+    // list of records with a fixed layout (see recordShape): those are stepped over by their sizes, only reading the
+    // count and string lengths, so nothing is decoded or allocated. The others nest lists of their own and are still
+    // walked, skimming: strings (and mod save data) are skipped by their length instead of being read, what does get
+    // decoded goes into a scratch layout in a scratch arena that is released straight away, and nothing is logged.
+    void skipSection(LayoutSection section, const Layout &layout) {
+        RecordShape shape;
+        if (recordShape(section, layout.version, shape)) {
+            this->skipRecords(shape);
+            return;
+        }
+        Arena::Scope scratch;
+        Layout discard;
+        discard.version = layout.version;
+        discard.isModded = layout.isModded;
+
+        this->skimming = true;
+        this->deserializeSection(section, discard);
+        this->skimming = false;
+    }
+
+    // How the records of a section are laid out: runs of fixed bytes, with STRING wherever a length-prefixed string
+    // sits. This has to follow the deserialize* function of each section, for every version.
+    static constexpr int STRING = -1;
+    struct RecordShape {
+        bool counted = true;  // the records follow an int32 count; otherwise the section is a single record
+        std::vector<int> fields;
+    };
+    // False for sections whose records aren't all laid out the same (the bridge, vehicles, ramps, custom shapes, ...).
+    static bool recordShape(LayoutSection section, int version, RecordShape &shape) {
+        switch (section) {
+            case ANCHORS_SECTION:  // pos, is_anchor, is_split, guid
+                shape.fields = {12 + 1 + 1, STRING};
+                return true;
+            case PHASES_SECTION:  // time_delay, guid
+                shape.fields = {4, STRING};
+                return true;
+            case VEHICLE_STOP_TRIGGERS_SECTION:  // pos, rot, height, rotation_degrees, flipped, prefab_name, stop_vehicle_guid
+                shape.fields = {8 + 16 + 4 + 4 + 1, STRING, STRING};
+                return true;
+            case THEME_OBJECTS_SECTION:  // pos, prefab_name, unknown_value
+                shape.fields = {8, STRING, 1};
+                return true;
+            case CHECKPOINTS_SECTION:  // pos, prefab_name, vehicle_guid, vehicle_restart_phase_guid, 3 flags, guid
+                shape.fields = {8, STRING, STRING, STRING, 3, STRING};
+                return true;
+            case TERRAIN_STRETCHES_SECTION:  // pos, prefab_name, height_added ... flipped, hidden (v27+), lock_position (v6+)
+                shape.fields = {12, STRING, 4 + 4 + 4 + 4 + 1 + (version >= 27) + (version >= 6)};
+                return true;
+            case PLATFORMS_SECTION:  // pos, width, height, flipped, then solid (v22+) or an unused int32
+                shape.fields = {8 + 4 + 4 + 1 + (version >= 22 ? 1 : 4)};
+                return true;
+            case VEHICLE_RESTART_PHASES_SECTION:  // time_delay, guid, vehicle_guid
+                shape.fields = {4, STRING, STRING};
+                return true;
+            case FLYING_OBJECTS_SECTION:  // pos, scale, prefab_name
+            case SUPPORT_PILLARS_SECTION:
+                shape.fields = {12 + 12, STRING};
+                return true;
+            case ROCKS_SECTION:  // pos, scale, prefab_name, flipped
+                shape.fields = {12 + 12, STRING, 1};
+                return true;
+            case WATER_BLOCKS_SECTION:  // pos, width, height, lock_position (v12+)
+                shape.fields = {12 + 4 + 4 + (version >= 12)};
+                return true;
+            case PILLARS_SECTION:  // pos, height, prefab_name
+                shape.fields = {12 + 4, STRING};
+                return true;
+            case BUDGET_SECTION:  // cash and 8 material limits, 7 allow flags; before v5 there's garbage in front of it
+                shape.counted = false;
+                shape.fields = {9 * 4 + 7};
+                return version >= 5;
+            case SETTINGS_SECTION:  // hydraulics_controller_enabled, unbreakable, no_water (v28+)
+                shape.counted = false;
+                shape.fields = {1 + 1 + (version >= 28)};
+                return true;
+            default:
+                return false;
+        }
+    }
+    void skipRecords(const RecordShape &shape) {
+        int count = shape.counted ? this->readInt32() : 1;
+        if (count <= 0) return;
+        if (std::find(shape.fields.begin(), shape.fields.end(), STRING) == shape.fields.end()) {
+            this->file.skip((uint64_t)count * (uint64_t)std::accumulate(shape.fields.begin(), shape.fields.end(), 0));
+            return;
+        }
+        for (int i = 0; i < count; i++) {
+            for (int field : shape.fields) {
+                this->file.skip(field == STRING ? this->readUInt16() : (uint64_t)field);
+            }
+        }
+    }
+
+    // Logging for the section readers. A section that is only being skimmed stays out of the log.
+    template<typename ...Args>
+    void logInfo(const std::string &message, Args ...args) const {
+        if (!this->skimming) Utils::log_info_d(message, args...);
+    }
+    template<typename ...Args>
+    void logWarn(const std::string &message, Args ...args) const {
+        if (!this->skimming) Utils::log_warn_d(message, args...);
+    }
+    // U::intc for those logs. A skimmed section's numbers aren't logged, so they aren't formatted or range checked.
+    std::string intc(int value, int min = -1000, int max = 10000, int warnMin = 0, int warnMax = 4096) const {
+        return this->skimming ? std::string() : U::intc(value, min, max, warnMin, warnMax);
+    }
+
+    // Reads one section at the current position. layout_sections decides which sections exist and in what order.
+    void deserializeSection(LayoutSection section, Layout &layout) {
+        switch (section) {
+            case ANCHORS_SECTION:
+                layout.anchors = this->deserializeAnchors();
+                break;
+            case PHASES_SECTION:
+                layout.phases = this->deserializePhases();
+                break;
+            case BRIDGE_SECTION:
+                // if the version is greater than 4, we can call the deserializeBridge function.
+                if (layout.version > 4) {
+                    layout.bridge = this->deserializeBridge();
+                    break;
+                }
+                this->logWarn("Deserializing bridge with version under 5, consider upgrading");
+                // otherwise, we have a lot less bridge data to deal with.
+                this->deserializeLegacyBridge(layout.bridge);
+                break;
+            case Z_AXIS_VEHICLES_SECTION:
+                // Z-axis vehicles (boats, etc.)
+                layout.zAxisVehicles = this->deserializeZAxisVehicles(layout.version);
+                break;
+            case VEHICLES_SECTION:
+                layout.vehicles = this->deserializeVehicles();
+                break;
+            case VEHICLE_STOP_TRIGGERS_SECTION:
+                layout.vehicleStopTriggers = this->deserializeVehicleStopTriggers();
+                break;
+            case THEME_OBJECTS_SECTION:
+                // This isn't actually collected or used when the layout is loaded in the game, but it's still useful for debugging.
+                layout.themeObjects_OBSOLETE = this->deserializeThemeObjects_OBSOLETE();
+                break;
+            case EVENT_TIMELINES_SECTION:
+                layout.eventTimelines = this->deserializeEventTimelines(layout.version);
+                break;
+            case CHECKPOINTS_SECTION:
+                layout.checkpoints = this->deserializeCheckpoints();
+                break;
+            case TERRAIN_STRETCHES_SECTION:
+                layout.terrainStretches = this->deserializeTerrainIslands(layout.version);
+                break;
+            case PLATFORMS_SECTION:
+                layout.platforms = this->deserializePlatforms(layout.version);
+                break;
+            case RAMPS_SECTION:
+                layout.ramps = this->deserializeRamps(layout.version);
+                break;
+            case VEHICLE_RESTART_PHASES_SECTION:
+                layout.vehicleRestartPhases = this->deserializeVehicleRestartPhases();
+                break;
+            case FLYING_OBJECTS_SECTION:
+                // flying objects such as airplanes, blimps, etc.
+                layout.flyingObjects = this->deserializeFlyingObjects();
+                break;
+            case ROCKS_SECTION:
+                layout.rocks = this->deserializeRocks();
+                break;
+            case WATER_BLOCKS_SECTION:
+                layout.waterBlocks = this->deserializeWaterBlocks(layout.version);
+                break;
+            case BUDGET_SECTION:
+                // If the version is less than 5, there's some garbage data in front of the budget.
+                if (layout.version < 5) {
+                    this->logWarn("Deserializing garbage data with version under 5");
+                    int count = this->readInt32();
+                    int count2;
+                    for (int i = 0; i < count; i++) {
+                        this->readString();
+                        count2 = this->readInt32();
+                        for (int j = 0; j < count2; j++) {
+                            this->readString();
+                        }
+                    }
+                }
+                layout.budget = this->deserializeBudget();
+                break;
+            case SETTINGS_SECTION:
+                layout.settings = this->deserializeSettings(layout.version);
+                break;
+            case CUSTOM_SHAPES_SECTION:
+                layout.customShapes = this->deserializeCustomShapes(layout.version);
+                break;
+            case WORKSHOP_SECTION:
+                layout.workshop = this->deserializeWorkshop(layout.version);
+                break;
+            case SUPPORT_PILLARS_SECTION:
+                layout.supportPillars = this->deserializeSupportPillars();
+                break;
+            case PILLARS_SECTION:
+                layout.pillars = this->deserializePillars();
+                break;
+            case MOD_DATA_SECTION:
+                // MOD SUPPORT: PTF stores mod data at the end, indicated by a negative version at the start.
+                this->logInfo("Deserializing mod data...");
+                layout.modData = this->deserializePTFModData();
+                break;
+            default:
+                break;
+        }
+    }
+    // Bridges from before version 5 are just joints, edges and pistons.
+    void deserializeLegacyBridge(Bridge &bridge) {
+        // first, we deserialize the joints.
+        int count = this->readInt32();
+        this->logInfo("Bridge joint count: %s", this->intc(count).c_str());
+        for (int i = 0; i < count; i++) {
+            bridge.joints.push_back(this->deserializeJoint());
+        }
+
+        // next, the edges.
+        count = this->readInt32();
+        this->logInfo("Bridge edge count: %s", this->intc(count).c_str());
+        for (int i = 0; i < count; i++) {
+            bridge.edges.push_back(this->deserializeEdge(bridge.version));
+        }
+
+        // last, the pistons.
+        count = this->readInt32();
+        this->logInfo("Bridge piston count: %s", this->intc(count).c_str());
+        for (int i = 0; i < count; i++) {
+            bridge.pistons.push_back(this->deserializePiston(bridge.version));
+        }
+    }
+    // Compressed input can only move forward, so going back means decoding again from the start.
+    void seekTo(uint64_t offset) {
+        this->file.clear();
+        if (Compression::codecForPath(this->path) == Compression::NO_CODEC) {
+            this->file.seekg((std::streamoff)offset);
+            return;
+        }
+        auto position = (uint64_t)this->file.tellg();
+        if (position > offset) {
+            this->file.close();
+            this->file.open(this->path);
+            position = 0;
+        }
+        this->file.skip(offset - position);
+    }
     template<typename T>
     T readAs() {
         T value;
@@ -854,15 +2281,22 @@ private:
         this->file.read(reinterpret_cast<char*>(&value), 4);
         return value;
     }
-    std::string readString() {
+    ArenaString readString() {
         int length = this->readUInt16();
-        char* bytes = this->readBytes(length);
-        std::string str(bytes, length);
-        delete[] bytes;
+        if (this->skimming) {
+            this->file.skip(length);
+            return {};
+        }
+        ArenaString str(length, '\0');
+        this->file.read(str.data(), length);
         return str;
     }
     char** readByteArray() {
         int length = this->readInt32();
+        if (this->skimming && length > 0) {
+            this->file.skip(length);
+            return nullptr;
+        }
         if (length > 0) {
             char** array = new char*[length];
             // equivalent of Buffer.BlockCopy in .NET
@@ -886,7 +2320,7 @@ private:
             isModded = true;
         }
     }
-    std::string getStubKey() {
+    ArenaString getStubKey() {
         // The stub key is the theme of the layout, e.g. "Western"
         return this->readString();
     }
@@ -929,10 +2363,10 @@ private:
         anchor.guid = this->readString();
         return anchor;
     }
-    std::vector<BridgeJoint> deserializeAnchors() {
-        std::vector<BridgeJoint> anchors;
+    ArenaVector<BridgeJoint> deserializeAnchors() {
+        ArenaVector<BridgeJoint> anchors;
         int count = this->readInt32();
-        Utils::log_info_d("Anchor count: %s", U::intc(count).c_str());
+        this->logInfo("Anchor count: %s", this->intc(count).c_str());
         for (int i = 0; i < count; i++) {
             anchors.push_back(this->deserializeAnchor());
         }
@@ -944,10 +2378,10 @@ private:
         phase.guid = this->readString();
         return phase;
     }
-    std::vector<HydraulicPhase> deserializePhases() {
+    ArenaVector<HydraulicPhase> deserializePhases() {
         int count = this->readInt32();
-        Utils::log_info_d("HydraulicPhase count: %s", U::intc(count).c_str());
-        std::vector<HydraulicPhase> phases;
+        this->logInfo("HydraulicPhase count: %s", this->intc(count).c_str());
+        ArenaVector<HydraulicPhase> phases;
         for (int i = 0; i < count; i++) {
             phases.push_back(this->deserializePhase());
         }
@@ -1037,34 +2471,34 @@ private:
         return phase;
     }
     Bridge deserializeBridge() {
-        Utils::log_info_d("Deserializing bridge...");
+        this->logInfo("Deserializing bridge...");
         // Bridges are a pretty large structure, and there's a lot of nested fields.
 
         Bridge bridge{};
         // First, we read the version of the bridge.
         bridge.version = this->readInt32();
         Utils::ensureReasonable(bridge.version, 0, 100, 0, 50);
-        Utils::log_info_d("Bridge version: %s", U::intc(bridge.version).c_str());
+        this->logInfo("Bridge version: %s", this->intc(bridge.version).c_str());
         if (bridge.version > MAX_BRIDGE_VERSION) {
-            Utils::log_warn_d("Bridge saved with a newer version of the bridge format. This may cause problems.");
+            this->logWarn("Bridge saved with a newer version of the bridge format. This may cause problems.");
         }
 
         // If the version is less than 2, we don't have any of the following fields.
         if (bridge.version < 2) {
-            Utils::log_warn_d("Bridge version is less than 2, skipping bridge deserialization.");
+            this->logWarn("Bridge version is less than 2, skipping bridge deserialization.");
             return bridge;
         }
 
         // Next, we read the number of joints, and deserialize them.
         int count = this->readInt32();
-        Utils::log_info_d("Bridge joint count: %s", U::intc(count).c_str());
+        this->logInfo("Bridge joint count: %s", this->intc(count).c_str());
         for (int i = 0; i < count; i++) {
             bridge.joints.push_back(this->deserializeJoint());
         }
 
         // Then, we read the number of edges, and deserialize them.
         count = this->readInt32();
-        Utils::log_info_d("Bridge edge count: %s", U::intc(count).c_str());
+        this->logInfo("Bridge edge count: %s", this->intc(count).c_str());
         for (int i = 0; i < count; i++) {
             bridge.edges.push_back(this->deserializeEdge(bridge.version));
         }
@@ -1072,7 +2506,7 @@ private:
         // If the version is 7 or above, we read the bridge's springs.
         if (bridge.version >= 7) {
             count = this->readInt32();
-            Utils::log_info_d("Bridge spring count: %s", U::intc(count).c_str());
+            this->logInfo("Bridge spring count: %s", this->intc(count).c_str());
             for (int i = 0; i < count; i++) {
                 bridge.springs.push_back(this->deserializeSpring());
             }
@@ -1080,21 +2514,21 @@ private:
 
         // After that, we can read the number of pistons and deserialize them.
         count = this->readInt32();
-        Utils::log_info_d("Bridge piston count: %s", U::intc(count).c_str());
+        this->logInfo("Bridge piston count: %s", this->intc(count).c_str());
         for (int i = 0; i < count; i++) {
             bridge.pistons.push_back(this->deserializePiston(bridge.version));
         }
 
         // Then, we read the hydraulic phases.
         count = this->readInt32();
-        Utils::log_info_d("Bridge hydraulic phase count: %s", U::intc(count).c_str());
+        this->logInfo("Bridge hydraulic phase count: %s", this->intc(count).c_str());
         for (int i = 0; i < count; i++) {
             bridge.phases.push_back(this->deserializeHydraulicControllerPhase(bridge.version));
         }
 
         // if the version is 5, there's some garbage data.
         if (bridge.version == 5) {
-            Utils::log_warn_d("Discarding v5 garbage data.");
+            this->logWarn("Discarding v5 garbage data.");
             count = this->readInt32();
             for (int i = 0; i < count; i++) {
                 this->readString();
@@ -1104,7 +2538,7 @@ private:
         // if the version is 6 or above, we read the anchors.
         if (bridge.version >= 6) {
             count = this->readInt32();
-            Utils::log_info_d("Bridge anchor count: %s", U::intc(count).c_str());
+            this->logInfo("Bridge anchor count: %s", this->intc(count).c_str());
             for (int i = 0; i < count; i++) {
                 bridge.anchors.push_back(this->deserializeAnchor());
             }
@@ -1112,11 +2546,11 @@ private:
 
         // finally if the version is 4 or above and less than 9, there's a random bool at the end.
         if (bridge.version >= 4 && bridge.version < 9) {
-            Utils::log_warn_d("Discarding v4-8 garbage data.");
+            this->logWarn("Discarding v4-8 garbage data.");
             this->readBool();
         }
 
-        Utils::log_info_d("Bridge deserialization complete.");
+        this->logInfo("Bridge deserialization complete.");
         return bridge;
     }
     ZAxisVehicle deserializeZAxisVehicle(int version) {
@@ -1137,10 +2571,10 @@ private:
 
         return vehicle;
     }
-    std::vector<ZAxisVehicle> deserializeZAxisVehicles(int version) {
+    ArenaVector<ZAxisVehicle> deserializeZAxisVehicles(int version) {
         int count = this->readInt32();
-        Utils::log_info_d("ZedAxisVehicle count: %s", U::intc(count).c_str());
-        std::vector<ZAxisVehicle> vehicles;
+        this->logInfo("ZedAxisVehicle count: %s", this->intc(count).c_str());
+        ArenaVector<ZAxisVehicle> vehicles;
         for (int i = 0; i < count; i++) {
             vehicles.push_back(this->deserializeZAxisVehicle(version));
         }
@@ -1175,10 +2609,10 @@ private:
 
         return vehicle;
     }
-    std::vector<Vehicle> deserializeVehicles() {
+    ArenaVector<Vehicle> deserializeVehicles() {
         int count = this->readInt32();
-        Utils::log_info_d("Vehicle count: %s", U::intc(count).c_str());
-        std::vector<Vehicle> vehicles;
+        this->logInfo("Vehicle count: %s", this->intc(count).c_str());
+        ArenaVector<Vehicle> vehicles;
         for (int i = 0; i < count; i++) {
             vehicles.push_back(this->deserializeVehicle());
         }
@@ -1195,10 +2629,10 @@ private:
         trigger.stop_vehicle_guid = this->readString();
         return trigger;
     }
-    std::vector<VehicleStopTrigger> deserializeVehicleStopTriggers() {
+    ArenaVector<VehicleStopTrigger> deserializeVehicleStopTriggers() {
         int count = this->readInt32();
-        Utils::log_info_d("VehicleStopTrigger count: %s", U::intc(count).c_str());
-        std::vector<VehicleStopTrigger> triggers;
+        this->logInfo("VehicleStopTrigger count: %s", this->intc(count).c_str());
+        ArenaVector<VehicleStopTrigger> triggers;
         for (int i = 0; i < count; i++) {
             triggers.push_back(this->deserializeVehicleStopTrigger());
         }
@@ -1211,11 +2645,11 @@ private:
         object.unknown_value = this->readBool();
         return object;
     }
-    std::vector<ThemeObject> deserializeThemeObjects_OBSOLETE() {
+    ArenaVector<ThemeObject> deserializeThemeObjects_OBSOLETE() {
         int count = this->readInt32();
-        Utils::log_warn_d("ThemeObjects are obsolete, consider upgrading the layout version.");
-        Utils::log_info_d("ThemeObject count: %s", U::intc(count).c_str());
-        std::vector<ThemeObject> objects;
+        this->logWarn("ThemeObjects are obsolete, consider upgrading the layout version.");
+        this->logInfo("ThemeObject count: %s", this->intc(count).c_str());
+        ArenaVector<ThemeObject> objects;
         for (int i = 0; i < count; i++) {
             objects.push_back(this->deserializeThemeObject_OBSOLETE());
         }
@@ -1230,7 +2664,7 @@ private:
         }
 
         // what is the point of this
-        std::string text = this->readString();
+        ArenaString text = this->readString();
         if (!text.empty()) {
             unit.guid = text;
         }
@@ -1265,10 +2699,10 @@ private:
         }
         return timeline;
     }
-    std::vector<EventTimeline> deserializeEventTimelines(int version) {
+    ArenaVector<EventTimeline> deserializeEventTimelines(int version) {
         int count = this->readInt32();
-        Utils::log_info_d("EventTimeline count: %s", U::intc(count).c_str());
-        std::vector<EventTimeline> timelines;
+        this->logInfo("EventTimeline count: %s", this->intc(count).c_str());
+        ArenaVector<EventTimeline> timelines;
         for (int i = 0; i < count; i++) {
             timelines.push_back(this->deserializeEventTimeline(version));
         }
@@ -1286,10 +2720,10 @@ private:
         checkpoint.guid = this->readString();
         return checkpoint;
     }
-    std::vector<Checkpoint> deserializeCheckpoints() {
+    ArenaVector<Checkpoint> deserializeCheckpoints() {
         int count = this->readInt32();
-        Utils::log_info_d("Checkpoint count: %s", U::intc(count).c_str());
-        std::vector<Checkpoint> checkpoints;
+        this->logInfo("Checkpoint count: %s", this->intc(count).c_str());
+        ArenaVector<Checkpoint> checkpoints;
         for (int i = 0; i < count; i++) {
             checkpoints.push_back(this->deserializeCheckpoint());
         }
@@ -1310,10 +2744,10 @@ private:
         this->readInt32();
         return platform;
     }
-    std::vector<Platform> deserializePlatforms(int version) {
+    ArenaVector<Platform> deserializePlatforms(int version) {
         int count = this->readInt32();
-        Utils::log_info_d("Platform count: %s", U::intc(count).c_str());
-        std::vector<Platform> platforms;
+        this->logInfo("Platform count: %s", this->intc(count).c_str());
+        ArenaVector<Platform> platforms;
         for (int i = 0; i < count; i++) {
             platforms.push_back(this->deserializePlatform(version));
         }
@@ -1334,10 +2768,10 @@ private:
         }
         return island;
     }
-    std::vector<TerrainIsland> deserializeTerrainIslands(int version) {
+    ArenaVector<TerrainIsland> deserializeTerrainIslands(int version) {
         int count = this->readInt32();
-        Utils::log_info_d("TerrainIsland count: %s", U::intc(count).c_str());
-        std::vector<TerrainIsland> islands;
+        this->logInfo("TerrainIsland count: %s", this->intc(count).c_str());
+        ArenaVector<TerrainIsland> islands;
         for (int i = 0; i < count; i++) {
             islands.push_back(this->deserializeTerrainStretch(version));
         }
@@ -1376,10 +2810,10 @@ private:
 
         return ramp;
     }
-    std::vector<Ramp> deserializeRamps(int version) {
+    ArenaVector<Ramp> deserializeRamps(int version) {
         int count = this->readInt32();
-        Utils::log_info_d("Ramp count: %s", U::intc(count).c_str());
-        std::vector<Ramp> ramps;
+        this->logInfo("Ramp count: %s", this->intc(count).c_str());
+        ArenaVector<Ramp> ramps;
         for (int i = 0; i < count; i++) {
             ramps.push_back(this->deserializeRamp(version));
         }
@@ -1392,10 +2826,10 @@ private:
         phase.vehicle_guid = this->readString();
         return phase;
     }
-    std::vector<VehicleRestartPhase> deserializeVehicleRestartPhases() {
+    ArenaVector<VehicleRestartPhase> deserializeVehicleRestartPhases() {
         int count = this->readInt32();
-        Utils::log_info_d("VehicleRestartPhase count: %s", U::intc(count).c_str());
-        std::vector<VehicleRestartPhase> phases;
+        this->logInfo("VehicleRestartPhase count: %s", this->intc(count).c_str());
+        ArenaVector<VehicleRestartPhase> phases;
         for (int i = 0; i < count; i++) {
             phases.push_back(this->deserializeVehicleRestartPhase());
         }
@@ -1408,10 +2842,10 @@ private:
         object.prefab_name = this->readString();
         return object;
     }
-    std::vector<FlyingObject> deserializeFlyingObjects() {
+    ArenaVector<FlyingObject> deserializeFlyingObjects() {
         int count = this->readInt32();
-        Utils::log_info_d("FlyingObject count: %s", U::intc(count).c_str());
-        std::vector<FlyingObject> objects;
+        this->logInfo("FlyingObject count: %s", this->intc(count).c_str());
+        ArenaVector<FlyingObject> objects;
         for (int i = 0; i < count; i++) {
             objects.push_back(this->deserializeFlyingObject());
         }
@@ -1425,10 +2859,10 @@ private:
         rock.flipped = this->readBool();
         return rock;
     }
-    std::vector<Rock> deserializeRocks() {
+    ArenaVector<Rock> deserializeRocks() {
         int count = this->readInt32();
-        Utils::log_info_d("Rock count: %s", U::intc(count).c_str());
-        std::vector<Rock> rocks;
+        this->logInfo("Rock count: %s", this->intc(count).c_str());
+        ArenaVector<Rock> rocks;
         for (int i = 0; i < count; i++) {
             rocks.push_back(this->deserializeRock());
         }
@@ -1444,10 +2878,10 @@ private:
         }
         return block;
     }
-    std::vector<WaterBlock> deserializeWaterBlocks(int version) {
+    ArenaVector<WaterBlock> deserializeWaterBlocks(int version) {
         int count = this->readInt32();
-        Utils::log_info_d("WaterBlock count: %s", U::intc(count).c_str());
-        std::vector<WaterBlock> blocks;
+        this->logInfo("WaterBlock count: %s", this->intc(count).c_str());
+        ArenaVector<WaterBlock> blocks;
         for (int i = 0; i < count; i++) {
             blocks.push_back(this->deserializeWaterBlock(version));
         }
@@ -1456,7 +2890,7 @@ private:
     Budget deserializeBudget() {
         Budget b{};
         b.cash = this->readInt32();
-        Utils::log_info_d("Budget: $%s", U::intc(b.cash, 0, 100000000, 0, 100000000).c_str());
+        this->logInfo("Budget: $%s", this->intc(b.cash, 0, 100000000, 0, 100000000).c_str());
         b.road = this->readInt32();
         b.wood = this->readInt32();
         b.steel = this->readInt32();
@@ -1477,11 +2911,11 @@ private:
     Settings deserializeSettings(int version) {
         Settings settings{};
         settings.hydraulics_controller_enabled = this->readBool();
-        Utils::log_info_d("Hydraulics controller: %s", settings.hydraulics_controller_enabled ? "\x1B[1;92menabled\x1B[0m" : "\x1B[1;91mdisabled\x1B[0m");
+        this->logInfo("Hydraulics controller: %s", settings.hydraulics_controller_enabled ? "\x1B[1;92menabled\x1B[0m" : "\x1B[1;91mdisabled\x1B[0m");
         settings.unbreakable = this->readBool();
-        Utils::log_info_d("Unbreakable mode: %s", settings.unbreakable ? "\x1B[1;92menabled\x1B[0m" : "\x1B[1;91mdisabled\x1B[0m");
+        this->logInfo("Unbreakable mode: %s", settings.unbreakable ? "\x1B[1;92menabled\x1B[0m" : "\x1B[1;91mdisabled\x1B[0m");
         settings.no_water = (version >= 28 && this->readBool());
-        Utils::log_info_d("No water: %s", settings.no_water ? "\x1B[1;92menabled\x1B[0m" : "\x1B[1;91mdisabled\x1B[0m");
+        this->logInfo("No water: %s", settings.no_water ? "\x1B[1;92menabled\x1B[0m" : "\x1B[1;91mdisabled\x1B[0m");
         return settings;
     }
     CustomShape deserializeCustomShape(int version) {
@@ -1543,10 +2977,10 @@ private:
 
         return s;
     }
-    std::vector<CustomShape> deserializeCustomShapes(int version) {
+    ArenaVector<CustomShape> deserializeCustomShapes(int version) {
         int count = this->readInt32();
-        Utils::log_info_d("Custom shape count: %s", U::intc(count).c_str());
-        std::vector<CustomShape> shapes;
+        this->logInfo("Custom shape count: %s", this->intc(count).c_str());
+        ArenaVector<CustomShape> shapes;
         for (int i = 0; i < count; i++) {
             shapes.push_back(this->deserializeCustomShape(version));
         }
@@ -1555,19 +2989,19 @@ private:
     Workshop deserializeWorkshop(int version) {
         Workshop workshop{};
         workshop.id = this->readString();
-        Utils::log_info_d("Workshop ID: \x1B[1;95m" + workshop.id + "\x1B[0m");
+        this->logInfo("Workshop ID: \x1B[1;95m%s\x1B[0m", workshop.id.c_str());
         if (version >= 16) {
             workshop.leaderboard_id = this->readString();
-            Utils::log_info_d("Workshop leaderboard ID: \x1B[1;95m" + workshop.leaderboard_id + "\x1B[0m");
+            this->logInfo("Workshop leaderboard ID: \x1B[1;95m%s\x1B[0m", workshop.leaderboard_id.c_str());
         }
         workshop.title = this->readString();
-        Utils::log_info_d("Workshop title: \x1B[1;95m" + workshop.title + "\x1B[0m");
+        this->logInfo("Workshop title: \x1B[1;95m%s\x1B[0m", workshop.title.c_str());
         workshop.description = this->readString();
-        Utils::log_info_d("Workshop description: \x1B[1;95m\n" + workshop.description + "\x1B[0m");
+        this->logInfo("Workshop description: \x1B[1;95m\n%s\x1B[0m", workshop.description.c_str());
         workshop.autoplay = this->readBool();
-        Utils::log_info_d("Autoplay: %s", workshop.autoplay ? "\x1B[1;92yes\x1B[0m" : "\x1B[1;91mno\x1B[0m");
+        this->logInfo("Autoplay: %s", workshop.autoplay ? "\x1B[1;92yes\x1B[0m" : "\x1B[1;91mno\x1B[0m");
         int count = this->readInt32();
-        Utils::log_info_d("Tag count: %s", U::intc(count).c_str());
+        this->logInfo("Tag count: %s", this->intc(count).c_str());
         for (int i = 0; i < count; i++) {
             workshop.tags.push_back(this->readString());
         }
@@ -1580,10 +3014,10 @@ private:
         pillar.prefab_name = this->readString();
         return pillar;
     }
-    std::vector<SupportPillar> deserializeSupportPillars() {
+    ArenaVector<SupportPillar> deserializeSupportPillars() {
         int count = this->readInt32();
-        Utils::log_info_d("SupportPillar count: %s", U::intc(count).c_str());
-        std::vector<SupportPillar> pillars;
+        this->logInfo("SupportPillar count: %s", this->intc(count).c_str());
+        ArenaVector<SupportPillar> pillars;
         for (int i = 0; i < count; i++) {
             pillars.push_back(this->deserializeSupportPillar());
         }
@@ -1596,10 +3030,10 @@ private:
         pillar.prefab_name = this->readString();
         return pillar;
     }
-    std::vector<Pillar> deserializePillars() {
+    ArenaVector<Pillar> deserializePillars() {
         int count = this->readInt32();
-        Utils::log_info_d("Pillars count: %s", U::intc(count).c_str());
-        std::vector<Pillar> pillars;
+        this->logInfo("Pillars count: %s", this->intc(count).c_str());
+        ArenaVector<Pillar> pillars;
         for (int i = 0; i < count; i++) {
             pillars.push_back(this->deserializePillar());
         }
@@ -1610,48 +3044,47 @@ private:
         ModData mod_data{};
 
         int count = this->readInt16();
-        Utils::log_info_d("Layout saved with %s mods", U::intc(count).c_str());
+        this->logInfo("Layout saved with %s mods", this->intc(count).c_str());
         for (int i = 0; i < count; i++) {
-            std::string string = this->readString();
-            std::vector<std::string> partsOfMod = Utils::splitString(string, "\u058D");
-            std::string name = !partsOfMod.empty() ? partsOfMod[0] : "";
-            std::string version = partsOfMod.size() >= 2 ? partsOfMod[1] : "";
-            std::string settings = partsOfMod.size() >= 3 ? partsOfMod[2] : "";
+            ArenaString string = this->readString();
+            std::vector<std::string_view> partsOfMod = Utils::splitString(string, "\u058D");
+            ArenaString name(!partsOfMod.empty() ? partsOfMod[0] : "");
+            ArenaString version(partsOfMod.size() >= 2 ? partsOfMod[1] : "");
+            ArenaString settings(partsOfMod.size() >= 3 ? partsOfMod[2] : "");
 
-            Utils::log_info_d("Name: \x1B[1;95m" + name + "\x1B[0m");
-            Utils::log_info_d("Version: \x1B[1;95m" + version + "\x1B[0m");
-            Utils::log_info_d("Settings: \x1B[1;95m" + settings + "\x1B[0m\n");
+            this->logInfo("Name: \x1B[1;95m%s\x1B[0m", name.c_str());
+            this->logInfo("Version: \x1B[1;95m%s\x1B[0m", version.c_str());
+            this->logInfo("Settings: \x1B[1;95m%s\x1B[0m\n", settings.c_str());
 
             mod_data.mods.push_back(Mod{name, version, settings});
         }
 
         // check if that's everything
-        long pos = (long) this->file.tellg();
-        if (pos == this->file.seekg(0, std::ios::end).tellg()) {
+        // (peek rather than seek, compressed input can't seek)
+        if (this->file.peek() == std::char_traits<char>::eof()) {
             return mod_data;
         }
-        this->file.seekg(pos);
 
         // if not, read the save data
         int extraSaveDataCount = this->readInt32();
         if (extraSaveDataCount == 0) return mod_data;
-        Utils::log_info_d("Mod save data count: %s", U::intc(extraSaveDataCount).c_str());
+        this->logInfo("Mod save data count: %s", this->intc(extraSaveDataCount).c_str());
 
         for (int i = 0; i < extraSaveDataCount; i++) {
-            std::string modIdentifier = this->readString();
+            ArenaString modIdentifier = this->readString();
 
-            std::vector<std::string> partsOfMod = Utils::splitString(modIdentifier, "\u058D");
-            std::string name = !partsOfMod.empty() ? partsOfMod[0] : "";
-            std::string version = partsOfMod.size() >= 2 ? partsOfMod[1] : "";
+            std::vector<std::string_view> partsOfMod = Utils::splitString(modIdentifier, "\u058D");
+            ArenaString name(!partsOfMod.empty() ? partsOfMod[0] : "");
+            ArenaString version(partsOfMod.size() >= 2 ? partsOfMod[1] : "");
 
             // if the name is empty, the mod is invalid
             if (name.empty()) {
-                Utils::log_warn_d("Invalid mod identifier: \x1B[1;95m" + modIdentifier + "\x1B[0m");
+                this->logWarn("Invalid mod identifier: \x1B[1;95m%s\x1B[0m", modIdentifier.c_str());
                 continue;
             }
 
-            Utils::log_info_d("Name: \x1B[1;95m" + name + "\x1B[0m");
-            Utils::log_info_d("Version: \x1B[1;95m" + version + "\x1B[0m");
+            this->logInfo("Name: \x1B[1;95m%s\x1B[0m", name.c_str());
+            this->logInfo("Version: \x1B[1;95m%s\x1B[0m", version.c_str());
 
             char *customModSaveData = reinterpret_cast<char *>(this->readByteArray());
 
@@ -1661,36 +3094,194 @@ private:
     }
 };
 
-class Serializer {
+// A layout that is decoded a section at a time, on demand. The header comes from the index (built with one skim
+// pass, or loaded from index_path when it is still valid for this file), and load() seeks straight to a section and
+// decodes only that. Everything not loaded stays empty in layout.
+class LazyLayout {
 public:
-    std::string path;
-    std::ofstream file;
     Layout layout;
-    explicit Serializer(const std::string &filename, const Layout &layout) {
-        this->file = std::ofstream(filename, std::ios::binary | std::ios::out);
-        this->layout = layout;
-        this->path = filename;
 
-        if (!this->file.is_open()) {
-            Utils::log_error_s("Failed to open file for writing: %s", filename.c_str());
-            exit(1);
+    explicit LazyLayout(const std::string &path, const std::string &index_path = "") : deserializer(path) {
+        if (index_path.empty() || !LayoutIndex::load(index_path, this->sectionIndex) || !this->sectionIndex.matches(path)) {
+            this->sectionIndex = this->deserializer.buildIndex();
+            if (!index_path.empty() && !this->sectionIndex.save(index_path)) {
+                U::log_warn("Could not write layout index to %s", index_path.c_str());
+            }
         }
+        this->layout.version = this->sectionIndex.version;
+        this->layout.isModded = this->sectionIndex.isModded;
+        this->layout.stubKey = this->sectionIndex.stubKey;
     }
-    ~Serializer() {
+    const LayoutIndex &index() const {
+        return this->sectionIndex;
+    }
+    // Whether this layout's version has the section at all.
+    bool has(LayoutSection section) const {
+        return this->sectionIndex.offsets[section] >= 0;
+    }
+    Layout &load(LayoutSection section) {
+        if (!this->loaded[section]) {
+            this->deserializer.deserializeSection(this->sectionIndex, section, this->layout);
+            this->loaded[section] = true;
+        }
+        return this->layout;
+    }
+    // Loads several sections in file order, which compressed layouts can do in a single forward pass.
+    Layout &load(const SectionMask &sections) {
+        for (LayoutSection section : layout_sections(this->sectionIndex.version, this->sectionIndex.isModded)) {
+            if (sections[section]) this->load(section);
+        }
+        return this->layout;
+    }
+private:
+    Deserializer deserializer;
+    LayoutIndex sectionIndex;
+    std::array<bool, SECTION_COUNT> loaded{};
+};
+
+// Bridge binary
+//   The bridge is stored the same way inside a layout and as the m_Bridge byte array of a save slot, so it is
+//   written into a buffer that either can embed.
+class BridgeSerializer {
+public:
+    explicit BridgeSerializer(std::string &out) : out(out) {}
+    void serializeBridge(const Bridge &bridge) {
+        this->writeInt32(MAX_BRIDGE_VERSION); // Version
+        U::log_info_s("Serializing bridge version %s", U::intc(MAX_BRIDGE_VERSION).c_str());
+
+        this->writeInt32((int)bridge.joints.size()); // Joint count
+        for (const BridgeJoint &joint : bridge.joints) {
+            this->writeJoint(joint);
+        }
+        U::log_info_s("Serialized %s joints", U::intc((int)bridge.joints.size()).c_str());
+
+        this->writeInt32((int)bridge.edges.size()); // Edge count
+        for (const BridgeEdge &edge : bridge.edges) {
+            this->writeInt32(edge.material_type); // Material type
+            this->writeGuid(edge.node_a_guid); // Node A GUID
+            this->writeGuid(edge.node_b_guid); // Node B GUID
+            this->writeInt32(edge.joint_a_part); // Joint A part
+            this->writeInt32(edge.joint_b_part); // Joint B part
+            this->writeGuid(edge.guid); // GUID (v11+)
+        }
+        U::log_info_s("Serialized %s edges", U::intc((int)bridge.edges.size()).c_str());
+
+        this->writeInt32((int)bridge.springs.size()); // Spring count
+        for (const BridgeSpring &spring : bridge.springs) {
+            this->writeFloat(spring.normalized_value); // Normalized value
+            this->writeGuid(spring.node_a_guid); // Node A GUID
+            this->writeGuid(spring.node_b_guid); // Node B GUID
+            this->writeGuid(spring.guid); // GUID
+        }
+        U::log_info_s("Serialized %s springs", U::intc((int)bridge.springs.size()).c_str());
+
+        this->writeInt32((int)bridge.pistons.size()); // Piston count
+        for (const Piston &piston : bridge.pistons) {
+            this->writeFloat(piston.normalized_value); // Normalized value
+            this->writeGuid(piston.node_a_guid); // Node A GUID
+            this->writeGuid(piston.node_b_guid); // Node B GUID
+            this->writeGuid(piston.guid); // GUID
+        }
+        U::log_info_s("Serialized %s pistons", U::intc((int)bridge.pistons.size()).c_str());
+
+        // Hydraulics controller binary
+        this->writeInt32((int)bridge.phases.size()); // Hydraulics phase count
+        for (const HydraulicsControllerPhase &phase : bridge.phases) {
+            this->writeGuid(phase.hydraulics_phase_guid); // Hydraulics phase GUID
+
+            this->writeInt32((int)phase.piston_guids.size()); // Piston GUID count
+            for (const ArenaString &piston_guid : phase.piston_guids) {
+                this->writeGuid(piston_guid); // Piston GUID
+            }
+
+            this->writeInt32((int)phase.bridge_split_joints.size()); // Bridge split joint count
+            for (const BridgeSplitJoint &bridge_split_joint : phase.bridge_split_joints) {
+                this->writeGuid(bridge_split_joint.guid); // Bridge split joint GUID
+                this->writeInt32(bridge_split_joint.state); // Bridge split joint state
+            }
+            this->writeBool(phase.disable_new_additions);
+        }
+        U::log_info_s("Serialized %s hydraulic phases", U::intc((int)bridge.phases.size()).c_str());
+
+        this->writeInt32((int)bridge.anchors.size()); // Anchor count
+        for (const BridgeJoint &anchor : bridge.anchors) {
+            this->writeJoint(anchor);
+        }
+        U::log_info_s("Serialized %s anchors", U::intc((int)bridge.anchors.size()).c_str());
+    }
+private:
+    std::string &out;
+
+    template<typename T>
+    void writeRaw(T value) {
+        this->out.append(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+    void writeInt32(int32_t value) {
+        this->writeRaw(value);
+    }
+    void writeFloat(float value) {
+        this->writeRaw(value);
+    }
+    void writeBool(bool value) {
+        this->writeRaw(value);
+    }
+    void writeString(std::string_view value) {
+        this->writeRaw((uint16_t)value.length());
+        this->out.append(value);
+    }
+    void writeGuid(std::string_view guid) {
+        char buffer[GuidCodec::TEXT_LENGTH];
+        this->writeString(GuidCodec::canonical(guid, buffer));
+    }
+    void writeJoint(const BridgeJoint &joint) {
+        this->writeFloat(joint.pos.x); // Position
+        this->writeFloat(joint.pos.y);
+        this->writeFloat(joint.pos.z);
+        this->writeBool(joint.is_anchor); // Is anchor
+        this->writeBool(joint.is_split); // Is split
+        this->writeGuid(joint.guid); // GUID
+    }
+};
+
+class Serializer {
+public:
+    std::string path;
+    Compression::OutputFile file;
+    Layout layout;
+    explicit Serializer(const std::string &filename, const Layout &layout) {
+        this->file.open(filename);
+        this->layout = layout;
+        this->path = filename;
+
+        if (!this->file.is_open()) {
+            Utils::log_error_s("Failed to open file for writing: %s", filename.c_str());
+            exit(1);
+        }
+    }
+    ~Serializer() {
         this->file.close();
     }
-    void serializeLayout() {
+    // bridge_bytes lets a caller keep the serialized bridge between runs: if it's non-empty it's written as-is,
+    // otherwise the bridge is serialized into it. --watch uses this so an edit that doesn't touch the bridge doesn't
+    // have to re-encode tens of thousands of edges.
+    void serializeLayout(std::string *bridge_bytes = nullptr) {
         this->serializePreBridgeBinary();
-        this->serializeBridgeBinary();
+        this->serializeBridgeBinary(bridge_bytes);
         this->serializePostBridgeBinary();
     }
 private:
     void writeInt32(int32_t value) {
         this->file.write(reinterpret_cast<char *>(&value), sizeof(int32_t));
     }
-    void writeString(const std::string &value) {
+    void writeString(std::string_view value) {
         this->writeUInt16((short)value.length());
-        this->file.write(value.c_str(), (long)value.length());
+        this->file.write(value.data(), (long)value.length());
+    }
+    // GUIDs go out in the lowercase form the game writes, so references that only matched case-insensitively here
+    // (GuidMap parses both sides) match for the game too.
+    void writeGuid(std::string_view guid) {
+        char buffer[GuidCodec::TEXT_LENGTH];
+        this->writeString(GuidCodec::canonical(guid, buffer));
     }
     void writeFloat(float value) {
         this->file.write(reinterpret_cast<char *>(&value), sizeof(float));
@@ -1725,14 +3316,14 @@ private:
         this->writeFloat(value.w);
     }
 
-    Vehicle findVehicleByGuid(const std::string& guid) {
+    Vehicle findVehicleByGuid(const ArenaString &guid) {
         for (auto &vehicle : this->layout.vehicles) {
             if (vehicle.guid == guid) {
                 U::log_info_s("Found vehicle '%s' by GUID %s", vehicle.prefab_name.c_str(), guid.c_str());
                 return vehicle;
             }
         }
-        Utils::log_error_s("Could not find vehicle with GUID \x1B[1;95m" + guid + "\x1B[0m");
+        Utils::log_error_s("Could not find vehicle with GUID \x1B[1;95m%s\x1B[0m", guid.c_str());
         exit(1);
     }
 
@@ -1742,7 +3333,7 @@ private:
             this->writeVector3(anchor.pos);
             this->writeBool(anchor.is_anchor);
             this->writeBool(anchor.is_split);
-            this->writeString(anchor.guid);
+            this->writeGuid(anchor.guid);
         }
         U::log_info_s("Serialized %s anchors", U::intc((int)this->layout.anchors.size()).c_str());
     }
@@ -1750,7 +3341,7 @@ private:
         this->writeInt32((int)this->layout.phases.size());
         for (HydraulicPhase &phase : this->layout.phases) {
             this->writeFloat(phase.time_delay);
-            this->writeString(phase.guid);
+            this->writeGuid(phase.guid);
         }
         U::log_info_s("Serialized %s hydraulic phases", U::intc((int)this->layout.phases.size()).c_str());
     }
@@ -1763,76 +3354,15 @@ private:
         this->serializeHydraulicsPhasesBinary();
         this->file << std::flush;
     }
-    void serializeBridgeBinary() {
-        auto bridge = this->layout.bridge;
-        this->writeInt32(MAX_BRIDGE_VERSION); // Version
-        U::log_info_s("Serializing bridge version %s", U::intc(MAX_BRIDGE_VERSION).c_str());
-
-        this->writeInt32((int)bridge.joints.size()); // Joint count
-        for (const BridgeJoint &joint : bridge.joints) {
-            this->writeVector3(joint.pos); // Position
-            this->writeBool(joint.is_anchor); // Is anchor
-            this->writeBool(joint.is_split); // Is split
-            this->writeString(joint.guid); // GUID
-        }
-        U::log_info_s("Serialized %s joints", U::intc((int)bridge.joints.size()).c_str());
-
-        this->writeInt32((int)bridge.edges.size()); // Edge count
-        for (const BridgeEdge &edge : bridge.edges) {
-            this->writeInt32(edge.material_type); // Material type
-            this->writeString(edge.node_a_guid); // Node A GUID
-            this->writeString(edge.node_b_guid); // Node B GUID
-            this->writeInt32(edge.joint_a_part); // Joint A part
-            this->writeInt32(edge.joint_b_part); // Joint B part
-        }
-        U::log_info_s("Serialized %s edges", U::intc((int)bridge.edges.size()).c_str());
-
-        this->writeInt32((int)bridge.springs.size()); // Spring count
-        for (const BridgeSpring &spring : bridge.springs) {
-            this->writeFloat(spring.normalized_value); // Normalized value
-            this->writeString(spring.node_a_guid); // Node A GUID
-            this->writeString(spring.node_b_guid); // Node B GUID
-            this->writeString(spring.guid); // GUID
-        }
-        U::log_info_s("Serialized %s springs", U::intc((int)bridge.springs.size()).c_str());
-
-        this->writeInt32((int)bridge.pistons.size()); // Piston count
-        for (const Piston &piston : bridge.pistons) {
-            this->writeFloat(piston.normalized_value); // Normalized value
-            this->writeString(piston.node_a_guid); // Node A GUID
-            this->writeString(piston.node_b_guid); // Node B GUID
-            this->writeString(piston.guid); // GUID
-        }
-        U::log_info_s("Serialized %s pistons", U::intc((int)bridge.pistons.size()).c_str());
-
-        // Hydraulics controller binary
-        this->writeInt32((int)bridge.phases.size()); // Hydraulics phase count
-        for (const HydraulicsControllerPhase &phase : bridge.phases) {
-            this->writeString(phase.hydraulics_phase_guid); // Hydraulics phase GUID
-
-            this->writeInt32((int)phase.piston_guids.size()); // Piston GUID count
-            for (const std::string &piston_guid : phase.piston_guids) {
-                this->writeString(piston_guid); // Piston GUID
-            }
-
-            this->writeInt32((int)phase.bridge_split_joints.size()); // Bridge split joint count
-            for (const BridgeSplitJoint &bridge_split_joint : phase.bridge_split_joints) {
-                this->writeString(bridge_split_joint.guid); // Bridge split joint GUID
-                this->writeInt32(bridge_split_joint.state); // Bridge split joint state
-            }
-            this->writeBool(phase.disable_new_additions);
-        }
-        U::log_info_s("Serialized %s hydraulic phases", U::intc((int)bridge.phases.size()).c_str());
-
-        this->writeInt32((int)bridge.anchors.size()); // Anchor count
-        for (const BridgeJoint &anchor : bridge.anchors) {
-            this->writeVector3(anchor.pos); // Position
-            this->writeBool(anchor.is_anchor); // Is anchor
-            this->writeBool(anchor.is_split); // Is split
-            this->writeString(anchor.guid); // GUID
+    void serializeBridgeBinary(std::string *cached) {
+        std::string local;
+        std::string &bytes = cached ? *cached : local;
+        if (bytes.empty()) {
+            BridgeSerializer(bytes).serializeBridge(this->layout.bridge);
+        } else {
+            U::log_info_s("Reused the serialized bridge");
         }
-        U::log_info_s("Serialized %s anchors", U::intc((int)bridge.anchors.size()).c_str());
-
+        this->file.write(bytes.data(), (std::streamsize)bytes.size());
         this->file << std::flush;
     }
     void serializePostBridgeBinary() {
@@ -1841,7 +3371,7 @@ private:
         for (const ZAxisVehicle &vehicle : layout.zAxisVehicles) {
             this->writeVector2(vehicle.pos); // Position
             this->writeString(vehicle.prefab_name); // Prefab name
-            this->writeString(vehicle.guid); // GUID
+            this->writeGuid(vehicle.guid); // GUID
             this->writeFloat(vehicle.time_delay); // Time delay (seconds)
             this->writeFloat(vehicle.speed); // Speed
             this->writeQuaternion(vehicle.rot); // Rotation
@@ -1869,12 +3399,12 @@ private:
             this->writeBool(vehicle.idle_on_downhill); // Idle on downhill
             this->writeBool(vehicle.flipped); // Flipped
             this->writeBool(vehicle.ordered_checkpoints); // Ordered checkpoints
-            this->writeString(vehicle.guid); // GUID
+            this->writeGuid(vehicle.guid); // GUID
 
             Vehicle v = this->findVehicleByGuid(vehicle.guid);
             this->writeInt32((int)v.checkpoint_guids.size()); // Checkpoint count
-            for (const std::string &checkpoint_guid : v.checkpoint_guids) {
-                this->writeString(checkpoint_guid); // Checkpoint GUID
+            for (const ArenaString &checkpoint_guid : v.checkpoint_guids) {
+                this->writeGuid(checkpoint_guid); // Checkpoint GUID
             }
         }
         U::log_info_s("Serialized %s vehicles", U::intc((int)this->layout.vehicles.size()).c_str());
@@ -1888,20 +3418,20 @@ private:
             this->writeFloat(trigger.rotation_degrees); // Rotation degrees
             this->writeBool(trigger.flipped); // Flipped
             this->writeString(trigger.prefab_name); // Prefab name
-            this->writeString(trigger.stop_vehicle_guid); // Stop vehicle GUID
+            this->writeGuid(trigger.stop_vehicle_guid); // Stop vehicle GUID
         }
         U::log_info_s("Serialized %s vehicle stop triggers", U::intc((int)this->layout.vehicleStopTriggers.size()).c_str());
 
         // Timelines
         this->writeInt32((int)this->layout.eventTimelines.size()); // Timeline count
         for (const EventTimeline &timeline : layout.eventTimelines) {
-            this->writeString(timeline.checkpoint_guid); // Checkpoint GUID
+            this->writeGuid(timeline.checkpoint_guid); // Checkpoint GUID
 
             this->writeInt32((int)timeline.stages.size()); // Stage count
             for (const EventStage &stage : timeline.stages) {
                 this->writeInt32((int)stage.units.size()); // Unit count
                 for (const EventUnit &unit : stage.units) {
-                    this->writeString(unit.guid); // GUID
+                    this->writeGuid(unit.guid); // GUID
                 }
             }
         }
@@ -1912,12 +3442,12 @@ private:
         for (const Checkpoint &checkpoint : layout.checkpoints) {
             this->writeVector2(checkpoint.pos); // Position
             this->writeString(checkpoint.prefab_name); // Prefab name
-            this->writeString(checkpoint.vehicle_guid); // Vehicle GUID
-            this->writeString(checkpoint.vehicle_restart_phase_guid); // Vehicle restart phase GUID
+            this->writeGuid(checkpoint.vehicle_guid); // Vehicle GUID
+            this->writeGuid(checkpoint.vehicle_restart_phase_guid); // Vehicle restart phase GUID
             this->writeBool(checkpoint.trigger_timeline); // Trigger timeline
             this->writeBool(checkpoint.stop_vehicle); // Stop vehicle
             this->writeBool(checkpoint.reverse_vehicle_on_restart); // Reverse vehicle on restart
-            this->writeString(checkpoint.guid); // GUID
+            this->writeGuid(checkpoint.guid); // GUID
         }
         U::log_info_s("Serialized %s checkpoints", U::intc((int)this->layout.checkpoints.size()).c_str());
 
@@ -1977,8 +3507,8 @@ private:
         this->writeInt32((int)this->layout.vehicleRestartPhases.size()); // Vehicle restart phase count
         for (const VehicleRestartPhase &phase : layout.vehicleRestartPhases) {
             this->writeFloat(phase.time_delay); // Time delay (seconds)
-            this->writeString(phase.guid); // GUID
-            this->writeString(phase.vehicle_guid); // Vehicle GUID
+            this->writeGuid(phase.guid); // GUID
+            this->writeGuid(phase.vehicle_guid); // Vehicle GUID
         }
         U::log_info_s("Serialized %s vehicle restart phases", U::intc((int)this->layout.vehicleRestartPhases.size()).c_str());
 
@@ -2065,8 +3595,8 @@ private:
             }
 
             this->writeInt32((int)cs.dynamic_anchor_guids.size()); // Dynamic anchor GUID count
-            for (const std::string &dynamic_anchor_guid : cs.dynamic_anchor_guids) {
-                this->writeString(dynamic_anchor_guid); // Dynamic anchor GUID
+            for (const ArenaString &dynamic_anchor_guid : cs.dynamic_anchor_guids) {
+                this->writeGuid(dynamic_anchor_guid); // Dynamic anchor GUID
             }
         }
         U::log_info_s("Serialized %s custom shapes", U::intc((int)this->layout.customShapes.size()).c_str());
@@ -2079,7 +3609,7 @@ private:
         this->writeBool(this->layout.workshop.autoplay); // Autoplay
 
         this->writeInt32((int)this->layout.workshop.tags.size()); // Workshop tag count
-        for (const std::string &tag : this->layout.workshop.tags) {
+        for (const ArenaString &tag : this->layout.workshop.tags) {
             this->writeString(tag); // Tag
         }
         U::log_info_s(
@@ -2152,6 +3682,10 @@ public:
             edge.node_b_guid = this->readString();
             edge.joint_a_part = (SplitJointPart)this->readInt32();
             edge.joint_b_part = (SplitJointPart)this->readInt32();
+            if (bridge.version >= 11) {
+                edge.guid = this->readString();
+            }
+            bridge.edges.push_back(edge);
         }
 
         // Springs in v7+
@@ -2217,6 +3751,7 @@ public:
             if (bridge.version > 9) {
                 phase.disable_new_additions = this->readBool();
             }
+            bridge.phases.push_back(phase);
         }
 
         // Garbage data (v5)
@@ -2282,10 +3817,10 @@ private:
         float value = *reinterpret_cast<float *>(this->readBytes(sizeof(float)));
         return value;
     }
-    std::string readString() {
+    ArenaString readString() {
         int length = this->readUInt16();
         char* data = this->readBytes(length);
-        std::string str(data, length);
+        ArenaString str(data, length);
         delete[] data;
         return str;
     }
@@ -2307,30 +3842,22 @@ private:
 class SlotDeserializer {
 public:
     std::string path;
-    std::ifstream file;
-    explicit SlotDeserializer (const std::string &path) {
+    Compression::InputFile file;
+    std::string nameBuffer;  // backs the names returned by peekEntryType
+    std::string wideBuffer;  // raw UTF-16 bytes of the string being read
+    // read_size sets how much of the file is read at a time; a small one suits deserializeSlotHeader, which only
+    // needs the first few hundred bytes.
+    explicit SlotDeserializer (const std::string &path, std::size_t read_size = 0) {
         this->path = path;
-        this->file.open(path, std::ios::binary);
+        this->file.open(path, read_size);
         if (!this->file.is_open()) {
             U::log_error_s("Failed to open file '%s'", path.c_str());
             exit(1);
         }
     }
-    SaveSlot deserializeSlot() {
-        // So, a bit on how this works:
-        //   This is basically an *extremely* condensed version of OdinSerializer.
-        //   Since we don't have the correct types available to us, we have a custom
-        //   override, which is the BridgeSaveSlotData struct. As this code is only
-        //   meant for a specific purpose, we don't have to deserialize in the
-        //   conventional way. Instead, we just read the data we expect, and ensure
-        //   it's correct, which may mean same name, same type, etc.
-        //   We aren't worrying about nodes here, since we don't need to act like
-        //   this is multilevel data.
-        //   One thing about this format is that it's very type-specific. For example,
-        //   it's not possible to deserialize a string as a float. This is because the
-        //   type, assuming a built-in, is read from a single byte, and ensured it's
-        //   in the BinaryEntryType enum.
-
+    // Reads only the entries in front of the bridge (versions, slot ID, names, budget and last write time), which is
+    // all a slot listing needs. The bridge array and everything after it are never read.
+    SaveSlot deserializeSlotHeader() {
         // create a SaveSlot object
         SaveSlot slot;
 
@@ -2400,6 +3927,26 @@ public:
         U::log_info_d("Save slot last write time: " + U::ticks_to_datetime(last_write_time));
         slot.lastWriteTimeTicks = last_write_time;
 
+        return slot;
+    }
+    SaveSlot deserializeSlot() {
+        // So, a bit on how this works:
+        //   This is basically an *extremely* condensed version of OdinSerializer.
+        //   Since we don't have the correct types available to us, we have a custom
+        //   override, which is the BridgeSaveSlotData struct. As this code is only
+        //   meant for a specific purpose, we don't have to deserialize in the
+        //   conventional way. Instead, we just read the data we expect, and ensure
+        //   it's correct, which may mean same name, same type, etc.
+        //   We aren't worrying about nodes here, since we don't need to act like
+        //   this is multilevel data.
+        //   One thing about this format is that it's very type-specific. For example,
+        //   it's not possible to deserialize a string as a float. This is because the
+        //   type, assuming a built-in, is read from a single byte, and ensured it's
+        //   in the BinaryEntryType enum.
+
+        SaveSlot slot = this->deserializeSlotHeader();
+        EntryTypeReturn et;
+
         // Next, the bridge, which is a bit weird
         // Enter the node
         enterNode();
@@ -2445,9 +3992,11 @@ public:
             num2 = this->readInt();
             num3 = num * num2;
             U::log_info_d("Thumbnail data size: " + U::intc(num3, 0, 10000000, 0, 10000000));
-            char* thumbnail_data = new char[num3];
-            this->file.read(thumbnail_data, num3);
-            slot.thumbnail = thumbnail_data;
+            // only remember where the thumbnail is, see SlotThumbnail
+            slot.thumbnail.path = this->path;
+            slot.thumbnail.offset = (uint64_t)this->file.tellg();
+            slot.thumbnail.size = (uint32_t)num3;
+            this->file.skip(num3);
 
             et = this->peekEntryType();
             assert(et.type == EntryType::EndOfNodeType);
@@ -2487,211 +4036,49 @@ private:
         return i;
     }
     std::string readString() {
+        std::string str;
+        this->readStringInto(str);
+        return str;
+    }
+    // Reads a string entry into out, reusing its storage.
+    void readStringInto(std::string &out) {
+        out.clear();
         int num = this->file.get();
-        if (num < 0) {
-            return "";
-        }
         if (num == 0) {
             int num2 = this->readInt();
-            char* bytes = new char[num2];
-            this->file.read(bytes, num2);
-            std::string str(bytes, num2);
-            delete[] bytes;
-            return str;
-        }
-        if (num == 1) {
+            out.resize(num2);
+            this->file.read(out.data(), num2);
+        } else if (num == 1) {
             int length = this->readInt();
-            std::u16string str(length, '\0');
-            this->file.read((char*)&str[0], length * 2);  // null spaced
-            // convert u16 to u8
-            std::wstring_convert<std::codecvt_utf8_utf16<char16_t>,char16_t> convert;
-            return std::string(convert.to_bytes(str));
+            if (length <= 0) return;
+            // the raw code units go into a reusable scratch buffer and are transcoded straight into out
+            this->wideBuffer.resize((std::size_t)length * 2);
+            this->file.read(this->wideBuffer.data(), (std::streamsize)length * 2);
+            out.resize(Utf16::maxUtf8Length(length));
+            out.resize(Utf16::transcode(this->wideBuffer.data(), length, out.data()));
         }
-        return "";
     }
     EntryTypeReturn peekEntryType() {
         int c = this->file.get();
         if (c == EOF) {
             return EntryTypeReturn{EntryType::EndOfStreamType, ""};
         }
-        auto bt = (BinaryEntryType)c;
-        std::string name;
-
-        switch (bt) {
-            case BinaryEntryType::NamedStartOfReferenceNode:
-            case BinaryEntryType::NamedStartOfStructNode:
-                name = this->readString();
-                return EntryTypeReturn{EntryType::StartOfNode, name};
-                break;
-            case BinaryEntryType::UnnamedStartOfReferenceNode:
-            case BinaryEntryType::UnnamedStartOfStructNode:
-                return EntryTypeReturn{EntryType::StartOfNode, ""};
-                break;
-            case BinaryEntryType::EndOfNode:
-                return EntryTypeReturn{EntryType::EndOfNodeType, ""};
-                break;
-            case BinaryEntryType::StartOfArray:
-                return EntryTypeReturn{EntryType::StartOfArrayType, ""};
-                break;
-            case BinaryEntryType::EndOfArray:
-                return EntryTypeReturn{EntryType::EndOfArrayType, ""};
-                break;
-            case BinaryEntryType::PrimitiveArray:
-                return EntryTypeReturn{EntryType::PrimitiveArrayType, ""};
-                break;
-            case BinaryEntryType::NamedInternalReference:
-                name = this->readString();
-                return EntryTypeReturn{EntryType::InternalReference, name};
-                break;
-            case BinaryEntryType::UnnamedInternalReference:
-                return EntryTypeReturn{EntryType::InternalReference, ""};
-                break;
-            case BinaryEntryType::NamedExternalReferenceByIndex:
-                name = this->readString();
-                return EntryTypeReturn{EntryType::ExternalReferenceByIndex, name};
-                break;
-            case BinaryEntryType::UnnamedExternalReferenceByIndex:
-                return EntryTypeReturn{EntryType::ExternalReferenceByIndex, ""};
-                break;
-            case BinaryEntryType::NamedExternalReferenceByGuid:
-                name = this->readString();
-                return EntryTypeReturn{EntryType::ExternalReferenceByGuid, name};
-                break;
-            case BinaryEntryType::UnnamedExternalReferenceByGuid:
-                return EntryTypeReturn{EntryType::ExternalReferenceByGuid, ""};
-                break;
-            case BinaryEntryType::NamedSByte:
-                name = this->readString();
-                return EntryTypeReturn{EntryType::Integer, name};
-                break;
-            case BinaryEntryType::UnnamedSByte:
-                return EntryTypeReturn{EntryType::Integer, ""};
-                break;
-            case BinaryEntryType::NamedByte:
-                name = this->readString();
-                return EntryTypeReturn{EntryType::Integer, name};
-                break;
-            case BinaryEntryType::UnnamedByte:
-                return EntryTypeReturn{EntryType::Integer, ""};
-                break;
-            case BinaryEntryType::NamedShort:
-                name = this->readString();
-                return EntryTypeReturn{EntryType::Integer, name};
-                break;
-            case BinaryEntryType::UnnamedShort:
-                return EntryTypeReturn{EntryType::Integer, ""};
-                break;
-            case BinaryEntryType::NamedUShort:
-                name = this->readString();
-                return EntryTypeReturn{EntryType::Integer, name};
-                break;
-            case BinaryEntryType::UnnamedUShort:
-                return EntryTypeReturn{EntryType::Integer, ""};
-                break;
-            case BinaryEntryType::NamedInt:
-                name = this->readString();
-                return EntryTypeReturn{EntryType::Integer, name};
-                break;
-            case BinaryEntryType::UnnamedInt:
-                return EntryTypeReturn{EntryType::Integer, ""};
-                break;
-            case BinaryEntryType::NamedUInt:
-                name = this->readString();
-                return EntryTypeReturn{EntryType::Integer, name};
-                break;
-            case BinaryEntryType::UnnamedUInt:
-                return EntryTypeReturn{EntryType::Integer, ""};
-                break;
-            case BinaryEntryType::NamedLong:
-                name = this->readString();
-                return EntryTypeReturn{EntryType::Integer, name};
-                break;
-            case BinaryEntryType::UnnamedLong:
-                return EntryTypeReturn{EntryType::Integer, ""};
-                break;
-            case BinaryEntryType::NamedULong:
-                name = this->readString();
-                return EntryTypeReturn{EntryType::Integer, name};
-                break;
-            case BinaryEntryType::UnnamedULong:
-                return EntryTypeReturn{EntryType::Integer, ""};
-                break;
-            case BinaryEntryType::NamedFloat:
-                name = this->readString();
-                return EntryTypeReturn{EntryType::FloatingPoint, name};
-                break;
-            case BinaryEntryType::UnnamedFloat:
-                return EntryTypeReturn{EntryType::FloatingPoint, ""};
-                break;
-            case BinaryEntryType::NamedDouble:
-                name = this->readString();
-                return EntryTypeReturn{EntryType::FloatingPoint, name};
-                break;
-            case BinaryEntryType::UnnamedDouble:
-                return EntryTypeReturn{EntryType::FloatingPoint, ""};
-                break;
-            case BinaryEntryType::NamedDecimal:
-                name = this->readString();
-                return EntryTypeReturn{EntryType::FloatingPoint, name};
-                break;
-            case BinaryEntryType::UnnamedDecimal:
-                return EntryTypeReturn{EntryType::FloatingPoint, ""};
-                break;
-            case BinaryEntryType::NamedChar:
-                name = this->readString();
-                return EntryTypeReturn{EntryType::String, name};
-                break;
-            case BinaryEntryType::UnnamedChar:
-                return EntryTypeReturn{EntryType::String, ""};
-                break;
-            case BinaryEntryType::NamedString:
-                name = this->readString();
-                return EntryTypeReturn{EntryType::String, name};
-                break;
-            case BinaryEntryType::UnnamedString:
-                return EntryTypeReturn{EntryType::String, ""};
-                break;
-            case BinaryEntryType::NamedGuid:
-                name = this->readString();
-                return EntryTypeReturn{EntryType::Guid, name};
-                break;
-            case BinaryEntryType::UnnamedGuid:
-                return EntryTypeReturn{EntryType::Guid, ""};
-                break;
-            case BinaryEntryType::NamedBoolean:
-                name = this->readString();
-                return EntryTypeReturn{EntryType::Boolean, name};
-                break;
-            case BinaryEntryType::UnnamedBoolean:
-                return EntryTypeReturn{EntryType::Boolean, ""};
-                break;
-            case BinaryEntryType::NamedNull:
-                name = this->readString();
-                return EntryTypeReturn{EntryType::Null, name};
-                break;
-            case BinaryEntryType::UnnamedNull:
-                return EntryTypeReturn{EntryType::Null, ""};
-                break;
-            case BinaryEntryType::TypeName:
-            case BinaryEntryType::TypeID:
+        const EntryDescriptor &entry = ENTRY_DESCRIPTORS[c];
+        if (!entry.peekable) {
+            if (c == BinaryEntryType::TypeName || c == BinaryEntryType::TypeID) {
                 U::log_error_d("BinaryEntryType::TypeName or BinaryEntryType::TypeID cannot be peeked");
                 exit(1);
-                break;
-            case BinaryEntryType::EndOfStream:
-                return EntryTypeReturn{EntryType::EndOfStreamType, ""};
-                break;
-            case BinaryEntryType::NamedExternalReferenceByString:
-                name = this->readString();
-                return EntryTypeReturn{EntryType::ExternalReferenceByString, name};
-                break;
-            case BinaryEntryType::UnnamedExternalReferenceByString:
-                return EntryTypeReturn{EntryType::ExternalReferenceByString, ""};
-                break;
-            default:
-                U::log_error_d("Unknown BinaryEntryType: " + std::to_string(bt));
-                return EntryTypeReturn{EntryType::InvalidType, ""};
-                break;
+            }
+            U::log_error_d("Unknown BinaryEntryType: " + std::to_string(c));
+            return EntryTypeReturn{EntryType::InvalidType, ""};
+        }
+        if (!entry.named) {
+            return EntryTypeReturn{entry.type, ""};
         }
+        // the name is read into a buffer that lives as long as the deserializer, so after the first few entries
+        // it has enough capacity for every name and peeking stops allocating
+        this->readStringInto(this->nameBuffer);
+        return EntryTypeReturn{entry.type, this->nameBuffer};
     }
     TypeEntryReturn readTypeEntry() {
         int num = this->file.get();
@@ -2756,471 +4143,2348 @@ private:
     }
 };
 
-void dump_json(Layout &layout, const std::string& path) {
-    // TODO: make this neater and avoid these repetitive for loops
-    json j;
-    j["m_Version"] = layout.version;
-    j["m_ThemeStubKey"] = layout.stubKey;
-    j["m_Anchors"] = json::array();
-    for (const auto &anchor : layout.anchors) {
-        json anchor_json;
-        anchor_json["m_Pos"]["x"] = anchor.pos.x;
-        anchor_json["m_Pos"]["y"] = anchor.pos.y;
-        anchor_json["m_Pos"]["z"] = anchor.pos.z;
-        anchor_json["m_IsAnchor"] = anchor.is_anchor;
-        anchor_json["m_IsSplit"] = anchor.is_split;
-        anchor_json["m_Guid"] = anchor.guid;
-        j["m_Anchors"].push_back(anchor_json);
-    }
-    j["m_HydraulicPhases"] = json::array();
-    for (const auto &phase : layout.phases) {
-        json phase_json;
-        phase_json["m_TimeDelaySeconds"] = phase.time_delay;
-        phase_json["m_Guid"] = phase.guid;
-        j["m_UndoGuid"] = nullptr;  // For compatibility with PolyConverter
-        j["m_HydraulicPhases"].push_back(phase_json);
-    }
-    auto bridge = j["m_Bridge"];
-    bridge["m_Version"] = layout.bridge.version;
-    bridge["m_BridgeJoints"] = json::array();
-    for (const auto &joint : layout.bridge.joints) {
-        json joint_json;
-        joint_json["m_Pos"]["x"] = joint.pos.x;
-        joint_json["m_Pos"]["y"] = joint.pos.y;
-        joint_json["m_Pos"]["z"] = joint.pos.z;
-        joint_json["m_IsAnchor"] = joint.is_anchor;
-        joint_json["m_IsSplit"] = joint.is_split;
-        joint_json["m_Guid"] = joint.guid;
-        bridge["m_BridgeJoints"].push_back(joint_json);
-    }
-    bridge["m_BridgeEdges"] = json::array();
-    for (const auto &edge : layout.bridge.edges) {
-        json edge_json;
-        edge_json["m_Material"] = edge.material_type;
-        edge_json["m_NodeA_Guid"] = edge.node_a_guid;
-        edge_json["m_NodeB_Guid"] = edge.node_b_guid;
-        edge_json["m_JointAPart"] = edge.joint_a_part;
-        edge_json["m_JointBPart"] = edge.joint_b_part;
-        bridge["m_BridgeEdges"].push_back(edge_json);
-    }
-    bridge["m_BridgeSprings"] = json::array();
-    for (const auto &spring : layout.bridge.springs) {
-        json spring_json;
-        spring_json["m_Guid"] = spring.guid;
-        spring_json["m_NodeA_Guid"] = spring.node_a_guid;
-        spring_json["m_NodeB_Guid"] = spring.node_b_guid;
-        spring_json["m_NormalizedValue"] = spring.normalized_value;
-        bridge["m_BridgeSprings"].push_back(spring_json);
-    }
-    bridge["m_Pistons"] = json::array();
-    for (const auto &piston : layout.bridge.pistons) {
-        json piston_json;
-        piston_json["m_Guid"] = piston.guid;
-        piston_json["m_NodeA_Guid"] = piston.node_a_guid;
-        piston_json["m_NodeB_Guid"] = piston.node_b_guid;
-        piston_json["m_NormalizedValue"] = piston.normalized_value;
-        bridge["m_Pistons"].push_back(piston_json);
-    }
-    auto phases = bridge["m_HydraulicsController"]["m_Phases"] = json::array();
-    for (const auto &phase : layout.bridge.phases) {
-        json phase_json;
-        phase_json["m_HydraulicsPhaseGuid"] = phase.hydraulics_phase_guid;
-        phase_json["m_PistonGuids"] = phase.piston_guids;
-        phase_json["m_BridgeSplitJoints"] = json::array();
-        for (const auto &joint : phase.bridge_split_joints) {
-            json joint_json;
-            joint_json["m_BridgeJointGuid"] = joint.guid;
-            joint_json["m_SplitJointState"] = joint.state;
-            phase_json["m_BridgeSplitJoints"].push_back(joint_json);
-        }
-        phase_json["m_DisableNewAdditions"] = phase.disable_new_additions;
-        phases.push_back(phase_json);
-    }
-    bridge["m_HydraulicsController"]["m_Phases"] = phases;
-    bridge["m_Anchors"] = json::array();
-    for (const auto &anchor : layout.bridge.anchors) {
-        json anchor_json;
-        anchor_json["m_Guid"] = anchor.guid;
-        anchor_json["m_Pos"]["x"] = anchor.pos.x;
-        anchor_json["m_Pos"]["y"] = anchor.pos.y;
-        anchor_json["m_Pos"]["z"] = anchor.pos.z;
-        anchor_json["m_IsAnchor"] = anchor.is_anchor;
-        anchor_json["m_IsSplit"] = anchor.is_split;
-        bridge["m_Anchors"].push_back(anchor_json);
-    }
-
-    j["m_Bridge"] = bridge;
-
-    j["m_ZedAxisVehicles"] = json::array();
-    for (const auto &zAxisVehicle : layout.zAxisVehicles) {
-        json zAxisVehicle_json;
-        zAxisVehicle_json["m_Guid"] = zAxisVehicle.guid;
-        zAxisVehicle_json["m_Pos"]["x"] = zAxisVehicle.pos.x;
-        zAxisVehicle_json["m_Pos"]["y"] = zAxisVehicle.pos.y;
-        zAxisVehicle_json["m_TimeDelaySeconds"] = zAxisVehicle.time_delay;
-        zAxisVehicle_json["m_PrefabName"] = zAxisVehicle.prefab_name;
-        zAxisVehicle_json["m_Speed"] = zAxisVehicle.speed;
-        zAxisVehicle_json["m_Rot"]["x"] = zAxisVehicle.rot.x;
-        zAxisVehicle_json["m_Rot"]["y"] = zAxisVehicle.rot.y;
-        zAxisVehicle_json["m_Rot"]["z"] = zAxisVehicle.rot.z;
-        zAxisVehicle_json["m_Rot"]["w"] = zAxisVehicle.rot.w;
-        zAxisVehicle_json["m_RotationDegrees"] = zAxisVehicle.rotation_degrees;
-        j["m_ZedAxisVehicles"].push_back(zAxisVehicle_json);
-    }
-
-    j["m_Vehicles"] = json::array();
-    for (const auto &vehicle : layout.vehicles) {
-        json vehicle_json;
-        vehicle_json["m_Guid"] = vehicle.guid;
-        vehicle_json["m_Pos"]["x"] = vehicle.pos.x;
-        vehicle_json["m_Pos"]["y"] = vehicle.pos.y;
-        vehicle_json["m_Rot"]["x"] = vehicle.rot.x;
-        vehicle_json["m_Rot"]["y"] = vehicle.rot.y;
-        vehicle_json["m_Rot"]["z"] = vehicle.rot.z;
-        vehicle_json["m_Rot"]["w"] = vehicle.rot.w;
-        vehicle_json["m_PrefabName"] = vehicle.prefab_name;
-        vehicle_json["m_TimeDelaySeconds"] = vehicle.time_delay;
-        vehicle_json["m_PrefabName"] = vehicle.prefab_name;
-        vehicle_json["m_CheckpointGuids"] = vehicle.checkpoint_guids;
-        vehicle_json["m_Acceleration"] = vehicle.acceleration;
-        vehicle_json["m_Mass"] = vehicle.mass;
-        vehicle_json["m_BrakingForceMultiplier"] = vehicle.braking_force_multiplier;
-        vehicle_json["m_StrengthMethod"] = vehicle.strength_method;
-        vehicle_json["m_MaxSlope"] = vehicle.max_slope;
-        vehicle_json["m_DesiredAcceleration"] = vehicle.desired_acceleration;
-        vehicle_json["m_IdleOnDownhill"] = vehicle.idle_on_downhill;
-        vehicle_json["m_Flipped"] = vehicle.flipped;
-        vehicle_json["m_OrderedCheckpoints"] = vehicle.ordered_checkpoints;
-        vehicle_json["m_DisplayName"] = vehicle.display_name;
-        vehicle_json["m_RotationDegrees"] = vehicle.rotation_degrees;
-        vehicle_json["m_TargetSpeed"] = vehicle.target_speed;
-        vehicle_json["m_UndoGuid"] = nullptr;
-        j["m_Vehicles"].push_back(vehicle_json);
-    }
-
-    j["m_VehicleStopTriggers"] = json::array();
-    for (const auto &stopTrigger : layout.vehicleStopTriggers) {
-        json stop_json;
-        stop_json["m_Pos"]["x"] = stopTrigger.pos.x;
-        stop_json["m_Pos"]["y"] = stopTrigger.pos.y;
-        stop_json["m_Rot"]["x"] = stopTrigger.rot.x;
-        stop_json["m_Rot"]["y"] = stopTrigger.rot.y;
-        stop_json["m_Rot"]["z"] = stopTrigger.rot.z;
-        stop_json["m_Rot"]["w"] = stopTrigger.rot.w;
-        stop_json["m_PrefabName"] = stopTrigger.prefab_name;
-        stop_json["m_Height"] = stopTrigger.height;
-        stop_json["m_RotationDegrees"] = stopTrigger.rotation_degrees;
-        stop_json["m_StopVehicleGuid"] = stopTrigger.stop_vehicle_guid;
-        stop_json["m_Flipped"] = stopTrigger.flipped;
-        stop_json["m_UndoGuid"] = nullptr;
-        j["m_VehicleStopTriggers"].push_back(stop_json);
-    }
-
-    j["m_EventTimelines"] = json::array();
-    for (const auto &timeline : layout.eventTimelines) {
-        json timeline_json;
-        timeline_json["m_CheckpointGuid"] = timeline.checkpoint_guid;
-        timeline_json["m_Stages"] = json::array();
-        for (const auto &stage : timeline.stages) {
-            json stage_json;
-            for (const auto &unit : stage.units) {
-                json unit_json;
-                unit_json["m_Guid"] = unit.guid;
-                stage_json["m_Units"].push_back(unit_json);
-            }
-            timeline_json["m_Stages"].push_back(stage_json);
-        }
-        j["m_EventTimelines"].push_back(timeline_json);
-    }
-
-    j["m_Checkpoints"] = json::array();
-    for (const auto &checkpoint : layout.checkpoints) {
-        json checkpoint_json;
-        checkpoint_json["m_Guid"] = checkpoint.guid;
-        checkpoint_json["m_Pos"]["x"] = checkpoint.pos.x;
-        checkpoint_json["m_Pos"]["y"] = checkpoint.pos.y;
-        checkpoint_json["m_PrefabName"] = checkpoint.prefab_name;
-        checkpoint_json["m_VehicleGuid"] = checkpoint.vehicle_guid;
-        checkpoint_json["m_VehicleRestartPhaseGuid"] = checkpoint.vehicle_restart_phase_guid;
-        checkpoint_json["m_TriggerTimeline"] = checkpoint.trigger_timeline;
-        checkpoint_json["m_StopVehicle"] = checkpoint.stop_vehicle;
-        checkpoint_json["m_ReverseVehicleOnRestart"] = checkpoint.reverse_vehicle_on_restart;
-        checkpoint_json["m_UndoGuid"] = nullptr;
-        j["m_Checkpoints"].push_back(checkpoint_json);
-    }
-
-    j["m_TerrainStretches"] = json::array();
-    for (const auto &stretch : layout.terrainStretches) {
-        json stretch_json;
-        stretch_json["m_Pos"]["x"] = stretch.pos.x;
-        stretch_json["m_Pos"]["y"] = stretch.pos.y;
-        stretch_json["m_Pos"]["z"] = stretch.pos.z;
-        stretch_json["m_PrefabName"] = stretch.prefab_name;
-        stretch_json["m_HeightAdded"] = stretch.height_added;
-        stretch_json["m_RightEdgeWaterHeight"] = stretch.right_edge_water_height;
-        stretch_json["m_TerrainIslandType"] = stretch.terrain_island_type;
-        stretch_json["m_VariantIndex"] = stretch.variant_index;
-        stretch_json["m_Flipped"] = stretch.flipped;
-        stretch_json["m_LockPosition"] = stretch.lock_position;
-        stretch_json["m_Hidden"] = stretch.hidden;
-        stretch_json["m_UndoGuid"] = nullptr;
-        j["m_TerrainStretches"].push_back(stretch_json);
-    }
-
-    j["m_Pillars"] = json::array();
-    for (const auto &pillar : layout.pillars) {
-        json pillar_json;
-        pillar_json["m_Pos"]["x"] = pillar.pos.x;
-        pillar_json["m_Pos"]["y"] = pillar.pos.y;
-        pillar_json["m_Pos"]["z"] = pillar.pos.z;
-        pillar_json["m_PrefabName"] = pillar.prefab_name;
-        pillar_json["m_Height"] = pillar.height;
-        pillar_json["m_UndoGuid"] = nullptr;
-        j["m_Pillars"].push_back(pillar_json);
-    }
-
-    j["m_Platforms"] = json::array();
-    for (const auto &platform : layout.platforms) {
-        json platform_json;
-        platform_json["m_Pos"]["x"] = platform.pos.x;
-        platform_json["m_Pos"]["y"] = platform.pos.y;
-        platform_json["m_Height"] = platform.height;
-        platform_json["m_Width"] = platform.width;
-        platform_json["m_Flipped"] = platform.flipped;
-        platform_json["m_Solid"] = platform.solid;
-        platform_json["m_UndoGuid"] = nullptr;
-        j["m_Platforms"].push_back(platform_json);
-    }
-
-    j["m_Ramps"] = json::array();
-    for (const auto &ramp : layout.ramps) {
-        json ramp_json;
-        ramp_json["m_Pos"]["x"] = ramp.pos.x;
-        ramp_json["m_Pos"]["y"] = ramp.pos.y;
-        ramp_json["m_Height"] = ramp.height;
-        ramp_json["m_FlippedVertical"] = ramp.flipped_vertical;
-        ramp_json["m_FlippedHorizontal"] = ramp.flipped_horizontal;
-        ramp_json["m_FlippedLegs"] = ramp.flipped_legs;
-        ramp_json["m_HideLegs"] = ramp.hide_legs;
-        ramp_json["m_SplineType"] = ramp.spline_type;
-        ramp_json["m_NumSegments"] = ramp.num_segments;
-        ramp_json["m_UndoGuid"] = nullptr;
-        for (Vec2 pos : ramp.control_points) {
-            json point_json;
-            point_json["x"] = pos.x;
-            point_json["y"] = pos.y;
-            ramp_json["m_ControlPoints"].push_back(point_json);
-        }
-        for (Vec2 pos : ramp.line_points) {
-            json point_json;
-            point_json["x"] = pos.x;
-            point_json["y"] = pos.y;
-            ramp_json["m_LinePoints"].push_back(point_json);
-        }
-        j["m_Ramps"].push_back(ramp_json);
-    }
-
-    j["m_VehicleRestartPhases"] = json::array();
-    for (const auto &phase : layout.vehicleRestartPhases) {
-        json phase_json;
-        phase_json["m_Guid"] = phase.guid;
-        phase_json["m_VehicleGuid"] = phase.vehicle_guid;
-        phase_json["m_TimeDelaySeconds"] = phase.time_delay;
-        phase_json["m_UndoGuid"] = nullptr;
-        j["m_VehicleRestartPhases"].push_back(phase_json);
-    }
-
-    j["m_FlyingObjects"] = json::array();
-    for (const auto &object : layout.flyingObjects) {
-        json object_json;
-        object_json["m_Pos"]["x"] = object.pos.x;
-        object_json["m_Pos"]["y"] = object.pos.y;
-        object_json["m_Pos"]["z"] = object.pos.z;
-        object_json["m_Scale"]["x"] = object.scale.x;
-        object_json["m_Scale"]["y"] = object.scale.y;
-        object_json["m_Scale"]["z"] = object.scale.z;
-        object_json["m_PrefabName"] = object.prefab_name;
-        object_json["m_UndoGuid"] = nullptr;
-        j["m_FlyingObjects"].push_back(object_json);
-    }
-
-    j["m_Rocks"] = json::array();
-    for (const auto &rock : layout.rocks) {
-        json rock_json;
-        rock_json["m_Pos"]["x"] = rock.pos.x;
-        rock_json["m_Pos"]["y"] = rock.pos.y;
-        rock_json["m_Pos"]["z"] = rock.pos.z;
-        rock_json["m_Scale"]["x"] = rock.scale.x;
-        rock_json["m_Scale"]["y"] = rock.scale.y;
-        rock_json["m_Scale"]["z"] = rock.scale.z;
-        rock_json["m_PrefabName"] = rock.prefab_name;
-        rock_json["m_Flipped"] = rock.flipped;
-        rock_json["m_UndoGuid"] = nullptr;
-        j["m_Rocks"].push_back(rock_json);
-    }
-
-    j["m_SupportPillars"] = json::array();
-    for (const auto &pillar : layout.supportPillars) {
-        json pillar_json;
-        pillar_json["m_Pos"]["x"] = pillar.pos.x;
-        pillar_json["m_Pos"]["y"] = pillar.pos.y;
-        pillar_json["m_Pos"]["z"] = pillar.pos.z;
-        pillar_json["m_Scale"]["x"] = pillar.scale.x;
-        pillar_json["m_Scale"]["y"] = pillar.scale.y;
-        pillar_json["m_Scale"]["z"] = pillar.scale.z;
-        pillar_json["m_PrefabName"] = pillar.prefab_name;
-        pillar_json["m_UndoGuid"] = nullptr;
-        j["m_SupportPillars"].push_back(pillar_json);
-    }
-
-    j["m_WaterBlocks"] = json::array();
-    for (const auto &water : layout.waterBlocks) {
-        json water_json;
-        water_json["m_Pos"]["x"] = water.pos.x;
-        water_json["m_Pos"]["y"] = water.pos.y;
-        water_json["m_Pos"]["z"] = water.pos.z;
-        water_json["m_Width"] = water.width;
-        water_json["m_Height"] = water.height;
-        water_json["m_LockPosition"] = water.lock_position;
-        water_json["m_UndoGuid"] = nullptr;
-        j["m_WaterBlocks"].push_back(water_json);
-    }
-
-    j["m_CustomShapes"] = json::array();
-    for (const auto &shape : layout.customShapes) {
-        json shape_json;
-        shape_json["m_Pos"]["x"] = shape.pos.x;
-        shape_json["m_Pos"]["y"] = shape.pos.y;
-        shape_json["m_Pos"]["z"] = shape.pos.z;
-
-        shape_json["m_Scale"]["x"] = shape.scale.x;
-        shape_json["m_Scale"]["y"] = shape.scale.y;
-        shape_json["m_Scale"]["z"] = shape.scale.z;
-
-        shape_json["m_Rot"]["x"] = shape.rot.x;
-        shape_json["m_Rot"]["y"] = shape.rot.y;
-        shape_json["m_Rot"]["z"] = shape.rot.z;
-        shape_json["m_Rot"]["w"] = shape.rot.w;
-
-        shape_json["m_Color"]["r"] = shape.color.r;
-        shape_json["m_Color"]["g"] = shape.color.g;
-        shape_json["m_Color"]["b"] = shape.color.b;
-        shape_json["m_Color"]["a"] = shape.color.a;
-
-        shape_json["m_Flipped"] = shape.flipped;
-        shape_json["m_CollidesWithRoad"] = shape.collides_with_road;
-        shape_json["m_CollidesWithNodes"] = shape.collides_with_nodes;
-        shape_json["m_CollidesWithSplitNodes"] = shape.collides_with_split_nodes;
-        shape_json["m_Dynamic"] = shape.dynamic;
-        shape_json["m_RotationDegrees"] = shape.rotation_degrees;
-        shape_json["m_Mass"] = shape.mass;
-        shape_json["m_Bounciness"] = shape.bounciness;
-        shape_json["m_PinMotorStrength"] = shape.pin_motor_strength;
-        shape_json["m_PinTargetVelocity"] = shape.pin_target_velocity;
-
-        shape_json["m_PointsLocalSpace"] = json::array();
-        for (const Vec2 &point : shape.points_local_space) {
-            json point_json;
-            point_json["x"] = point.x;
-            point_json["y"] = point.y;
-            shape_json["m_PointsLocalSpace"].push_back(point_json);
-        }
-
-        shape_json["m_StaticPins"] = json::array();
-        for (const Vec3 &point : shape.static_pins) {
-            json point_json;
-            point_json["x"] = point.x;
-            point_json["y"] = point.y;
-            point_json["z"] = point.z;
-            shape_json["m_StaticPins"].push_back(point_json);
-        }
-
-        shape_json["m_DynamicAnchorGuids"] = json::array();
-        for (const std::string &guid : shape.dynamic_anchor_guids) {
-            shape_json["m_DynamicAnchorGuids"].push_back(guid);
-        }
-
-        shape_json["m_UndoGuid"] = nullptr;
-        j["m_CustomShapes"].push_back(shape_json);
+// Writes a save slot back out in the OdinSerializer binary format SlotDeserializer reads: an unnamed
+// BridgeSaveSlotData reference node holding named primitive entries, with the bridge and thumbnail as byte[]
+// reference nodes of primitive arrays. Everything is assembled in one buffer, with the bridge serialized straight
+// into its array (the length is patched in afterwards), and written to the file in a single call.
+class SlotSerializer {
+public:
+    std::string path;
+    Compression::OutputFile file;
+    SaveSlot slot;
+    explicit SlotSerializer(const std::string &filename, const SaveSlot &slot) {
+        this->file.open(filename);
+        this->slot = slot;
+        this->path = filename;
+
+        if (!this->file.is_open()) {
+            Utils::log_error_s("Failed to open file for writing: %s", filename.c_str());
+            exit(1);
+        }
     }
-    auto budget = j["m_Budget"];
-    budget["m_CashBudget"] = layout.budget.cash;
-    budget["m_RoadBudget"] = layout.budget.road;
-    budget["m_WoodBudget"] = layout.budget.wood;
-    budget["m_SteelBudget"] = layout.budget.steel;
-    budget["m_HydraulicBudget"] = layout.budget.hydraulics;
-    budget["m_RopeBudget"] = layout.budget.rope;
-    budget["m_CableBudget"] = layout.budget.cable;
-    budget["m_SpringBudget"] = layout.budget.spring;
-    budget["m_BungieRopeBudget"] = layout.budget.bungee_rope;
-    budget["m_AllowWood"] = layout.budget.allow_wood;
-    budget["m_AllowSteel"] = layout.budget.allow_steel;
-    budget["m_AllowHydraulic"] = layout.budget.allow_hydraulics;
-    budget["m_AllowRope"] = layout.budget.allow_rope;
-    budget["m_AllowCable"] = layout.budget.allow_cable;
-    budget["m_AllowSpring"] = layout.budget.allow_spring;
-    budget["m_AllowReinforcedRoad"] = layout.budget.allow_reinforced_road;
-    j["m_Budget"] = budget;
-
-    j["m_Settings"]["m_HydraulicControllerEnabled"] = layout.settings.hydraulics_controller_enabled;
-    j["m_Settings"]["m_Unbreakable"] = layout.settings.unbreakable;
-    j["m_Settings"]["m_NoWater"] = layout.settings.no_water;
+    ~SlotSerializer() {
+        this->file.close();
+    }
+    void serializeSlot() {
+        this->beginNode(nullptr, "BridgeSaveSlotData, Assembly-CSharp");
+        this->writeNamedInt("m_Version", this->slot.version);
+        this->writeNamedInt("m_PhysicsVersion", this->slot.physicsVersion);
+        this->writeNamedInt("m_SlotID", this->slot.slotId);
+        this->writeNamedString("m_DisplayName", this->slot.displayName);
+        this->writeNamedString("m_SlotFilename", this->slot.fileName);
+        this->writeNamedInt("m_Budget", this->slot.budget);
+        this->writeNamedLong("m_LastWriteTimeTicks", this->slot.lastWriteTimeTicks);
+
+        this->beginNode("m_Bridge", "System.Byte[], mscorlib");
+        std::size_t header = this->beginByteArray();
+        BridgeSerializer(this->buffer).serializeBridge(this->slot.bridge);
+        this->endByteArray(header);
+        this->endNode();
+        U::log_info_s("Serialized bridge data of size %s", U::intc((int)(this->buffer.size() - header - 8), 0, 100000000, 0, 100000000).c_str());
+
+        if (this->slot.thumbnail.size > 0) {
+            this->beginNode("m_Thumb", "System.Byte[], mscorlib");
+            std::size_t thumb_header = this->beginByteArray();
+            const SlotThumbnail &thumbnail = this->slot.thumbnail;
+            if (!Compression::readRange(thumbnail.path, thumbnail.offset, thumbnail.size, this->buffer)) {
+                U::log_error("Failed to read the thumbnail from %s", thumbnail.path.c_str());
+                exit(1);
+            }
+            this->endByteArray(thumb_header);
+            this->endNode();
+        } else {
+            this->writeEntry(BinaryEntryType::NamedNull, "m_Thumb");
+        }
 
-    auto workshop = j["m_Workshop"];
-    workshop["m_Id"] = layout.workshop.id;
-    workshop["m_LeaderboardId"] = layout.workshop.leaderboard_id;
-    workshop["m_Title"] = layout.workshop.title;
-    workshop["m_Description"] = layout.workshop.description;
-    workshop["m_AutoPlay"] = layout.workshop.autoplay;
-    workshop["m_Tags"] = layout.workshop.tags;
+        this->writeNamedBool("m_UsingUnlimitedMaterials", this->slot.unlimitedMaterials);
+        this->writeNamedBool("m_UsingUnlimitedBudget", this->slot.unlimitedBudget);
+        this->endNode();
 
-    j["m_Workshop"] = workshop;
+        this->file.write(this->buffer.data(), (std::streamsize)this->buffer.size());
+    }
+private:
+    std::string buffer;
+    std::vector<std::string> types;  // type names already written, a type's index is its ID
+    int32_t next_node_id = 0;
 
-    // Mod support
-    j["ext_Mods"] = json::array();
-    for (auto &m : layout.modData.mods) {
-        json mod;
-        mod["name"] = m.name;
-        mod["version"] = m.version;
-        mod["settings"] = m.settings;
-        j["ext_Mods"].push_back(mod);
-    }
-    for (auto &md : layout.modData.mod_save_data) {
-        json mod;
-        mod["name"] = md.name;
-        mod["version"] = md.version;
-        if (md.data != nullptr) {
-            mod["base64_encoded_data"] = macaron::Base64::Encode(md.data);
+    template<typename T>
+    void writeRaw(T value) {
+        this->buffer.append(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+    // Odin strings: a 0 flag and one byte per char when every char is ASCII, otherwise a 1 flag and UTF-16.
+    void writeString(std::string_view value) {
+        bool ascii = std::all_of(value.begin(), value.end(), [](char c) { return (unsigned char)c < 0x80; });
+        if (ascii) {
+            this->writeRaw((uint8_t)0);
+            this->writeRaw((int32_t)value.size());
+            this->buffer.append(value);
+            return;
+        }
+        std::u16string wide = utf8ToUtf16(value);
+        this->writeRaw((uint8_t)1);
+        this->writeRaw((int32_t)wide.size());
+        for (char16_t c : wide) this->writeRaw((uint16_t)c);
+    }
+    static std::u16string utf8ToUtf16(std::string_view value) {
+        std::u16string out;
+        out.reserve(value.size());
+        for (std::size_t i = 0; i < value.size();) {
+            auto lead = (unsigned char)value[i];
+            int extra = lead >= 0xF0 ? 3 : lead >= 0xE0 ? 2 : lead >= 0xC0 ? 1 : 0;
+            uint32_t cp = extra == 0 ? lead : lead & (0x3F >> extra);
+            if (i + extra >= value.size()) extra = (int)(value.size() - i - 1);  // truncated sequence
+            for (int k = 1; k <= extra; k++) cp = cp << 6 | ((unsigned char)value[i + k] & 0x3F);
+            i += extra + 1;
+            if (cp >= 0x10000) {
+                cp -= 0x10000;
+                out += (char16_t)(0xD800 + (cp >> 10));
+                out += (char16_t)(0xDC00 + (cp & 0x3FF));
+            } else {
+                out += (char16_t)cp;
+            }
+        }
+        return out;
+    }
+    void writeEntry(BinaryEntryType type, const char *name) {
+        this->writeRaw((uint8_t)type);
+        if (name != nullptr) this->writeString(name);
+    }
+    void writeNamedInt(const char *name, int32_t value) {
+        this->writeEntry(BinaryEntryType::NamedInt, name);
+        this->writeRaw(value);
+    }
+    void writeNamedLong(const char *name, int64_t value) {
+        this->writeEntry(BinaryEntryType::NamedLong, name);
+        this->writeRaw(value);
+    }
+    void writeNamedString(const char *name, std::string_view value) {
+        this->writeEntry(BinaryEntryType::NamedString, name);
+        this->writeString(value);
+    }
+    void writeNamedBool(const char *name, bool value) {
+        this->writeEntry(BinaryEntryType::NamedBoolean, name);
+        this->writeRaw((uint8_t)value);
+    }
+    // Reference node header: entry, type (by name the first time, by ID after that) and node ID.
+    void beginNode(const char *name, const std::string &type) {
+        this->writeEntry(name != nullptr ? BinaryEntryType::NamedStartOfReferenceNode
+                                         : BinaryEntryType::UnnamedStartOfReferenceNode, name);
+        auto it = std::find(this->types.begin(), this->types.end(), type);
+        if (it != this->types.end()) {
+            this->writeRaw((uint8_t)BinaryEntryType::TypeID);
+            this->writeRaw((int32_t)(it - this->types.begin()));
         } else {
-            mod["base64_encoded_data"] = "";
+            this->writeRaw((uint8_t)BinaryEntryType::TypeName);
+            this->writeRaw((int32_t)this->types.size());
+            this->writeString(type);
+            this->types.push_back(type);
         }
-        j["ext_ModSaveData"].push_back(mod);
+        this->writeRaw(this->next_node_id++);
+    }
+    void endNode() {
+        this->writeRaw((uint8_t)BinaryEntryType::EndOfNode);
+    }
+    // Primitive byte array: element count and element size, then the bytes. Returns where the count goes.
+    std::size_t beginByteArray() {
+        this->writeRaw((uint8_t)BinaryEntryType::PrimitiveArray);
+        std::size_t header = this->buffer.size();
+        this->writeRaw((int32_t)0);
+        this->writeRaw((int32_t)1);
+        return header;
+    }
+    void endByteArray(std::size_t header) {
+        auto count = (int32_t)(this->buffer.size() - header - 8);
+        std::memcpy(&this->buffer[header], &count, sizeof(count));
+    }
+};
+
+// Resolved bridge graph
+//   Edges, springs and pistons refer to their endpoints by GUID. BridgeGraph::resolve turns those into indices once,
+//   so consumers can walk the structure without hashing strings. Joint indices cover Bridge::joints followed by
+//   Bridge::anchors; an endpoint that matches neither is -1 and gets listed in `dangling`.
+enum BridgeMemberType {
+    EDGE_MEMBER,
+    SPRING_MEMBER,
+    PISTON_MEMBER
+};
+constexpr const char *BRIDGE_MEMBER_NAMES[] = {"edge", "spring", "piston"};
+struct DanglingReference {
+    BridgeMemberType member_type;
+    int32_t member_index;  // index into Bridge::edges, Bridge::springs or Bridge::pistons
+    bool node_b;  // false for node A
+    ArenaString guid;
+};
+// GUID -> index. Well-formed GUIDs are looked up by their 16 byte form; anything else falls back to the text.
+class GuidMap {
+public:
+    void reserve(std::size_t count) {
+        this->index.reserve(count);
+    }
+    // add() for a whole list, with indices counting up from first. The GUIDs are parsed in one pass.
+    void addAll(const ArenaVector<std::string_view> &guids, int32_t first) {
+        ArenaVector<BinaryGuid> binary(guids.size());
+        std::unique_ptr<bool[]> valid(new bool[guids.size()]);
+        GuidCodec::parseAll(guids, binary.data(), valid.get());
+        for (std::size_t i = 0; i < guids.size(); i++) {
+            if (valid[i]) {
+                this->index.emplace(binary[i], first + (int32_t)i);
+            } else {
+                this->malformed.emplace(guids[i], first + (int32_t)i);
+            }
+        }
+    }
+    // The first index added for a GUID wins.
+    void add(std::string_view guid, int32_t i) {
+        BinaryGuid binary;
+        if (GuidCodec::parse(guid, binary)) {
+            this->index.emplace(binary, i);
+        } else {
+            this->malformed.emplace(guid, i);
+        }
+    }
+    int32_t find(std::string_view guid) const {
+        BinaryGuid binary;
+        if (GuidCodec::parse(guid, binary)) {
+            auto it = this->index.find(binary);
+            return it != this->index.end() ? it->second : -1;
+        }
+        auto it = this->malformed.find(guid);
+        return it != this->malformed.end() ? it->second : -1;
+    }
+private:
+    std::unordered_map<BinaryGuid, int32_t, BinaryGuidHash> index;
+    std::unordered_map<std::string_view, int32_t> malformed;  // views into the caller's strings, which must outlive this
+};
+// Joint indices cover Bridge::joints followed by Bridge::anchors.
+class JointIndex {
+public:
+    explicit JointIndex(const Bridge &bridge) {
+        ArenaVector<std::string_view> guids;
+        guids.reserve(bridge.joints.size() + bridge.anchors.size());
+        for (const BridgeJoint &joint : bridge.joints) guids.push_back(joint.guid);
+        for (const BridgeJoint &anchor : bridge.anchors) guids.push_back(anchor.guid);
+        this->index.reserve(guids.size());
+        this->index.addAll(guids, 0);
+    }
+    int32_t find(std::string_view guid) const {
+        return this->index.find(guid);
+    }
+private:
+    GuidMap index;
+};
+struct BridgeGraph {
+    std::size_t joint_count{};
+    std::size_t anchor_offset{};  // first index belonging to Bridge::anchors
+    ArenaVector<int32_t> edge_a;
+    ArenaVector<int32_t> edge_b;
+    ArenaVector<int32_t> spring_a;
+    ArenaVector<int32_t> spring_b;
+    ArenaVector<int32_t> piston_a;
+    ArenaVector<int32_t> piston_b;
+    ArenaVector<DanglingReference> dangling;
+    // CSR adjacency: the neighbours of joint i are adjacency[adjacency_offsets[i] .. adjacency_offsets[i + 1]),
+    // and adjacency_member holds the connecting member as an index into edges, then springs, then pistons.
+    ArenaVector<int32_t> adjacency_offsets;
+    ArenaVector<int32_t> adjacency;
+    ArenaVector<int32_t> adjacency_member;
+
+    static BridgeGraph resolve(const Bridge &bridge) {
+        BridgeGraph graph;
+        graph.anchor_offset = bridge.joints.size();
+        graph.joint_count = bridge.joints.size() + bridge.anchors.size();
+        JointIndex index(bridge);
+
+        auto resolveMember = [&graph, &index](BridgeMemberType type, int32_t i, const ArenaString &a_guid,
+                                              const ArenaString &b_guid, ArenaVector<int32_t> &a,
+                                              ArenaVector<int32_t> &b) {
+            a.push_back(index.find(a_guid));
+            b.push_back(index.find(b_guid));
+            if (a.back() < 0) graph.dangling.push_back(DanglingReference{type, i, false, a_guid});
+            if (b.back() < 0) graph.dangling.push_back(DanglingReference{type, i, true, b_guid});
+        };
+        graph.edge_a.reserve(bridge.edges.size());
+        graph.edge_b.reserve(bridge.edges.size());
+        for (std::size_t i = 0; i < bridge.edges.size(); i++) {
+            const BridgeEdge &edge = bridge.edges[i];
+            resolveMember(EDGE_MEMBER, (int32_t)i, edge.node_a_guid, edge.node_b_guid, graph.edge_a, graph.edge_b);
+        }
+        for (std::size_t i = 0; i < bridge.springs.size(); i++) {
+            const BridgeSpring &spring = bridge.springs[i];
+            resolveMember(SPRING_MEMBER, (int32_t)i, spring.node_a_guid, spring.node_b_guid, graph.spring_a, graph.spring_b);
+        }
+        for (std::size_t i = 0; i < bridge.pistons.size(); i++) {
+            const Piston &piston = bridge.pistons[i];
+            resolveMember(PISTON_MEMBER, (int32_t)i, piston.node_a_guid, piston.node_b_guid, graph.piston_a, graph.piston_b);
+        }
+
+        graph.buildAdjacency();
+        return graph;
+    }
+    std::size_t memberCount() const {
+        return this->edge_a.size() + this->spring_a.size() + this->piston_a.size();
+    }
+    int32_t degree(std::size_t joint) const {
+        return this->adjacency_offsets[joint + 1] - this->adjacency_offsets[joint];
+    }
+    const int32_t* neighboursBegin(std::size_t joint) const {
+        return this->adjacency.data() + this->adjacency_offsets[joint];
+    }
+    const int32_t* neighboursEnd(std::size_t joint) const {
+        return this->adjacency.data() + this->adjacency_offsets[joint + 1];
+    }
+    // Marks, per joint, whether some chain of members connects it to one of sources: a breadth-first walk of the
+    // adjacency.
+    ArenaVector<uint8_t> reachableFrom(const ArenaVector<int32_t> &sources) const {
+        ArenaVector<uint8_t> reached;
+        reached.assign(this->joint_count, 0);
+        ArenaVector<int32_t> queue;
+        queue.reserve(this->joint_count);
+        for (int32_t joint : sources) {
+            if (reached[joint]) continue;
+            reached[joint] = 1;
+            queue.push_back(joint);
+        }
+        for (std::size_t head = 0; head < queue.size(); head++) {
+            for (const int32_t *n = this->neighboursBegin(queue[head]); n != this->neighboursEnd(queue[head]); n++) {
+                if (reached[*n]) continue;
+                reached[*n] = 1;
+                queue.push_back(*n);
+            }
+        }
+        return reached;
+    }
+private:
+    template<typename F>
+    void forEachMember(F f) const {
+        int32_t member = 0;
+        for (std::size_t i = 0; i < this->edge_a.size(); i++) f(member++, this->edge_a[i], this->edge_b[i]);
+        for (std::size_t i = 0; i < this->spring_a.size(); i++) f(member++, this->spring_a[i], this->spring_b[i]);
+        for (std::size_t i = 0; i < this->piston_a.size(); i++) f(member++, this->piston_a[i], this->piston_b[i]);
+    }
+    void buildAdjacency() {
+        // Counting pass, prefix sum, then fill; members with a dangling endpoint are left out.
+        this->adjacency_offsets.assign(this->joint_count + 1, 0);
+        this->forEachMember([this](int32_t, int32_t a, int32_t b) {
+            if (a < 0 || b < 0) return;
+            this->adjacency_offsets[a + 1]++;
+            this->adjacency_offsets[b + 1]++;
+        });
+        for (std::size_t i = 0; i < this->joint_count; i++) {
+            this->adjacency_offsets[i + 1] += this->adjacency_offsets[i];
+        }
+        this->adjacency.resize(this->adjacency_offsets[this->joint_count]);
+        this->adjacency_member.resize(this->adjacency.size());
+        ArenaVector<int32_t> cursor(this->adjacency_offsets.begin(), this->adjacency_offsets.end() - 1);
+        this->forEachMember([this, &cursor](int32_t member, int32_t a, int32_t b) {
+            if (a < 0 || b < 0) return;
+            this->adjacency[cursor[a]] = b;
+            this->adjacency_member[cursor[a]++] = member;
+            this->adjacency[cursor[b]] = a;
+            this->adjacency_member[cursor[b]++] = member;
+        });
+    }
+};
+
+// Structure-of-arrays view of a bridge
+//   BridgeJoint and BridgeEdge interleave positions with GUID strings, so any pass over geometry strides over
+//   heap pointers. This flattens the bridge into parallel arrays that tight loops can stream through.
+//   Joint and edge indices follow BridgeGraph.
+struct Bounds {
+    Vec3 min{};
+    Vec3 max{};
+};
+struct BridgeSoA {
+    std::size_t joint_count{};
+    ArenaVector<float> x;
+    ArenaVector<float> y;
+    ArenaVector<float> z;
+    ArenaVector<uint64_t> anchor_flags;  // bitset, one bit per joint
+    ArenaVector<uint64_t> split_flags;   // ^ ^ ^
+    ArenaVector<int32_t> material;  // BridgeMaterialType per edge
+    ArenaVector<int32_t> node_a;
+    ArenaVector<int32_t> node_b;
+
+    static BridgeSoA fromBridge(const Bridge &bridge) {
+        return fromBridge(bridge, BridgeGraph::resolve(bridge));
+    }
+    static BridgeSoA fromBridge(const Bridge &bridge, const BridgeGraph &graph) {
+        BridgeSoA soa;
+        soa.joint_count = graph.joint_count;
+        soa.x.reserve(soa.joint_count);
+        soa.y.reserve(soa.joint_count);
+        soa.z.reserve(soa.joint_count);
+        soa.anchor_flags.assign((soa.joint_count + 63) / 64, 0);
+        soa.split_flags.assign((soa.joint_count + 63) / 64, 0);
+
+        auto addJoint = [&soa](const BridgeJoint &joint) {
+            auto i = soa.x.size();
+            soa.x.push_back(joint.pos.x);
+            soa.y.push_back(joint.pos.y);
+            soa.z.push_back(joint.pos.z);
+            soa.anchor_flags[i >> 6] |= (uint64_t)joint.is_anchor << (i & 63);
+            soa.split_flags[i >> 6] |= (uint64_t)joint.is_split << (i & 63);
+        };
+        for (const BridgeJoint &joint : bridge.joints) addJoint(joint);
+        for (const BridgeJoint &anchor : bridge.anchors) addJoint(anchor);
+
+        soa.material.reserve(bridge.edges.size());
+        for (const BridgeEdge &edge : bridge.edges) {
+            soa.material.push_back(edge.material_type);
+        }
+        soa.node_a = graph.edge_a;
+        soa.node_b = graph.edge_b;
+        return soa;
+    }
+    bool isAnchor(std::size_t joint) const {
+        return (this->anchor_flags[joint >> 6] >> (joint & 63)) & 1;
+    }
+    bool isSplit(std::size_t joint) const {
+        return (this->split_flags[joint >> 6] >> (joint & 63)) & 1;
+    }
+    Bounds bounds() const {
+        if (this->joint_count == 0) return Bounds{};
+        Bounds b{{this->x[0], this->y[0], this->z[0]}, {this->x[0], this->y[0], this->z[0]}};
+        for (std::size_t i = 1; i < this->joint_count; i++) {
+            b.min.x = std::min(b.min.x, this->x[i]);
+            b.max.x = std::max(b.max.x, this->x[i]);
+        }
+        for (std::size_t i = 1; i < this->joint_count; i++) {
+            b.min.y = std::min(b.min.y, this->y[i]);
+            b.max.y = std::max(b.max.y, this->y[i]);
+        }
+        for (std::size_t i = 1; i < this->joint_count; i++) {
+            b.min.z = std::min(b.min.z, this->z[i]);
+            b.max.z = std::max(b.max.z, this->z[i]);
+        }
+        return b;
+    }
+    // Writes one length per edge into out (which must hold material.size() floats); dangling edges get 0.
+    // With AVX2, eight edges at a time gather their endpoints straight from the position arrays.
+    void edgeLengths(float *out) const {
+        std::size_t done = 0;
+#ifdef POLYPARSER_X86_TARGETS
+        if (GuidCodec::hasAVX2()) done = this->edgeLengthsAVX2(out);
+#endif
+        this->edgeLengthsScalar(out, done);
+    }
+    float totalEdgeLength() const {
+        ArenaVector<float> lengths(this->material.size());
+        this->edgeLengths(lengths.data());
+        float total = 0.0f;
+        for (float length : lengths) total += length;
+        return total;
+    }
+private:
+    void edgeLengthsScalar(float *out, std::size_t start) const {
+        const std::size_t count = this->material.size();
+        for (std::size_t i = start; i < count; i++) {
+            int32_t a = this->node_a[i];
+            int32_t b = this->node_b[i];
+            if (a < 0 || b < 0) {
+                out[i] = 0.0f;
+                continue;
+            }
+            float dx = this->x[b] - this->x[a];
+            float dy = this->y[b] - this->y[a];
+            float dz = this->z[b] - this->z[a];
+            out[i] = std::sqrt(dx * dx + dy * dy + dz * dz);
+        }
+    }
+#ifdef POLYPARSER_X86_TARGETS
+    // Returns how many edges it did, a multiple of eight; the scalar loop finishes the rest. Lanes with a dangling
+    // endpoint are masked out of the gathers and come out as 0, same as in the scalar loop.
+    __attribute__((target("avx2"))) std::size_t edgeLengthsAVX2(float *out) const {
+        const std::size_t count = this->material.size();
+        const __m256 zero = _mm256_setzero_ps();
+        std::size_t i = 0;
+        for (; i + 8 <= count; i += 8) {
+            __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(this->node_a.data() + i));
+            __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(this->node_b.data() + i));
+            __m256 valid = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_or_si256(a, b), _mm256_set1_epi32(-1)));
+            __m256 dx = _mm256_sub_ps(_mm256_mask_i32gather_ps(zero, this->x.data(), b, valid, 4),
+                                      _mm256_mask_i32gather_ps(zero, this->x.data(), a, valid, 4));
+            __m256 dy = _mm256_sub_ps(_mm256_mask_i32gather_ps(zero, this->y.data(), b, valid, 4),
+                                      _mm256_mask_i32gather_ps(zero, this->y.data(), a, valid, 4));
+            __m256 dz = _mm256_sub_ps(_mm256_mask_i32gather_ps(zero, this->z.data(), b, valid, 4),
+                                      _mm256_mask_i32gather_ps(zero, this->z.data(), a, valid, 4));
+            __m256 squared = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+            _mm256_storeu_ps(out + i, _mm256_sqrt_ps(squared));
+        }
+        return i;
+    }
+#endif
+};
+
+// Spatial index
+//   Positioned objects are otherwise only found by scanning their lists, which makes any "what is near this" check
+//   over a whole level O(n·m). SpatialIndex::build buckets them into a uniform grid over the x/y plane once, after
+//   parsing: a range query only looks at the cells a box touches, and a nearest query searches outwards from the
+//   point ring by ring. Joints, terrain stretches and rocks are points. Custom shapes are a box around their outline
+//   at any rotation, and platforms and water blocks reach width and height to either side of pos, since where pos
+//   sits on them isn't stored. Boxes are therefore conservative, good for finding candidates to test exactly.
+//   Objects with a non-finite position aren't indexed.
+enum SpatialObjectType {
+    JOINT_OBJECT,  // index follows BridgeGraph: Bridge::joints, then Bridge::anchors
+    TERRAIN_OBJECT,
+    ROCK_OBJECT,
+    CUSTOM_SHAPE_OBJECT,
+    WATER_BLOCK_OBJECT,
+    PLATFORM_OBJECT
+};
+constexpr int32_t SPATIAL_OBJECT_TYPES = 6;
+constexpr uint32_t ALL_SPATIAL_OBJECTS = 0x3F;  // one bit per SpatialObjectType
+constexpr const char *SPATIAL_OBJECT_NAMES[] = {"joint", "terrainStretch", "rock", "customShape", "waterBlock", "platform"};
+struct SpatialObject {
+    SpatialObjectType type;
+    int32_t index;  // into the list of that type, -1 when nothing was found
+};
+struct Rect {
+    Vec2 min{};
+    Vec2 max{};
+};
+class SpatialIndex {
+public:
+    static SpatialIndex build(const Layout &layout) {
+        SpatialIndex index;
+        auto addPoint = [&index](SpatialObjectType type, std::size_t i, float x, float y) {
+            index.add(type, i, Rect{{x, y}, {x, y}});
+        };
+        auto addBox = [&index](SpatialObjectType type, std::size_t i, float x, float y, float half_width, float half_height) {
+            index.add(type, i, Rect{{x - half_width, y - half_height}, {x + half_width, y + half_height}});
+        };
+        std::size_t joint = 0;
+        for (const BridgeJoint &j : layout.bridge.joints) addPoint(JOINT_OBJECT, joint++, j.pos.x, j.pos.y);
+        for (const BridgeJoint &j : layout.bridge.anchors) addPoint(JOINT_OBJECT, joint++, j.pos.x, j.pos.y);
+        for (std::size_t i = 0; i < layout.terrainStretches.size(); i++) {
+            addPoint(TERRAIN_OBJECT, i, layout.terrainStretches[i].pos.x, layout.terrainStretches[i].pos.y);
+        }
+        for (std::size_t i = 0; i < layout.rocks.size(); i++) {
+            addPoint(ROCK_OBJECT, i, layout.rocks[i].pos.x, layout.rocks[i].pos.y);
+        }
+        for (std::size_t i = 0; i < layout.customShapes.size(); i++) {
+            const CustomShape &shape = layout.customShapes[i];
+            float radius = 0.0f;
+            for (const Vec2 &p : shape.points_local_space) {
+                radius = std::max(radius, std::hypot(p.x * shape.scale.x, p.y * shape.scale.y));
+            }
+            addBox(CUSTOM_SHAPE_OBJECT, i, shape.pos.x, shape.pos.y, radius, radius);
+        }
+        for (std::size_t i = 0; i < layout.waterBlocks.size(); i++) {
+            const WaterBlock &water = layout.waterBlocks[i];
+            addBox(WATER_BLOCK_OBJECT, i, water.pos.x, water.pos.y, std::abs(water.width), std::abs(water.height));
+        }
+        for (std::size_t i = 0; i < layout.platforms.size(); i++) {
+            const Platform &platform = layout.platforms[i];
+            addBox(PLATFORM_OBJECT, i, platform.pos.x, platform.pos.y, std::abs(platform.width), std::abs(platform.height));
+        }
+        index.buildGrid();
+        return index;
+    }
+
+    std::size_t size() const {
+        return this->objects.size();
+    }
+    // Every object of the given types (a mask of 1 << SpatialObjectType) whose box overlaps [min, max], each once.
+    ArenaVector<SpatialObject> range(Vec2 min, Vec2 max, uint32_t types = ALL_SPATIAL_OBJECTS) const {
+        ArenaVector<SpatialObject> found;
+        if (this->objects.empty() || !(min.x <= max.x) || !(min.y <= max.y)) return found;
+        int32_t x0 = this->cellX(min.x), x1 = this->cellX(max.x);
+        int32_t y0 = this->cellY(min.y), y1 = this->cellY(max.y);
+        for (int32_t cy = y0; cy <= y1; cy++) {
+            for (int32_t cx = x0; cx <= x1; cx++) {
+                int32_t cell = cy * this->columns + cx;
+                for (int32_t k = this->cell_offsets[cell]; k < this->cell_offsets[cell + 1]; k++) {
+                    int32_t i = this->cell_objects[k];
+                    const Rect &b = this->bounds[i];
+                    if (!(types >> this->objects[i].type & 1)) continue;
+                    if (!overlaps(b, min, max)) continue;
+                    // An object spanning several cells is reported by the first one both boxes share.
+                    if (this->cellX(std::max(b.min.x, min.x)) != cx || this->cellY(std::max(b.min.y, min.y)) != cy) continue;
+                    found.push_back(this->objects[i]);
+                }
+            }
+        }
+        return found;
+    }
+    // The object of the given types whose box is closest to p (distance 0 when p is inside it); ties go to the one
+    // indexed first. Its distance is written to *distance when that isn't null.
+    SpatialObject nearest(Vec2 p, uint32_t types = ALL_SPATIAL_OBJECTS, float *distance = nullptr) const {
+        SpatialObject best{JOINT_OBJECT, -1};
+        int32_t best_i = -1;
+        float best_squared = std::numeric_limits<float>::infinity();
+        if (!this->objects.empty() && std::isfinite(p.x) && std::isfinite(p.y)) {
+            int32_t px = this->cellX(p.x), py = this->cellY(p.y);
+            int32_t rings = std::max({px, py, this->columns - 1 - px, this->rows - 1 - py});
+            auto consider = [&](int32_t i) {
+                float squared = squaredDistance(this->bounds[i], p);
+                if (squared < best_squared || (squared == best_squared && i < best_i)) {
+                    best_squared = squared;
+                    best_i = i;
+                }
+            };
+            // When the wanted types are sparse (a couple of terrain stretches among thousands of joints), the rings
+            // can cover most of the grid before reaching one; once more cells were visited than there are objects of
+            // those types, looking at just those objects is cheaper.
+            int32_t candidates = 0;
+            for (int32_t type = 0; type < SPATIAL_OBJECT_TYPES; type++) {
+                if (types >> type & 1) candidates += this->type_offsets[type + 1] - this->type_offsets[type];
+            }
+            int32_t visited = 0;
+            auto visit = [&](int32_t cx, int32_t cy) {
+                if (cx < 0 || cy < 0 || cx >= this->columns || cy >= this->rows) return;
+                visited++;
+                int32_t cell = cy * this->columns + cx;
+                for (int32_t k = this->cell_offsets[cell]; k < this->cell_offsets[cell + 1]; k++) {
+                    int32_t i = this->cell_objects[k];
+                    if (types >> this->objects[i].type & 1) consider(i);
+                }
+            };
+            for (int32_t r = 0; r <= rings; r++) {
+                if (visited > candidates) {
+                    for (int32_t type = 0; type < SPATIAL_OBJECT_TYPES; type++) {
+                        if (!(types >> type & 1)) continue;
+                        for (int32_t k = this->type_offsets[type]; k < this->type_offsets[type + 1]; k++) consider(this->type_objects[k]);
+                    }
+                    break;
+                }
+                if (r == 0) {
+                    visit(px, py);
+                } else {
+                    for (int32_t cx = px - r; cx <= px + r; cx++) {
+                        visit(cx, py - r);
+                        visit(cx, py + r);
+                    }
+                    for (int32_t cy = py - r + 1; cy <= py + r - 1; cy++) {
+                        visit(px - r, cy);
+                        visit(px + r, cy);
+                    }
+                }
+                // Anything in a further ring is at least r cells away from p (or from where p meets the grid).
+                float reach = (float)r * this->cell_size;
+                if (best_i >= 0 && best_squared <= reach * reach) break;
+            }
+        }
+        if (best_i >= 0) best = this->objects[best_i];
+        if (distance) *distance = std::sqrt(best_squared);
+        return best;
+    }
+    // range and nearest done by looking at every object, which is what the grid queries must agree with.
+    ArenaVector<SpatialObject> scanRange(Vec2 min, Vec2 max, uint32_t types = ALL_SPATIAL_OBJECTS) const {
+        ArenaVector<SpatialObject> found;
+        for (std::size_t i = 0; i < this->objects.size(); i++) {
+            if (types >> this->objects[i].type & 1 && overlaps(this->bounds[i], min, max)) found.push_back(this->objects[i]);
+        }
+        return found;
+    }
+    SpatialObject scanNearest(Vec2 p, uint32_t types = ALL_SPATIAL_OBJECTS, float *distance = nullptr) const {
+        SpatialObject best{JOINT_OBJECT, -1};
+        float best_squared = std::numeric_limits<float>::infinity();
+        if (std::isfinite(p.x) && std::isfinite(p.y)) {
+            for (std::size_t i = 0; i < this->objects.size(); i++) {
+                if (!(types >> this->objects[i].type & 1)) continue;
+                float squared = squaredDistance(this->bounds[i], p);
+                if (squared < best_squared) {
+                    best_squared = squared;
+                    best = this->objects[i];
+                }
+            }
+        }
+        if (distance) *distance = std::sqrt(best_squared);
+        return best;
+    }
+private:
+    ArenaVector<SpatialObject> objects;
+    ArenaVector<Rect> bounds;
+    Vec2 origin{};
+    float cell_size = 1.0f;
+    float inverse_cell_size = 1.0f;
+    int32_t columns = 1;
+    int32_t rows = 1;
+    // CSR like BridgeGraph's adjacency: the objects in cell c are cell_objects[cell_offsets[c] .. cell_offsets[c + 1]).
+    ArenaVector<int32_t> cell_offsets;
+    ArenaVector<int32_t> cell_objects;
+    // The same for types: the objects of type t are type_objects[type_offsets[t] .. type_offsets[t + 1]).
+    int32_t type_offsets[SPATIAL_OBJECT_TYPES + 1]{};
+    ArenaVector<int32_t> type_objects;
+
+    static bool overlaps(const Rect &b, Vec2 min, Vec2 max) {
+        return b.max.x >= min.x && b.min.x <= max.x && b.max.y >= min.y && b.min.y <= max.y;
+    }
+    static float squaredDistance(const Rect &b, Vec2 p) {
+        float dx = std::max({b.min.x - p.x, 0.0f, p.x - b.max.x});
+        float dy = std::max({b.min.y - p.y, 0.0f, p.y - b.max.y});
+        return dx * dx + dy * dy;
+    }
+    void add(SpatialObjectType type, std::size_t i, Rect box) {
+        if (!std::isfinite(box.min.x) || !std::isfinite(box.min.y) || !std::isfinite(box.max.x) || !std::isfinite(box.max.y)) {
+            return;
+        }
+        this->objects.push_back(SpatialObject{type, (int32_t)i});
+        this->bounds.push_back(box);
+    }
+    int32_t cellX(float x) const {
+        float f = (x - this->origin.x) * this->inverse_cell_size;
+        return f > 0.0f ? (int32_t)std::min(f, (float)(this->columns - 1)) : 0;
+    }
+    int32_t cellY(float y) const {
+        float f = (y - this->origin.y) * this->inverse_cell_size;
+        return f > 0.0f ? (int32_t)std::min(f, (float)(this->rows - 1)) : 0;
+    }
+    void buildGrid() {
+        if (this->objects.empty()) {
+            this->cell_offsets.assign(2, 0);
+            return;
+        }
+        Rect extent = this->bounds[0];
+        for (const Rect &b : this->bounds) {
+            extent.min.x = std::min(extent.min.x, b.min.x);
+            extent.min.y = std::min(extent.min.y, b.min.y);
+            extent.max.x = std::max(extent.max.x, b.max.x);
+            extent.max.y = std::max(extent.max.y, b.max.y);
+        }
+        // Square cells, about two objects each, and never more cells than objects allow for.
+        double width = std::max((double)extent.max.x - extent.min.x, 1e-3);
+        double height = std::max((double)extent.max.y - extent.min.y, 1e-3);
+        double cells = std::max(1.0, (double)this->objects.size() / 2.0);
+        double side = std::sqrt(width * height / cells);
+        side = std::max({side, width / 4096.0, height / 4096.0});
+        this->origin = extent.min;
+        this->cell_size = (float)side;
+        this->inverse_cell_size = (float)(1.0 / side);
+        this->columns = (int32_t)std::clamp(std::ceil(width / side), 1.0, 4096.0);
+        this->rows = (int32_t)std::clamp(std::ceil(height / side), 1.0, 4096.0);
+
+        // Counting pass, prefix sum, then fill.
+        std::size_t cell_count = (std::size_t)this->columns * (std::size_t)this->rows;
+        this->cell_offsets.assign(cell_count + 1, 0);
+        auto forEachCell = [this](const Rect &b, auto &&f) {
+            int32_t x0 = this->cellX(b.min.x), x1 = this->cellX(b.max.x);
+            int32_t y0 = this->cellY(b.min.y), y1 = this->cellY(b.max.y);
+            for (int32_t cy = y0; cy <= y1; cy++) {
+                for (int32_t cx = x0; cx <= x1; cx++) f(cy * this->columns + cx);
+            }
+        };
+        for (const Rect &b : this->bounds) {
+            forEachCell(b, [this](int32_t cell) { this->cell_offsets[cell + 1]++; });
+        }
+        for (std::size_t c = 0; c < cell_count; c++) {
+            this->cell_offsets[c + 1] += this->cell_offsets[c];
+        }
+        this->cell_objects.resize(this->cell_offsets[cell_count]);
+        ArenaVector<int32_t> cursor(this->cell_offsets.begin(), this->cell_offsets.end() - 1);
+        for (std::size_t i = 0; i < this->bounds.size(); i++) {
+            forEachCell(this->bounds[i], [this, &cursor, i](int32_t cell) { this->cell_objects[cursor[cell]++] = (int32_t)i; });
+        }
+
+        for (const SpatialObject &object : this->objects) this->type_offsets[object.type + 1]++;
+        for (int32_t t = 0; t < SPATIAL_OBJECT_TYPES; t++) this->type_offsets[t + 1] += this->type_offsets[t];
+        this->type_objects.resize(this->objects.size());
+        int32_t type_cursor[SPATIAL_OBJECT_TYPES];
+        std::copy(this->type_offsets, this->type_offsets + SPATIAL_OBJECT_TYPES, type_cursor);
+        for (std::size_t i = 0; i < this->objects.size(); i++) this->type_objects[type_cursor[this->objects[i].type]++] = (int32_t)i;
+    }
+};
+
+// Bridge structure
+//   What the cost command reports about how the bridge holds together, from its BridgeGraph: joints that no member
+//   touches, joints that no chain of members connects to an anchor (they would fall as soon as the simulation
+//   starts), and member endpoints that don't resolve to any joint. The extent and total edge length come from the
+//   BridgeSoA reductions. Anchors are Bridge::anchors and any joint flagged as one.
+struct BridgeStructure {
+    int32_t joints{};
+    int32_t members{};
+    int32_t split{};       // split joints
+    int32_t isolated{};    // joints without any member
+    int32_t unanchored{};  // joints not connected to an anchor, isolated ones included
+    Bounds bounds;         // of every joint, all zero without any
+    float length{};        // of every edge, meters
+
+    static BridgeStructure analyze(const BridgeGraph &graph, const BridgeSoA &soa) {
+        BridgeStructure structure;
+        structure.joints = (int32_t)graph.joint_count;
+        structure.members = (int32_t)graph.memberCount();
+        ArenaVector<int32_t> anchors;
+        for (std::size_t i = 0; i < graph.joint_count; i++) {
+            if (i >= graph.anchor_offset || soa.isAnchor(i)) anchors.push_back((int32_t)i);
+        }
+        ArenaVector<uint8_t> anchored = graph.reachableFrom(anchors);
+        for (std::size_t i = 0; i < graph.joint_count; i++) {
+            structure.split += soa.isSplit(i);
+            structure.isolated += graph.degree(i) == 0;
+            structure.unanchored += !anchored[i];
+        }
+        structure.bounds = soa.bounds();
+        structure.length = soa.totalEdgeLength();
+        return structure;
+    }
+};
+
+// Bridge cost
+//   What a bridge costs and how much of each material it uses. Every edge costs its length times the price per
+//   meter of its material; hydraulics and springs are edges too, Bridge::pistons and Bridge::springs only hold their
+//   settings. Lengths come from BridgeSoA::edgeLengths, one pass over the resolved joint indices, and are then added
+//   up per material. A layout's Budget caps the total cost and the meters of each material, and a save slot stores
+//   the cost it was saved with in SaveSlot::budget, so either can be checked against what the bridge really uses.
+constexpr int MATERIAL_COUNT = SPRING + 1;
+// Material names as used by --prices and in cost documents, indexed by BridgeMaterialType.
+constexpr const char *MATERIAL_NAMES[MATERIAL_COUNT] = {
+    "invalid", "road", "reinforcedRoad", "wood", "steel", "hydraulics", "rope", "cable", "bungeeRope", "spring"
+};
+struct MaterialPrices {
+    // Dollars per meter, indexed by BridgeMaterialType. There's no known price for bungee rope and springs, so they
+    // stay out of the cost until --prices gives them one.
+    double per_meter[MATERIAL_COUNT] = {0, 200, 400, 180, 450, 750, 220, 400, 0, 0};
+    bool priced[MATERIAL_COUNT] = {true, true, true, true, true, true, true, true, false, false};
+};
+
+// Parses a comma separated list of prices per meter, e.g. "road=200,steel=450"; false on an unknown material or a
+// bad price. Materials that aren't listed keep their price.
+bool parse_price_list(std::string_view list, MaterialPrices &prices) {
+    while (!list.empty()) {
+        std::size_t comma = std::min(list.find(','), list.size());
+        std::string_view entry = list.substr(0, comma);
+        list.remove_prefix(std::min(comma + 1, list.size()));
+        if (entry.empty()) continue;
+        std::size_t equals = entry.find('=');
+        std::string_view name = entry.substr(0, equals);
+        int material = 1;
+        while (material < MATERIAL_COUNT && name != MATERIAL_NAMES[material]) material++;
+        if (material == MATERIAL_COUNT) {
+            U::log_error("Unknown material '%s'", std::string(name).c_str());
+            return false;
+        }
+        double price = 0;
+        std::string_view number = equals == std::string_view::npos ? std::string_view() : entry.substr(equals + 1);
+        auto [end, error] = std::from_chars(number.data(), number.data() + number.size(), price);
+        if (number.empty() || error != std::errc() || end != number.data() + number.size() || !(price >= 0)) {
+            U::log_error("Bad price for %s: '%s'", MATERIAL_NAMES[material], std::string(number).c_str());
+            return false;
+        }
+        prices.per_meter[material] = price;
+        prices.priced[material] = true;
+    }
+    return true;
+}
+
+struct MaterialUsage {
+    int32_t edges{};
+    double length{};  // meters
+    double cost{};
+    bool priced = true;  // false when the material has no price, and cost is 0
+};
+struct BridgeCost {
+    MaterialUsage materials[MATERIAL_COUNT];  // indexed by BridgeMaterialType; unknown materials count as INVALID
+    double total{};
+    int32_t dangling{};  // edges with an endpoint that doesn't resolve, counted with length 0
+    int32_t unpriced{};  // edges of a material without a price, left out of total
+
+    static BridgeCost compute(const Bridge &bridge, const MaterialPrices &prices = {}) {
+        return compute(BridgeSoA::fromBridge(bridge), prices);
+    }
+    static BridgeCost compute(const BridgeSoA &soa, const MaterialPrices &prices = {}) {
+        BridgeCost cost;
+        const std::size_t count = soa.material.size();
+        ArenaVector<float> lengths(count);
+        soa.edgeLengths(lengths.data());
+        for (std::size_t i = 0; i < count; i++) {
+            int32_t material = soa.material[i];
+            if (material < 0 || material >= MATERIAL_COUNT) material = INVALID;
+            cost.materials[material].edges++;
+            cost.materials[material].length += lengths[i];
+            cost.dangling += soa.node_a[i] < 0 || soa.node_b[i] < 0;
+        }
+        for (int material = 0; material < MATERIAL_COUNT; material++) {
+            MaterialUsage &usage = cost.materials[material];
+            usage.priced = prices.priced[material];
+            usage.cost = usage.priced ? usage.length * prices.per_meter[material] : 0.0;
+            cost.total += usage.cost;
+            if (!usage.priced) cost.unpriced += usage.edges;
+        }
+        return cost;
+    }
+};
+
+// The meters of a material a budget allows, or -1 when it has no limit of its own (reinforced road is only
+// switched on or off).
+int32_t material_budget(const Budget &budget, BridgeMaterialType material) {
+    switch (material) {
+        case ROAD: return budget.road;
+        case WOOD: return budget.wood;
+        case STEEL: return budget.steel;
+        case HYDRAULICS: return budget.hydraulics;
+        case ROPE: return budget.rope;
+        case CABLE: return budget.cable;
+        case BUNGINE_ROPE: return budget.bungee_rope;
+        case SPRING: return budget.spring;
+        default: return -1;
+    }
+}
+bool material_allowed(const Budget &budget, BridgeMaterialType material) {
+    switch (material) {
+        case REINFORCED_ROAD: return budget.allow_reinforced_road;
+        case WOOD: return budget.allow_wood;
+        case STEEL: return budget.allow_steel;
+        case HYDRAULICS: return budget.allow_hydraulics;
+        case ROPE: return budget.allow_rope;
+        case CABLE: return budget.allow_cable;
+        case SPRING: return budget.allow_spring;
+        default: return true;
+    }
+}
+
+// How documents are encoded. All of them carry the same keys, so MessagePack, CBOR and YAML consumers see exactly
+// what the JSON would have held.
+enum DocumentFormat {
+    JSON_DOCUMENT,
+    MSGPACK_DOCUMENT,
+    CBOR_DOCUMENT,
+    YAML_DOCUMENT
+};
+
+// File extension for a document format, without the leading dot
+const char* document_extension(DocumentFormat format) {
+    switch (format) {
+        case MSGPACK_DOCUMENT:
+            return "msgpack";
+        case CBOR_DOCUMENT:
+            return "cbor";
+        case YAML_DOCUMENT:
+            return "yaml";
+        default:
+            return "json";
+    }
+}
+
+// Settings shared by the JSON writers.
+struct OutputOptions {
+    int precision = -1;  // decimal places to round floats to, or -1 for the shortest exact representation
+    int indent = 2;      // spaces per nesting level, or -1 for compact output on a single line
+    DocumentFormat format = JSON_DOCUMENT;
+    SectionMask fields = ALL_SECTIONS;  // layout sections to write (the version and stub key are always written)
+};
+
+float round_to_precision(float value, int precision) {
+    double scale = std::pow(10.0, precision);
+    return (float)(std::round((double)value * scale) / scale);
+}
+
+// Quantizes every float in the document. Because dump() prints the shortest text that round-trips each float, the
+// nearest float to a value with N decimal places never prints with more than N.
+void round_json_floats(json &j, int precision) {
+    if (j.is_number_float()) {
+        j = round_to_precision(j.get<float>(), precision);
+    } else if (j.is_structured()) {
+        for (auto &element : j) {
+            round_json_floats(element, precision);
+        }
+    }
+}
+
+// Writes a finished document to path. Every encoder writes straight into the file stream, so the document is
+// never rendered to an intermediate string first.
+void write_json(json &j, const std::string &path, const OutputOptions &options) {
+    if (options.precision >= 0) {
+        round_json_floats(j, options.precision);
+    }
+
+    Compression::OutputFile of(path, options.format == JSON_DOCUMENT ? std::ios::out : std::ios::binary);
+    if (!of.is_open()) {
+        U::log_error("Could not open %s for writing", path.c_str());
+        exit(1);
+    }
+    switch (options.format) {
+        case MSGPACK_DOCUMENT:
+            json::to_msgpack(j, of);
+            break;
+        case CBOR_DOCUMENT:
+            json::to_cbor(j, of);
+            break;
+        default:
+            // operator<< takes its indent from the stream width and treats 0 as compact, but --indent 0 should still
+            // put every value on its own line; only dump() can say that, at the cost of building the text first.
+            if (options.indent == 0) {
+                of << j.dump(0);
+            } else {
+                if (options.indent > 0) {
+                    of << std::setw(options.indent);
+                }
+                of << j;
+            }
+            break;
     }
-
-    std::ofstream of(path, std::ios::out);
-    of << j.dump(2);
     of.close();
 }
 
-Layout load_json(std::string &json_str) {
-    Layout layout;
-    json j = json::parse(json_str);
-    layout.version = j["m_Version"].get<int>();
+// Reads a MessagePack or CBOR document, decoding directly from the (possibly compressed) file.
+json read_binary_document(const std::string &path, DocumentFormat format) {
+    Compression::InputFile in(path);
+    if (!in.is_open()) {
+        U::log_error("Could not open %s", path.c_str());
+        exit(1);
+    }
+    try {
+        return format == MSGPACK_DOCUMENT ? json::from_msgpack(in) : json::from_cbor(in);
+    } catch (const json::exception &e) {
+        U::log_error("Failed to decode %s: %s", path.c_str(), e.what());
+        exit(1);
+    }
+}
 
-    // Bridge
-    auto b = j["m_Bridge"];
+// Document writers
+//   write_layout and write_slot walk the type tree once and describe it as events (key, value, begin/end of
+//   objects and arrays). JsonDomWriter turns those into a json document for the JSON, MessagePack and CBOR
+//   encoders; YamlWriter streams them straight to the output, so no document is built at all. Either way the keys
+//   and their order are the ones below.
+class JsonDomWriter {
+public:
+    json document;
 
-    // Bridge anchors
-    for (auto &a : b["m_Anchors"]) {
-        BridgeJoint anchor;
-        anchor.pos.x = a["m_Pos"]["x"].get<float>();
-        anchor.pos.y = a["m_Pos"]["y"].get<float>();
-        anchor.pos.z = a["m_Pos"]["z"].get<float>();
-        anchor.is_anchor = a["m_IsAnchor"].get<bool>();
-        anchor.is_split = a["m_IsSplit"].get<bool>();
-        anchor.guid = a["m_Guid"].get<std::string>();
-        layout.bridge.anchors.push_back(anchor);
+    void key(std::string_view name) {
+        this->pending_key = name;
+    }
+    void beginObject() {
+        this->stack.push_back(&this->place(json::object()));
+    }
+    void beginArray() {
+        this->stack.push_back(&this->place(json::array()));
+    }
+    void endObject() {
+        this->stack.pop_back();
+    }
+    void endArray() {
+        this->stack.pop_back();
+    }
+    template<typename T>
+    void value(T v) {
+        this->place(json(v));
+    }
+private:
+    // Only the innermost open container is ever added to, so pointers to the others stay valid.
+    std::vector<json*> stack;
+    std::string pending_key;
+
+    json &place(json v) {
+        if (this->stack.empty()) {
+            this->document = std::move(v);
+            return this->document;
+        }
+        json &parent = *this->stack.back();
+        if (parent.is_array()) {
+            parent.push_back(std::move(v));
+            return parent.back();
+        }
+        json &slot = parent[this->pending_key];
+        slot = std::move(v);
+        return slot;
+    }
+};
+
+// Block style YAML, two spaces per level. Strings are only quoted when they would otherwise read back as something
+// else, and floats use the same shortest round-trip text as the JSON output.
+class YamlWriter {
+public:
+    YamlWriter(std::ostream &out, int precision) : out(out), precision(precision) {}
+
+    void key(std::string_view name) {
+        this->pending_key = name;
+    }
+    void beginObject() {
+        this->open(false);
+    }
+    void beginArray() {
+        this->open(true);
+    }
+    void endObject() {
+        this->close();
+    }
+    void endArray() {
+        this->close();
+    }
+    void value(bool v) {
+        this->scalar(v ? "true" : "false");
+    }
+    void value(std::nullptr_t) {
+        this->scalar("null");
+    }
+    void value(int32_t v) {
+        this->value((int64_t)v);
+    }
+    void value(int64_t v) {
+        char text[24];
+        auto result = std::to_chars(text, text + sizeof(text), v);
+        this->scalar(std::string_view(text, result.ptr - text));
+    }
+    void value(float v) {
+        if (this->precision >= 0) v = round_to_precision(v, this->precision);
+        if (std::isnan(v)) return this->scalar(".nan");
+        if (std::isinf(v)) return this->scalar(v < 0 ? "-.inf" : ".inf");
+        char text[32];
+        auto result = std::to_chars(text, text + sizeof(text), v);
+        std::string_view digits(text, result.ptr - text);
+        // keep integral values typed as floats, and give exponents a mantissa with a dot, which YAML 1.1 requires
+        if (digits.find('.') != std::string_view::npos) return this->scalar(digits);
+        std::size_t exponent = std::min(digits.find('e'), digits.size());
+        std::string with_dot(digits.substr(0, exponent));
+        with_dot += ".0";
+        with_dot += digits.substr(exponent);
+        this->scalar(with_dot);
+    }
+    void value(std::string_view v) {
+        if (isPlain(v)) return this->scalar(v);
+        std::string quoted = "\"";
+        for (unsigned char c : v) {
+            switch (c) {
+                case '"': quoted += "\\\""; break;
+                case '\\': quoted += "\\\\"; break;
+                case '\n': quoted += "\\n"; break;
+                case '\r': quoted += "\\r"; break;
+                case '\t': quoted += "\\t"; break;
+                default:
+                    if (c < 0x20 || c == 0x7F) {
+                        char escape[5];
+                        std::snprintf(escape, sizeof(escape), "\\x%02X", c);
+                        quoted += escape;
+                    } else {
+                        quoted += (char)c;
+                    }
+            }
+        }
+        quoted += '"';
+        this->scalar(quoted);
+    }
+    // Ends the document with a newline.
+    void finish() {
+        this->out << '\n';
+    }
+private:
+    struct Frame {
+        bool array;
+        bool empty;
+        bool inline_first;  // the first entry goes on the line of the enclosing "- "
+        std::size_t indent;
+    };
+    std::ostream &out;
+    int precision;
+    std::vector<Frame> stack;
+    std::string pending_key;
+    bool started = false;
+
+    static bool isPlain(std::string_view v) {
+        if (v.empty()) return false;
+        if (GuidCodec::isValid(v)) return true;  // hex and hyphens never read as anything but a string
+        if (!std::isalpha((unsigned char)v[0]) && v[0] != '_') return false;
+        if (v.back() == ' ') return false;
+        for (char c : v) {
+            if (!std::isalnum((unsigned char)c) && c != '_' && c != '-' && c != '.' && c != '/' && c != ' ') return false;
+        }
+        // words YAML resolves to booleans or null
+        static const char *reserved[] = {"true", "false", "yes", "no", "on", "off", "null", "y", "n"};
+        for (const char *word : reserved) {
+            if (v.size() == std::strlen(word) && std::equal(v.begin(), v.end(), word, [](char a, char b) {
+                return std::tolower((unsigned char)a) == b;
+            })) return false;
+        }
+        return true;
+    }
+    // Writes the "key:" or "-" that introduces the next node of the innermost container.
+    void startNode() {
+        if (this->stack.empty()) return;
+        Frame &frame = this->stack.back();
+        if (frame.empty && frame.inline_first) {
+            this->out << ' ';
+        } else {
+            if (this->started) this->out << '\n';
+            this->out << std::string(frame.indent, ' ');
+        }
+        this->started = true;
+        frame.empty = false;
+        if (frame.array) {
+            this->out << '-';
+        } else {
+            this->out << this->pending_key << ':';
+        }
+    }
+    void scalar(std::string_view text) {
+        this->startNode();
+        if (!this->stack.empty()) this->out << ' ';
+        this->out << text;
+        this->started = true;
+    }
+    void open(bool array) {
+        bool in_array = !this->stack.empty() && this->stack.back().array;
+        this->startNode();
+        std::size_t indent = this->stack.empty() ? 0 : this->stack.back().indent + 2;
+        this->stack.push_back(Frame{array, true, in_array, indent});
+    }
+    void close() {
+        Frame frame = this->stack.back();
+        this->stack.pop_back();
+        if (frame.empty) {
+            if (this->stack.empty()) {
+                this->out << (frame.array ? "[]" : "{}");
+            } else {
+                this->out << (frame.array ? " []" : " {}");
+            }
+            this->started = true;
+        }
+    }
+};
+
+template<typename Writer>
+void write_vec2(Writer &w, std::string_view key, const Vec2 &v) {
+    w.key(key);
+    w.beginObject();
+    w.key("x"); w.value(v.x);
+    w.key("y"); w.value(v.y);
+    w.endObject();
+}
+
+template<typename Writer>
+void write_vec3(Writer &w, std::string_view key, const Vec3 &v) {
+    w.key(key);
+    w.beginObject();
+    w.key("x"); w.value(v.x);
+    w.key("y"); w.value(v.y);
+    w.key("z"); w.value(v.z);
+    w.endObject();
+}
+
+template<typename Writer>
+void write_quaternion(Writer &w, std::string_view key, const Quaternion &q) {
+    w.key(key);
+    w.beginObject();
+    w.key("x"); w.value(q.x);
+    w.key("y"); w.value(q.y);
+    w.key("z"); w.value(q.z);
+    w.key("w"); w.value(q.w);
+    w.endObject();
+}
+
+template<typename Writer>
+void write_strings(Writer &w, std::string_view key, const ArenaVector<ArenaString> &strings) {
+    w.key(key);
+    w.beginArray();
+    for (const ArenaString &s : strings) w.value(std::string_view(s));
+    w.endArray();
+}
+
+// A joint as it appears in m_BridgeJoints and the layout's m_Anchors; the bridge's own m_Anchors put the GUID first.
+template<typename Writer>
+void write_joint(Writer &w, const BridgeJoint &joint, bool guid_first) {
+    w.beginObject();
+    if (guid_first) {
+        w.key("m_Guid"); w.value(std::string_view(joint.guid));
+    }
+    write_vec3(w, "m_Pos", joint.pos);
+    w.key("m_IsAnchor"); w.value(joint.is_anchor);
+    w.key("m_IsSplit"); w.value(joint.is_split);
+    if (!guid_first) {
+        w.key("m_Guid"); w.value(std::string_view(joint.guid));
+    }
+    w.endObject();
+}
+
+template<typename Writer>
+void write_layout(Writer &w, const Layout &layout, const SectionMask &fields = ALL_SECTIONS) {
+    w.beginObject();
+    w.key("m_Version"); w.value((int32_t)layout.version);
+    w.key("m_ThemeStubKey"); w.value(std::string_view(layout.stubKey));
+
+    if (fields[ANCHORS_SECTION]) {
+        w.key("m_Anchors");
+        w.beginArray();
+        for (const auto &anchor : layout.anchors) write_joint(w, anchor, false);
+        w.endArray();
+    }
+
+    if (fields[PHASES_SECTION]) {
+        w.key("m_HydraulicPhases");
+        w.beginArray();
+        for (const auto &phase : layout.phases) {
+            w.beginObject();
+            w.key("m_TimeDelaySeconds"); w.value(phase.time_delay);
+            w.key("m_Guid"); w.value(std::string_view(phase.guid));
+            w.endObject();
+        }
+        w.endArray();
+        if (!layout.phases.empty()) {
+            w.key("m_UndoGuid"); w.value(nullptr);  // For compatibility with PolyConverter
+        }
+    }
+
+    if (fields[BRIDGE_SECTION]) {
+        w.key("m_Bridge");
+        w.beginObject();
+        w.key("m_Version"); w.value((int32_t)layout.bridge.version);
+        w.key("m_BridgeJoints");
+        w.beginArray();
+        for (const auto &joint : layout.bridge.joints) write_joint(w, joint, false);
+        w.endArray();
+        w.key("m_BridgeEdges");
+        w.beginArray();
+        for (const auto &edge : layout.bridge.edges) {
+            w.beginObject();
+            w.key("m_Material"); w.value((int32_t)edge.material_type);
+            w.key("m_NodeA_Guid"); w.value(std::string_view(edge.node_a_guid));
+            w.key("m_NodeB_Guid"); w.value(std::string_view(edge.node_b_guid));
+            w.key("m_JointAPart"); w.value((int32_t)edge.joint_a_part);
+            w.key("m_JointBPart"); w.value((int32_t)edge.joint_b_part);
+            w.endObject();
+        }
+        w.endArray();
+        w.key("m_BridgeSprings");
+        w.beginArray();
+        for (const auto &spring : layout.bridge.springs) {
+            w.beginObject();
+            w.key("m_Guid"); w.value(std::string_view(spring.guid));
+            w.key("m_NodeA_Guid"); w.value(std::string_view(spring.node_a_guid));
+            w.key("m_NodeB_Guid"); w.value(std::string_view(spring.node_b_guid));
+            w.key("m_NormalizedValue"); w.value(spring.normalized_value);
+            w.endObject();
+        }
+        w.endArray();
+        w.key("m_Pistons");
+        w.beginArray();
+        for (const auto &piston : layout.bridge.pistons) {
+            w.beginObject();
+            w.key("m_Guid"); w.value(std::string_view(piston.guid));
+            w.key("m_NodeA_Guid"); w.value(std::string_view(piston.node_a_guid));
+            w.key("m_NodeB_Guid"); w.value(std::string_view(piston.node_b_guid));
+            w.key("m_NormalizedValue"); w.value(piston.normalized_value);
+            w.endObject();
+        }
+        w.endArray();
+        w.key("m_HydraulicsController");
+        w.beginObject();
+        w.key("m_Phases");
+        w.beginArray();
+        for (const auto &phase : layout.bridge.phases) {
+            w.beginObject();
+            w.key("m_HydraulicsPhaseGuid"); w.value(std::string_view(phase.hydraulics_phase_guid));
+            write_strings(w, "m_PistonGuids", phase.piston_guids);
+            w.key("m_BridgeSplitJoints");
+            w.beginArray();
+            for (const auto &joint : phase.bridge_split_joints) {
+                w.beginObject();
+                w.key("m_BridgeJointGuid"); w.value(std::string_view(joint.guid));
+                w.key("m_SplitJointState"); w.value((int32_t)joint.state);
+                w.endObject();
+            }
+            w.endArray();
+            w.key("m_DisableNewAdditions"); w.value(phase.disable_new_additions);
+            w.endObject();
+        }
+        w.endArray();
+        w.endObject();
+        w.key("m_Anchors");
+        w.beginArray();
+        for (const auto &anchor : layout.bridge.anchors) write_joint(w, anchor, true);
+        w.endArray();
+        w.endObject();
+    }
+
+    if (fields[Z_AXIS_VEHICLES_SECTION]) {
+        w.key("m_ZedAxisVehicles");
+        w.beginArray();
+        for (const auto &vehicle : layout.zAxisVehicles) {
+            w.beginObject();
+            w.key("m_Guid"); w.value(std::string_view(vehicle.guid));
+            write_vec2(w, "m_Pos", vehicle.pos);
+            w.key("m_TimeDelaySeconds"); w.value(vehicle.time_delay);
+            w.key("m_PrefabName"); w.value(std::string_view(vehicle.prefab_name));
+            w.key("m_Speed"); w.value(vehicle.speed);
+            write_quaternion(w, "m_Rot", vehicle.rot);
+            w.key("m_RotationDegrees"); w.value(vehicle.rotation_degrees);
+            w.endObject();
+        }
+        w.endArray();
+    }
+
+    if (fields[VEHICLES_SECTION]) {
+        w.key("m_Vehicles");
+        w.beginArray();
+        for (const auto &vehicle : layout.vehicles) {
+            w.beginObject();
+            w.key("m_Guid"); w.value(std::string_view(vehicle.guid));
+            write_vec2(w, "m_Pos", vehicle.pos);
+            write_quaternion(w, "m_Rot", vehicle.rot);
+            w.key("m_PrefabName"); w.value(std::string_view(vehicle.prefab_name));
+            w.key("m_TimeDelaySeconds"); w.value(vehicle.time_delay);
+            write_strings(w, "m_CheckpointGuids", vehicle.checkpoint_guids);
+            w.key("m_Acceleration"); w.value(vehicle.acceleration);
+            w.key("m_Mass"); w.value(vehicle.mass);
+            w.key("m_BrakingForceMultiplier"); w.value(vehicle.braking_force_multiplier);
+            w.key("m_StrengthMethod"); w.value((int32_t)vehicle.strength_method);
+            w.key("m_MaxSlope"); w.value(vehicle.max_slope);
+            w.key("m_DesiredAcceleration"); w.value(vehicle.desired_acceleration);
+            w.key("m_IdleOnDownhill"); w.value(vehicle.idle_on_downhill);
+            w.key("m_Flipped"); w.value(vehicle.flipped);
+            w.key("m_OrderedCheckpoints"); w.value(vehicle.ordered_checkpoints);
+            w.key("m_DisplayName"); w.value(std::string_view(vehicle.display_name));
+            w.key("m_RotationDegrees"); w.value(vehicle.rotation_degrees);
+            w.key("m_TargetSpeed"); w.value(vehicle.target_speed);
+            w.key("m_UndoGuid"); w.value(nullptr);
+            w.endObject();
+        }
+        w.endArray();
+    }
+
+    if (fields[VEHICLE_STOP_TRIGGERS_SECTION]) {
+        w.key("m_VehicleStopTriggers");
+        w.beginArray();
+        for (const auto &trigger : layout.vehicleStopTriggers) {
+            w.beginObject();
+            write_vec2(w, "m_Pos", trigger.pos);
+            write_quaternion(w, "m_Rot", trigger.rot);
+            w.key("m_PrefabName"); w.value(std::string_view(trigger.prefab_name));
+            w.key("m_Height"); w.value(trigger.height);
+            w.key("m_RotationDegrees"); w.value(trigger.rotation_degrees);
+            w.key("m_StopVehicleGuid"); w.value(std::string_view(trigger.stop_vehicle_guid));
+            w.key("m_Flipped"); w.value(trigger.flipped);
+            w.key("m_UndoGuid"); w.value(nullptr);
+            w.endObject();
+        }
+        w.endArray();
+    }
+
+    if (fields[EVENT_TIMELINES_SECTION]) {
+        w.key("m_EventTimelines");
+        w.beginArray();
+        for (const auto &timeline : layout.eventTimelines) {
+            w.beginObject();
+            w.key("m_CheckpointGuid"); w.value(std::string_view(timeline.checkpoint_guid));
+            w.key("m_Stages");
+            w.beginArray();
+            for (const auto &stage : timeline.stages) {
+                // a stage without units has always been written as null
+                if (stage.units.empty()) {
+                    w.value(nullptr);
+                    continue;
+                }
+                w.beginObject();
+                w.key("m_Units");
+                w.beginArray();
+                for (const auto &unit : stage.units) {
+                    w.beginObject();
+                    w.key("m_Guid"); w.value(std::string_view(unit.guid));
+                    w.endObject();
+                }
+                w.endArray();
+                w.endObject();
+            }
+            w.endArray();
+            w.endObject();
+        }
+        w.endArray();
+    }
+
+    if (fields[CHECKPOINTS_SECTION]) {
+        w.key("m_Checkpoints");
+        w.beginArray();
+        for (const auto &checkpoint : layout.checkpoints) {
+            w.beginObject();
+            w.key("m_Guid"); w.value(std::string_view(checkpoint.guid));
+            write_vec2(w, "m_Pos", checkpoint.pos);
+            w.key("m_PrefabName"); w.value(std::string_view(checkpoint.prefab_name));
+            w.key("m_VehicleGuid"); w.value(std::string_view(checkpoint.vehicle_guid));
+            w.key("m_VehicleRestartPhaseGuid"); w.value(std::string_view(checkpoint.vehicle_restart_phase_guid));
+            w.key("m_TriggerTimeline"); w.value(checkpoint.trigger_timeline);
+            w.key("m_StopVehicle"); w.value(checkpoint.stop_vehicle);
+            w.key("m_ReverseVehicleOnRestart"); w.value(checkpoint.reverse_vehicle_on_restart);
+            w.key("m_UndoGuid"); w.value(nullptr);
+            w.endObject();
+        }
+        w.endArray();
+    }
+
+    if (fields[TERRAIN_STRETCHES_SECTION]) {
+        w.key("m_TerrainStretches");
+        w.beginArray();
+        for (const auto &stretch : layout.terrainStretches) {
+            w.beginObject();
+            write_vec3(w, "m_Pos", stretch.pos);
+            w.key("m_PrefabName"); w.value(std::string_view(stretch.prefab_name));
+            w.key("m_HeightAdded"); w.value(stretch.height_added);
+            w.key("m_RightEdgeWaterHeight"); w.value(stretch.right_edge_water_height);
+            w.key("m_TerrainIslandType"); w.value((int32_t)stretch.terrain_island_type);
+            w.key("m_VariantIndex"); w.value((int32_t)stretch.variant_index);
+            w.key("m_Flipped"); w.value(stretch.flipped);
+            w.key("m_LockPosition"); w.value(stretch.lock_position);
+            w.key("m_Hidden"); w.value(stretch.hidden);
+            w.key("m_UndoGuid"); w.value(nullptr);
+            w.endObject();
+        }
+        w.endArray();
+    }
+
+    if (fields[PILLARS_SECTION]) {
+        w.key("m_Pillars");
+        w.beginArray();
+        for (const auto &pillar : layout.pillars) {
+            w.beginObject();
+            write_vec3(w, "m_Pos", pillar.pos);
+            w.key("m_PrefabName"); w.value(std::string_view(pillar.prefab_name));
+            w.key("m_Height"); w.value(pillar.height);
+            w.key("m_UndoGuid"); w.value(nullptr);
+            w.endObject();
+        }
+        w.endArray();
+    }
+
+    if (fields[PLATFORMS_SECTION]) {
+        w.key("m_Platforms");
+        w.beginArray();
+        for (const auto &platform : layout.platforms) {
+            w.beginObject();
+            write_vec2(w, "m_Pos", platform.pos);
+            w.key("m_Height"); w.value(platform.height);
+            w.key("m_Width"); w.value(platform.width);
+            w.key("m_Flipped"); w.value(platform.flipped);
+            w.key("m_Solid"); w.value(platform.solid);
+            w.key("m_UndoGuid"); w.value(nullptr);
+            w.endObject();
+        }
+        w.endArray();
+    }
+
+    if (fields[RAMPS_SECTION]) {
+        w.key("m_Ramps");
+        w.beginArray();
+        for (const auto &ramp : layout.ramps) {
+            w.beginObject();
+            write_vec2(w, "m_Pos", ramp.pos);
+            w.key("m_Height"); w.value(ramp.height);
+            w.key("m_FlippedVertical"); w.value(ramp.flipped_vertical);
+            w.key("m_FlippedHorizontal"); w.value(ramp.flipped_horizontal);
+            w.key("m_FlippedLegs"); w.value(ramp.flipped_legs);
+            w.key("m_HideLegs"); w.value(ramp.hide_legs);
+            w.key("m_SplineType"); w.value((int32_t)ramp.spline_type);
+            w.key("m_NumSegments"); w.value((int32_t)ramp.num_segments);
+            w.key("m_UndoGuid"); w.value(nullptr);
+            // point lists are left out entirely when empty
+            const std::pair<const char*, const ArenaVector<Vec2>*> point_lists[] = {
+                    {"m_ControlPoints", &ramp.control_points},
+                    {"m_LinePoints", &ramp.line_points}
+            };
+            for (const auto &[key, points] : point_lists) {
+                if (points->empty()) continue;
+                w.key(key);
+                w.beginArray();
+                for (const Vec2 &point : *points) {
+                    w.beginObject();
+                    w.key("x"); w.value(point.x);
+                    w.key("y"); w.value(point.y);
+                    w.endObject();
+                }
+                w.endArray();
+            }
+            w.endObject();
+        }
+        w.endArray();
+    }
+
+    if (fields[VEHICLE_RESTART_PHASES_SECTION]) {
+        w.key("m_VehicleRestartPhases");
+        w.beginArray();
+        for (const auto &phase : layout.vehicleRestartPhases) {
+            w.beginObject();
+            w.key("m_Guid"); w.value(std::string_view(phase.guid));
+            w.key("m_VehicleGuid"); w.value(std::string_view(phase.vehicle_guid));
+            w.key("m_TimeDelaySeconds"); w.value(phase.time_delay);
+            w.key("m_UndoGuid"); w.value(nullptr);
+            w.endObject();
+        }
+        w.endArray();
+    }
+
+    if (fields[FLYING_OBJECTS_SECTION]) {
+        w.key("m_FlyingObjects");
+        w.beginArray();
+        for (const auto &object : layout.flyingObjects) {
+            w.beginObject();
+            write_vec3(w, "m_Pos", object.pos);
+            write_vec3(w, "m_Scale", object.scale);
+            w.key("m_PrefabName"); w.value(std::string_view(object.prefab_name));
+            w.key("m_UndoGuid"); w.value(nullptr);
+            w.endObject();
+        }
+        w.endArray();
+    }
+
+    if (fields[ROCKS_SECTION]) {
+        w.key("m_Rocks");
+        w.beginArray();
+        for (const auto &rock : layout.rocks) {
+            w.beginObject();
+            write_vec3(w, "m_Pos", rock.pos);
+            write_vec3(w, "m_Scale", rock.scale);
+            w.key("m_PrefabName"); w.value(std::string_view(rock.prefab_name));
+            w.key("m_Flipped"); w.value(rock.flipped);
+            w.key("m_UndoGuid"); w.value(nullptr);
+            w.endObject();
+        }
+        w.endArray();
+    }
+
+    if (fields[SUPPORT_PILLARS_SECTION]) {
+        w.key("m_SupportPillars");
+        w.beginArray();
+        for (const auto &pillar : layout.supportPillars) {
+            w.beginObject();
+            write_vec3(w, "m_Pos", pillar.pos);
+            write_vec3(w, "m_Scale", pillar.scale);
+            w.key("m_PrefabName"); w.value(std::string_view(pillar.prefab_name));
+            w.key("m_UndoGuid"); w.value(nullptr);
+            w.endObject();
+        }
+        w.endArray();
+    }
+
+    if (fields[WATER_BLOCKS_SECTION]) {
+        w.key("m_WaterBlocks");
+        w.beginArray();
+        for (const auto &water : layout.waterBlocks) {
+            w.beginObject();
+            write_vec3(w, "m_Pos", water.pos);
+            w.key("m_Width"); w.value(water.width);
+            w.key("m_Height"); w.value(water.height);
+            w.key("m_LockPosition"); w.value(water.lock_position);
+            w.key("m_UndoGuid"); w.value(nullptr);
+            w.endObject();
+        }
+        w.endArray();
+    }
+
+    if (fields[CUSTOM_SHAPES_SECTION]) {
+        w.key("m_CustomShapes");
+        w.beginArray();
+        for (const auto &shape : layout.customShapes) {
+            w.beginObject();
+            write_vec3(w, "m_Pos", shape.pos);
+            write_vec3(w, "m_Scale", shape.scale);
+            write_quaternion(w, "m_Rot", shape.rot);
+            w.key("m_Color");
+            w.beginObject();
+            w.key("r"); w.value(shape.color.r);
+            w.key("g"); w.value(shape.color.g);
+            w.key("b"); w.value(shape.color.b);
+            w.key("a"); w.value(shape.color.a);
+            w.endObject();
+            w.key("m_Flipped"); w.value(shape.flipped);
+            w.key("m_CollidesWithRoad"); w.value(shape.collides_with_road);
+            w.key("m_CollidesWithNodes"); w.value(shape.collides_with_nodes);
+            w.key("m_CollidesWithSplitNodes"); w.value(shape.collides_with_split_nodes);
+            w.key("m_Dynamic"); w.value(shape.dynamic);
+            w.key("m_RotationDegrees"); w.value(shape.rotation_degrees);
+            w.key("m_Mass"); w.value(shape.mass);
+            w.key("m_Bounciness"); w.value(shape.bounciness);
+            w.key("m_PinMotorStrength"); w.value(shape.pin_motor_strength);
+            w.key("m_PinTargetVelocity"); w.value(shape.pin_target_velocity);
+            w.key("m_PointsLocalSpace");
+            w.beginArray();
+            for (const Vec2 &point : shape.points_local_space) {
+                w.beginObject();
+                w.key("x"); w.value(point.x);
+                w.key("y"); w.value(point.y);
+                w.endObject();
+            }
+            w.endArray();
+            w.key("m_StaticPins");
+            w.beginArray();
+            for (const Vec3 &point : shape.static_pins) {
+                w.beginObject();
+                w.key("x"); w.value(point.x);
+                w.key("y"); w.value(point.y);
+                w.key("z"); w.value(point.z);
+                w.endObject();
+            }
+            w.endArray();
+            write_strings(w, "m_DynamicAnchorGuids", shape.dynamic_anchor_guids);
+            w.key("m_UndoGuid"); w.value(nullptr);
+            w.endObject();
+        }
+        w.endArray();
+    }
+
+    if (fields[BUDGET_SECTION]) {
+        w.key("m_Budget");
+        w.beginObject();
+        w.key("m_CashBudget"); w.value((int32_t)layout.budget.cash);
+        w.key("m_RoadBudget"); w.value((int32_t)layout.budget.road);
+        w.key("m_WoodBudget"); w.value((int32_t)layout.budget.wood);
+        w.key("m_SteelBudget"); w.value((int32_t)layout.budget.steel);
+        w.key("m_HydraulicBudget"); w.value((int32_t)layout.budget.hydraulics);
+        w.key("m_RopeBudget"); w.value((int32_t)layout.budget.rope);
+        w.key("m_CableBudget"); w.value((int32_t)layout.budget.cable);
+        w.key("m_SpringBudget"); w.value((int32_t)layout.budget.spring);
+        w.key("m_BungieRopeBudget"); w.value((int32_t)layout.budget.bungee_rope);
+        w.key("m_AllowWood"); w.value(layout.budget.allow_wood);
+        w.key("m_AllowSteel"); w.value(layout.budget.allow_steel);
+        w.key("m_AllowHydraulic"); w.value(layout.budget.allow_hydraulics);
+        w.key("m_AllowRope"); w.value(layout.budget.allow_rope);
+        w.key("m_AllowCable"); w.value(layout.budget.allow_cable);
+        w.key("m_AllowSpring"); w.value(layout.budget.allow_spring);
+        w.key("m_AllowReinforcedRoad"); w.value(layout.budget.allow_reinforced_road);
+        w.endObject();
+    }
+
+    if (fields[SETTINGS_SECTION]) {
+        w.key("m_Settings");
+        w.beginObject();
+        w.key("m_HydraulicControllerEnabled"); w.value(layout.settings.hydraulics_controller_enabled);
+        w.key("m_Unbreakable"); w.value(layout.settings.unbreakable);
+        w.key("m_NoWater"); w.value(layout.settings.no_water);
+        w.endObject();
+    }
+
+    if (fields[WORKSHOP_SECTION]) {
+        w.key("m_Workshop");
+        w.beginObject();
+        w.key("m_Id"); w.value(std::string_view(layout.workshop.id));
+        w.key("m_LeaderboardId"); w.value(std::string_view(layout.workshop.leaderboard_id));
+        w.key("m_Title"); w.value(std::string_view(layout.workshop.title));
+        w.key("m_Description"); w.value(std::string_view(layout.workshop.description));
+        w.key("m_AutoPlay"); w.value(layout.workshop.autoplay);
+        write_strings(w, "m_Tags", layout.workshop.tags);
+        w.endObject();
+    }
+
+    // Mod support
+    if (fields[MOD_DATA_SECTION]) {
+        w.key("ext_Mods");
+        w.beginArray();
+        for (const auto &m : layout.modData.mods) {
+            w.beginObject();
+            w.key("name"); w.value(std::string_view(m.name));
+            w.key("version"); w.value(std::string_view(m.version));
+            w.key("settings"); w.value(std::string_view(m.settings));
+            w.endObject();
+        }
+        w.endArray();
+        if (!layout.modData.mod_save_data.empty()) {
+            w.key("ext_ModSaveData");
+            w.beginArray();
+            for (const auto &md : layout.modData.mod_save_data) {
+                w.beginObject();
+                w.key("name"); w.value(std::string_view(md.name));
+                w.key("version"); w.value(std::string_view(md.version));
+                std::string data = md.data != nullptr ? macaron::Base64::Encode(md.data) : std::string();
+                w.key("base64_encoded_data"); w.value(std::string_view(data));
+                w.endObject();
+            }
+            w.endArray();
+        }
     }
+    w.endObject();
+}
+
+// Builds the document dump_json writes; the same key schema is used for every output encoding.
+json layout_to_json(const Layout &layout, const SectionMask &fields = ALL_SECTIONS) {
+    JsonDomWriter writer;
+    write_layout(writer, layout, fields);
+    return std::move(writer.document);
+}
+
+void dump_json(Layout &layout, const std::string& path, const OutputOptions &options = {}) {
+    if (options.format == YAML_DOCUMENT) {
+        Compression::OutputFile of(path, std::ios::out);
+        if (!of.is_open()) {
+            U::log_error("Could not open %s for writing", path.c_str());
+            exit(1);
+        }
+        YamlWriter writer(of, options.precision);
+        write_layout(writer, layout, options.fields);
+        writer.finish();
+        return;
+    }
+    json j = layout_to_json(layout, options.fields);
+    write_json(j, path, options);
+}
+
+// Columnar export
+//   Appends layouts to a dataset directory in which every field of every table is its own file of fixed-width,
+//   native little-endian values (joints.x.f32, edges.node_a.i32, ...). Each file is a plain array that can be
+//   memory-mapped and scanned without touching the columns an analysis doesn't need.
+//   layouts.offsets.u64 holds one row per layout with a (first row, row count) pair for every table, in the order
+//   schema.json lists them, and layouts.source.u64 holds the end offset of each layout's source path in
+//   layouts.source.utf8. Joint indices in the member tables are relative to the layout's first joint row and follow
+//   BridgeGraph (joints, then anchors, -1 where the GUID doesn't resolve). Not safe for concurrent writers.
+class ColumnarExport {
+public:
+    explicit ColumnarExport(std::string directory) : directory(std::move(directory)) {}
+
+    void append(const Layout &layout, const std::string &source) {
+        const Bridge &bridge = layout.bridge;
+        BridgeGraph graph = BridgeGraph::resolve(bridge);
+
+        Table &joints = this->table("joints");
+        auto &joint_x = joints.column<float>("x");
+        auto &joint_y = joints.column<float>("y");
+        auto &joint_z = joints.column<float>("z");
+        auto &joint_anchor = joints.column<uint8_t>("is_anchor");
+        auto &joint_split = joints.column<uint8_t>("is_split");
+        auto &joint_guid = joints.column<BinaryGuid>("guid");
+        auto addJoint = [&](const BridgeJoint &joint) {
+            BinaryGuid guid;  // left zeroed if malformed
+            GuidCodec::parse(joint.guid, guid);
+            joint_x.push(joint.pos.x);
+            joint_y.push(joint.pos.y);
+            joint_z.push(joint.pos.z);
+            joint_anchor.push((uint8_t)joint.is_anchor);
+            joint_split.push((uint8_t)joint.is_split);
+            joint_guid.push(guid);
+            joints.rows++;
+        };
+        for (const BridgeJoint &joint : bridge.joints) addJoint(joint);
+        for (const BridgeJoint &anchor : bridge.anchors) addJoint(anchor);
+
+        Table &edges = this->table("edges");
+        auto &edge_material = edges.column<int32_t>("material");
+        auto &edge_a = edges.column<int32_t>("node_a");
+        auto &edge_b = edges.column<int32_t>("node_b");
+        auto &edge_a_part = edges.column<uint8_t>("joint_a_part");
+        auto &edge_b_part = edges.column<uint8_t>("joint_b_part");
+        for (std::size_t i = 0; i < bridge.edges.size(); i++) {
+            const BridgeEdge &edge = bridge.edges[i];
+            edge_material.push((int32_t)edge.material_type);
+            edge_a.push(graph.edge_a[i]);
+            edge_b.push(graph.edge_b[i]);
+            edge_a_part.push((uint8_t)edge.joint_a_part);
+            edge_b_part.push((uint8_t)edge.joint_b_part);
+            edges.rows++;
+        }
+
+        Table &springs = this->table("springs");
+        auto &spring_value = springs.column<float>("normalized_value");
+        auto &spring_a = springs.column<int32_t>("node_a");
+        auto &spring_b = springs.column<int32_t>("node_b");
+        for (std::size_t i = 0; i < bridge.springs.size(); i++) {
+            spring_value.push(bridge.springs[i].normalized_value);
+            spring_a.push(graph.spring_a[i]);
+            spring_b.push(graph.spring_b[i]);
+            springs.rows++;
+        }
+
+        Table &pistons = this->table("pistons");
+        auto &piston_value = pistons.column<float>("normalized_value");
+        auto &piston_a = pistons.column<int32_t>("node_a");
+        auto &piston_b = pistons.column<int32_t>("node_b");
+        for (std::size_t i = 0; i < bridge.pistons.size(); i++) {
+            piston_value.push(bridge.pistons[i].normalized_value);
+            piston_a.push(graph.piston_a[i]);
+            piston_b.push(graph.piston_b[i]);
+            pistons.rows++;
+        }
+
+        Table &vehicles = this->table("vehicles");
+        auto &vehicle_x = vehicles.column<float>("x");
+        auto &vehicle_y = vehicles.column<float>("y");
+        auto &vehicle_rotation = vehicles.column<float>("rotation_degrees");
+        auto &vehicle_speed = vehicles.column<float>("target_speed");
+        auto &vehicle_mass = vehicles.column<float>("mass");
+        auto &vehicle_braking = vehicles.column<float>("braking_force_multiplier");
+        auto &vehicle_strength = vehicles.column<int32_t>("strength_method");
+        auto &vehicle_acceleration = vehicles.column<float>("acceleration");
+        auto &vehicle_slope = vehicles.column<float>("max_slope");
+        auto &vehicle_desired = vehicles.column<float>("desired_acceleration");
+        auto &vehicle_shocks = vehicles.column<float>("shocks_multiplier");
+        auto &vehicle_delay = vehicles.column<float>("time_delay");
+        auto &vehicle_idle = vehicles.column<uint8_t>("idle_on_downhill");
+        auto &vehicle_flipped = vehicles.column<uint8_t>("flipped");
+        auto &vehicle_ordered = vehicles.column<uint8_t>("ordered_checkpoints");
+        for (const Vehicle &vehicle : layout.vehicles) {
+            vehicle_x.push(vehicle.pos.x);
+            vehicle_y.push(vehicle.pos.y);
+            vehicle_rotation.push(vehicle.rotation_degrees);
+            vehicle_speed.push(vehicle.target_speed);
+            vehicle_mass.push(vehicle.mass);
+            vehicle_braking.push(vehicle.braking_force_multiplier);
+            vehicle_strength.push((int32_t)vehicle.strength_method);
+            vehicle_acceleration.push(vehicle.acceleration);
+            vehicle_slope.push(vehicle.max_slope);
+            vehicle_desired.push(vehicle.desired_acceleration);
+            vehicle_shocks.push(vehicle.shocks_multiplier);
+            vehicle_delay.push(vehicle.time_delay);
+            vehicle_idle.push((uint8_t)vehicle.idle_on_downhill);
+            vehicle_flipped.push((uint8_t)vehicle.flipped);
+            vehicle_ordered.push((uint8_t)vehicle.ordered_checkpoints);
+            vehicles.rows++;
+        }
+
+        Table &checkpoints = this->table("checkpoints");
+        auto &checkpoint_x = checkpoints.column<float>("x");
+        auto &checkpoint_y = checkpoints.column<float>("y");
+        auto &checkpoint_timeline = checkpoints.column<uint8_t>("trigger_timeline");
+        auto &checkpoint_stop = checkpoints.column<uint8_t>("stop_vehicle");
+        auto &checkpoint_reverse = checkpoints.column<uint8_t>("reverse_vehicle_on_restart");
+        for (const Checkpoint &checkpoint : layout.checkpoints) {
+            checkpoint_x.push(checkpoint.pos.x);
+            checkpoint_y.push(checkpoint.pos.y);
+            checkpoint_timeline.push((uint8_t)checkpoint.trigger_timeline);
+            checkpoint_stop.push((uint8_t)checkpoint.stop_vehicle);
+            checkpoint_reverse.push((uint8_t)checkpoint.reverse_vehicle_on_restart);
+            checkpoints.rows++;
+        }
+
+        Table &platforms = this->table("platforms");
+        auto &platform_x = platforms.column<float>("x");
+        auto &platform_y = platforms.column<float>("y");
+        auto &platform_width = platforms.column<float>("width");
+        auto &platform_height = platforms.column<float>("height");
+        auto &platform_flipped = platforms.column<uint8_t>("flipped");
+        auto &platform_solid = platforms.column<uint8_t>("solid");
+        for (const Platform &platform : layout.platforms) {
+            platform_x.push(platform.pos.x);
+            platform_y.push(platform.pos.y);
+            platform_width.push(platform.width);
+            platform_height.push(platform.height);
+            platform_flipped.push((uint8_t)platform.flipped);
+            platform_solid.push((uint8_t)platform.solid);
+            platforms.rows++;
+        }
+
+        Table &terrain = this->table("terrain_stretches");
+        auto &terrain_x = terrain.column<float>("x");
+        auto &terrain_y = terrain.column<float>("y");
+        auto &terrain_z = terrain.column<float>("z");
+        auto &terrain_height = terrain.column<float>("height_added");
+        auto &terrain_water = terrain.column<float>("right_edge_water_height");
+        auto &terrain_type = terrain.column<int32_t>("terrain_island_type");
+        auto &terrain_variant = terrain.column<int32_t>("variant_index");
+        auto &terrain_flipped = terrain.column<uint8_t>("flipped");
+        for (const TerrainIsland &island : layout.terrainStretches) {
+            terrain_x.push(island.pos.x);
+            terrain_y.push(island.pos.y);
+            terrain_z.push(island.pos.z);
+            terrain_height.push(island.height_added);
+            terrain_water.push(island.right_edge_water_height);
+            terrain_type.push((int32_t)island.terrain_island_type);
+            terrain_variant.push((int32_t)island.variant_index);
+            terrain_flipped.push((uint8_t)island.flipped);
+            terrain.rows++;
+        }
+
+        Table &shapes = this->table("custom_shapes");
+        auto &shape_x = shapes.column<float>("x");
+        auto &shape_y = shapes.column<float>("y");
+        auto &shape_z = shapes.column<float>("z");
+        auto &shape_rotation = shapes.column<float>("rotation_degrees");
+        auto &shape_scale_x = shapes.column<float>("scale_x");
+        auto &shape_scale_y = shapes.column<float>("scale_y");
+        auto &shape_scale_z = shapes.column<float>("scale_z");
+        auto &shape_mass = shapes.column<float>("mass");
+        auto &shape_bounciness = shapes.column<float>("bounciness");
+        auto &shape_dynamic = shapes.column<uint8_t>("dynamic");
+        auto &shape_points = shapes.column<int32_t>("point_count");
+        for (const CustomShape &shape : layout.customShapes) {
+            shape_x.push(shape.pos.x);
+            shape_y.push(shape.pos.y);
+            shape_z.push(shape.pos.z);
+            shape_rotation.push(shape.rotation_degrees);
+            shape_scale_x.push(shape.scale.x);
+            shape_scale_y.push(shape.scale.y);
+            shape_scale_z.push(shape.scale.z);
+            shape_mass.push(shape.mass);
+            shape_bounciness.push(shape.bounciness);
+            shape_dynamic.push((uint8_t)shape.dynamic);
+            shape_points.push((int32_t)shape.points_local_space.size());
+            shapes.rows++;
+        }
+
+        Table &pillars = this->table("pillars");
+        auto &pillar_x = pillars.column<float>("x");
+        auto &pillar_y = pillars.column<float>("y");
+        auto &pillar_z = pillars.column<float>("z");
+        auto &pillar_height = pillars.column<float>("height");
+        for (const Pillar &pillar : layout.pillars) {
+            pillar_x.push(pillar.pos.x);
+            pillar_y.push(pillar.pos.y);
+            pillar_z.push(pillar.pos.z);
+            pillar_height.push(pillar.height);
+            pillars.rows++;
+        }
+
+        Table &water = this->table("water_blocks");
+        auto &water_x = water.column<float>("x");
+        auto &water_y = water.column<float>("y");
+        auto &water_z = water.column<float>("z");
+        auto &water_width = water.column<float>("width");
+        auto &water_height = water.column<float>("height");
+        for (const WaterBlock &block : layout.waterBlocks) {
+            water_x.push(block.pos.x);
+            water_y.push(block.pos.y);
+            water_z.push(block.pos.z);
+            water_width.push(block.width);
+            water_height.push(block.height);
+            water.rows++;
+        }
+
+        // one row per layout; the budget fields are what dataset queries filter on most
+        Table &layouts = this->table("layouts");
+        layouts.column<int32_t>("version").push(layout.version);
+        layouts.column<int32_t>("budget_cash").push(layout.budget.cash);
+        layouts.column<int32_t>("budget_road").push(layout.budget.road);
+        layouts.column<int32_t>("budget_wood").push(layout.budget.wood);
+        layouts.column<int32_t>("budget_steel").push(layout.budget.steel);
+        layouts.column<int32_t>("budget_hydraulics").push(layout.budget.hydraulics);
+        layouts.column<int32_t>("budget_rope").push(layout.budget.rope);
+        layouts.column<int32_t>("budget_cable").push(layout.budget.cable);
+        layouts.column<int32_t>("budget_bungee_rope").push(layout.budget.bungee_rope);
+        layouts.column<int32_t>("budget_spring").push(layout.budget.spring);
+        layouts.rows++;
+
+        this->flush(source);
+    }
+private:
+    struct Column {
+        std::string name;
+        const char *type;
+        std::string bytes;  // rows waiting to be appended
+
+        template<typename T>
+        void push(const T &value) {
+            this->bytes.append(reinterpret_cast<const char *>(&value), sizeof(T));
+        }
+    };
+    struct Table {
+        std::string name;
+        std::size_t rows{};
+        std::deque<Column> columns;  // deque, so references handed out stay valid
+
+        template<typename T>
+        Column &column(const char *name) {
+            const char *type = std::is_same_v<T, float> ? "f32"
+                             : std::is_same_v<T, int32_t> ? "i32"
+                             : std::is_same_v<T, uint8_t> ? "u8"
+                             : std::is_same_v<T, uint64_t> ? "u64"
+                             : "guid";  // 16 bytes
+            for (Column &column : this->columns) {
+                if (column.name == name) return column;
+            }
+            return this->columns.emplace_back(Column{name, type, {}});
+        }
+    };
+
+    std::string directory;
+    std::deque<Table> tables;
+
+    Table &table(const char *name) {
+        return this->tables.emplace_back(Table{name, 0, {}});
+    }
+    std::string fileName(const std::string &table, const Column &column) const {
+        return this->directory + "/" + table + "." + column.name + "." + column.type;
+    }
+    static std::size_t typeWidth(std::string_view type) {
+        if (type == "f32" || type == "i32") return 4;
+        if (type == "u8") return 1;
+        if (type == "u64") return 8;
+        return 16;
+    }
+    std::size_t existingBytes(const std::string &file) const {
+        std::error_code error;
+        auto size = std::filesystem::file_size(file, error);
+        return error ? 0 : (std::size_t)size;
+    }
+    void appendToFile(const std::string &file, std::string_view bytes) const {
+        std::ofstream out(file, std::ios::binary | std::ios::app);
+        if (!out.is_open()) {
+            U::log_error("Could not open %s for writing", file.c_str());
+            exit(1);
+        }
+        out.write(bytes.data(), (std::streamsize)bytes.size());
+    }
+
+    void flush(const std::string &source) {
+        std::filesystem::create_directories(this->directory);
+
+        // The offsets row points at where this layout's rows start, which is wherever each table currently ends.
+        // Every table but "layouts" gets a (first row, row count) pair.
+        std::string offsets;
+        json schema;
+        schema["format_version"] = 1;
+        schema["offsets"] = json::array();
+        for (Table &table : this->tables) {
+            if (table.name != "layouts") {
+                const Column &first = table.columns.front();
+                auto begin = (uint64_t)(this->existingBytes(this->fileName(table.name, first)) / typeWidth(first.type));
+                auto count = (uint64_t)table.rows;
+                offsets.append(reinterpret_cast<const char *>(&begin), sizeof(begin));
+                offsets.append(reinterpret_cast<const char *>(&count), sizeof(count));
+                schema["offsets"].push_back(table.name);
+            }
+            json columns = json::array();
+            for (const Column &column : table.columns) {
+                json column_json;
+                column_json["name"] = column.name;
+                column_json["type"] = column.type;
+                columns.push_back(column_json);
+            }
+            schema["tables"][table.name] = columns;
+        }
+        this->appendToFile(this->directory + "/layouts.offsets.u64", offsets);
+
+        // source paths: end offsets into one blob of text
+        std::string source_blob = this->directory + "/layouts.source.utf8";
+        auto source_end = (uint64_t)(this->existingBytes(source_blob) + source.size());
+        this->appendToFile(source_blob, source);
+        this->appendToFile(this->directory + "/layouts.source.u64",
+                           std::string_view(reinterpret_cast<const char *>(&source_end), sizeof(source_end)));
+
+        for (const Table &table : this->tables) {
+            for (const Column &column : table.columns) {
+                this->appendToFile(this->fileName(table.name, column), column.bytes);
+            }
+        }
+        this->tables.clear();
+
+        std::ofstream schema_file(this->directory + "/schema.json");
+        schema_file << std::setw(2) << schema;
+    }
+};
+
+// JSON reader for load_json
+//   Builds the same document json::parse would, but numbers go through std::from_chars rather than nlohmann's
+//   strtod-based lexer: it is locale-independent, correctly rounded (so the floats dump_json writes come back
+//   bit-for-bit), and several times faster, which matters as layouts are mostly numbers.
+class JsonReader {
+public:
+    // recoverable readers throw std::runtime_error on malformed input instead of exiting, for --watch, which has to
+    // outlive a bad save
+    explicit JsonReader(std::string_view text, bool recoverable = false) : text(text), recoverable(recoverable) {}
+    json parse() {
+        this->skipWhitespace();
+        json value = this->parseValue();
+        this->skipWhitespace();
+        if (this->pos != this->text.size()) this->fail("Unexpected data after the end of the document");
+        return value;
+    }
+private:
+    std::string_view text;
+    std::size_t pos = 0;
+    bool recoverable;
+
+    [[noreturn]] void fail(const char *message) const {
+        U::log_error("Failed to parse JSON at offset %s: %s", U::add_commas((int)this->pos).c_str(), message);
+        if (this->recoverable) throw std::runtime_error(message);
+        exit(1);
+    }
+    char peek() const {
+        return this->pos < this->text.size() ? this->text[this->pos] : '\0';
+    }
+    void expect(char c) {
+        if (this->peek() != c) this->fail("Unexpected character");
+        this->pos++;
+    }
+    void skipWhitespace() {
+        while (this->pos < this->text.size()) {
+            char c = this->text[this->pos];
+            if (c != ' ' && c != '\n' && c != '\r' && c != '\t') break;
+            this->pos++;
+        }
+    }
+    void expectLiteral(std::string_view literal) {
+        if (this->text.substr(this->pos, literal.size()) != literal) this->fail("Invalid literal");
+        this->pos += literal.size();
+    }
+    json parseValue() {
+        switch (this->peek()) {
+            case '{':
+                return this->parseObject();
+            case '[':
+                return this->parseArray();
+            case '"':
+                return this->parseString();
+            case 't':
+                this->expectLiteral("true");
+                return true;
+            case 'f':
+                this->expectLiteral("false");
+                return false;
+            case 'n':
+                this->expectLiteral("null");
+                return nullptr;
+            default:
+                return this->parseNumber();
+        }
+    }
+    json parseObject() {
+        json object = json::object();
+        this->expect('{');
+        this->skipWhitespace();
+        if (this->peek() == '}') {
+            this->pos++;
+            return object;
+        }
+        while (true) {
+            this->skipWhitespace();
+            std::string key = this->parseString();
+            this->skipWhitespace();
+            this->expect(':');
+            this->skipWhitespace();
+            object[key] = this->parseValue();
+            this->skipWhitespace();
+            if (this->peek() == ',') {
+                this->pos++;
+                continue;
+            }
+            this->expect('}');
+            return object;
+        }
+    }
+    json parseArray() {
+        json array = json::array();
+        this->expect('[');
+        this->skipWhitespace();
+        if (this->peek() == ']') {
+            this->pos++;
+            return array;
+        }
+        while (true) {
+            this->skipWhitespace();
+            array.push_back(this->parseValue());
+            this->skipWhitespace();
+            if (this->peek() == ',') {
+                this->pos++;
+                continue;
+            }
+            this->expect(']');
+            return array;
+        }
+    }
+    uint32_t parseHex4() {
+        if (this->pos + 4 > this->text.size()) this->fail("Truncated \\u escape");
+        uint32_t value = 0;
+        for (int i = 0; i < 4; i++) {
+            int digit = GuidCodec::hexValue(this->text[this->pos++]);
+            if (digit < 0) this->fail("Invalid \\u escape");
+            value = value << 4 | (uint32_t)digit;
+        }
+        return value;
+    }
+    static void appendUtf8(std::string &out, uint32_t cp) {
+        if (cp < 0x80) {
+            out += (char)cp;
+        } else if (cp < 0x800) {
+            out += (char)(0xC0 | cp >> 6);
+            out += (char)(0x80 | (cp & 0x3F));
+        } else if (cp < 0x10000) {
+            out += (char)(0xE0 | cp >> 12);
+            out += (char)(0x80 | (cp >> 6 & 0x3F));
+            out += (char)(0x80 | (cp & 0x3F));
+        } else {
+            out += (char)(0xF0 | cp >> 18);
+            out += (char)(0x80 | (cp >> 12 & 0x3F));
+            out += (char)(0x80 | (cp >> 6 & 0x3F));
+            out += (char)(0x80 | (cp & 0x3F));
+        }
+    }
+    std::string parseString() {
+        this->expect('"');
+        std::string out;
+        while (true) {
+            // copy everything up to the next quote or escape in one go
+            std::size_t end = this->pos;
+            while (end < this->text.size() && this->text[end] != '"' && this->text[end] != '\\' &&
+                   (unsigned char)this->text[end] >= 0x20) end++;
+            out.append(this->text.data() + this->pos, end - this->pos);
+            this->pos = end;
+            if (this->pos >= this->text.size()) this->fail("Unterminated string");
+            if ((unsigned char)this->text[this->pos] < 0x20) this->fail("Control character in string");
+            if (this->text[this->pos++] == '"') return out;
+
+            char escape = this->peek();
+            this->pos++;
+            switch (escape) {
+                case '"': out += '"'; break;
+                case '\\': out += '\\'; break;
+                case '/': out += '/'; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'n': out += '\n'; break;
+                case 'r': out += '\r'; break;
+                case 't': out += '\t'; break;
+                case 'u': {
+                    uint32_t cp = this->parseHex4();
+                    if (cp >= 0xD800 && cp <= 0xDBFF) {
+                        // high surrogate, must be followed by a low one
+                        this->expect('\\');
+                        this->expect('u');
+                        uint32_t low = this->parseHex4();
+                        if (low < 0xDC00 || low > 0xDFFF) this->fail("Invalid surrogate pair");
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                    } else if (cp >= 0xDC00 && cp <= 0xDFFF) {
+                        this->fail("Unpaired low surrogate");
+                    }
+                    appendUtf8(out, cp);
+                    break;
+                }
+                default:
+                    this->fail("Invalid escape sequence");
+            }
+        }
+    }
+    json parseNumber() {
+        // Scan the JSON number grammar first so from_chars only ever sees a well-formed token.
+        std::size_t start = this->pos;
+        bool negative = this->peek() == '-';
+        if (negative) this->pos++;
+        auto digits = [this]() {
+            std::size_t begin = this->pos;
+            while (this->peek() >= '0' && this->peek() <= '9') this->pos++;
+            return this->pos - begin;
+        };
+        std::size_t integerDigits = digits();
+        if (integerDigits == 0) this->fail("Expected a value");
+        if (integerDigits > 1 && this->text[start + negative] == '0') this->fail("Leading zeros are not allowed");
+        bool isFloat = false;
+        if (this->peek() == '.') {
+            this->pos++;
+            isFloat = true;
+            if (digits() == 0) this->fail("Expected digits after the decimal point");
+        }
+        if (this->peek() == 'e' || this->peek() == 'E') {
+            this->pos++;
+            isFloat = true;
+            if (this->peek() == '+' || this->peek() == '-') this->pos++;
+            if (digits() == 0) this->fail("Expected digits in the exponent");
+        }
+        const char *first = this->text.data() + start;
+        const char *last = this->text.data() + this->pos;
+
+        if (!isFloat) {
+            // Integers keep nlohmann's split between signed and unsigned, and fall back to float on overflow.
+            if (negative) {
+                std::int64_t value;
+                if (std::from_chars(first, last, value).ec == std::errc()) return value;
+            } else {
+                std::uint64_t value;
+                if (std::from_chars(first, last, value).ec == std::errc()) return value;
+            }
+        }
+        float value;
+        auto result = std::from_chars(first, last, value);
+        if (result.ec == std::errc::invalid_argument) this->fail("Invalid number");
+        // out of range: from_chars leaves value untouched. Underflow becomes a signed zero, overflow is rejected like
+        // json::parse did. Going through double tells them apart; past double's range too, the exponent's sign does.
+        if (result.ec == std::errc::result_out_of_range) {
+            double wide;
+            bool overflow;
+            if (std::from_chars(first, last, wide).ec == std::errc()) {
+                overflow = std::abs(wide) >= 1.0;
+            } else {
+                const char *exponent = std::find_if(first, last, [](char c) { return c == 'e' || c == 'E'; });
+                overflow = exponent == last || exponent[1] != '-';
+            }
+            if (overflow) this->fail("Number out of range");
+            value = negative ? -0.0f : 0.0f;
+        }
+        return value;
+    }
+};
+
+Layout layout_from_json(json &j, bool include_bridge = true) {
+    Layout layout;
+    layout.version = j["m_Version"].get<int>();
 
     // Anchors
     for (auto &a : j["m_Anchors"]) {
@@ -3229,73 +6493,90 @@ Layout load_json(std::string &json_str) {
         anchor.pos.y = a["m_Pos"]["y"].get<float>();
         anchor.pos.z = a["m_Pos"]["z"].get<float>();
         anchor.is_anchor = a["m_IsAnchor"].get<bool>();
-        anchor.is_split = a["m_IsSplit"].get<bool>();
-        anchor.guid = a["m_Guid"].get<std::string>();
-        layout.anchors.push_back(anchor);
-    }
-
-    // Bridge edges
-    for (auto &e : b["m_BridgeEdges"]) {
-        BridgeEdge edge;
-        edge.joint_a_part = (SplitJointPart)e["m_JointAPart"].get<int>();
-        edge.joint_b_part = (SplitJointPart)e["m_JointBPart"].get<int>();
-        edge.material_type = (BridgeMaterialType)e["m_Material"].get<int>();
-        edge.node_a_guid = e["m_NodeA_Guid"].get<std::string>();
-        edge.node_b_guid = e["m_NodeB_Guid"].get<std::string>();
-        layout.bridge.edges.push_back(edge);
+        anchor.is_split = a["m_IsSplit"].get<bool>();
+        anchor.guid = a["m_Guid"].get<std::string>();
+        layout.anchors.push_back(anchor);
     }
 
-    // Bridge joints
-    for (auto &jo : b["m_BridgeJoints"]) {
-        BridgeJoint joint;
-        joint.guid = jo["m_Guid"].get<std::string>();
-        joint.pos.x = jo["m_Pos"]["x"].get<float>();
-        joint.pos.y = jo["m_Pos"]["y"].get<float>();
-        joint.pos.z = jo["m_Pos"]["z"].get<float>();
-        joint.is_anchor = jo["m_IsAnchor"].get<bool>();
-        joint.is_split = jo["m_IsSplit"].get<bool>();
-        layout.bridge.joints.push_back(joint);
-    }
+    // Bridge (--watch leaves it out while it hasn't changed, and reuses the bridge it serialized before)
+    if (include_bridge) {
+        json &b = j["m_Bridge"];
 
-    // Bridge springs
-    for (auto &s : b["m_BridgeSprings"]) {
-        BridgeSpring spring;
-        spring.guid = s["m_Guid"].get<std::string>();
-        spring.node_a_guid = s["m_NodeA_Guid"].get<std::string>();
-        spring.node_b_guid = s["m_NodeB_Guid"].get<std::string>();
-        spring.normalized_value = s["m_NormalizedValue"].get<float>();
-        layout.bridge.springs.push_back(spring);
-    }
+        // Bridge anchors
+        for (auto &a : b["m_Anchors"]) {
+            BridgeJoint anchor;
+            anchor.pos.x = a["m_Pos"]["x"].get<float>();
+            anchor.pos.y = a["m_Pos"]["y"].get<float>();
+            anchor.pos.z = a["m_Pos"]["z"].get<float>();
+            anchor.is_anchor = a["m_IsAnchor"].get<bool>();
+            anchor.is_split = a["m_IsSplit"].get<bool>();
+            anchor.guid = a["m_Guid"].get<std::string>();
+            layout.bridge.anchors.push_back(anchor);
+        }
 
-    // Hydraulic controller
-    for (auto &p : b["m_HydraulicsController"]["m_Phases"]) {
-        HydraulicsControllerPhase phase;
-        for (auto &sj : p["m_BridgeSplitJoints"]) {
-            BridgeSplitJoint split_joint;
-            split_joint.guid = sj["m_BridgeJointGuid"].get<std::string>();
-            split_joint.state = (SplitJointState)sj["m_SplitJointState"].get<int>();
-            phase.bridge_split_joints.push_back(split_joint);
+        // Bridge edges
+        for (auto &e : b["m_BridgeEdges"]) {
+            BridgeEdge edge;
+            edge.joint_a_part = (SplitJointPart)e["m_JointAPart"].get<int>();
+            edge.joint_b_part = (SplitJointPart)e["m_JointBPart"].get<int>();
+            edge.material_type = (BridgeMaterialType)e["m_Material"].get<int>();
+            edge.node_a_guid = e["m_NodeA_Guid"].get<std::string>();
+            edge.node_b_guid = e["m_NodeB_Guid"].get<std::string>();
+            layout.bridge.edges.push_back(edge);
         }
-        phase.hydraulics_phase_guid = p["m_HydraulicsPhaseGuid"].get<std::string>();
-        for (auto &pg : p["m_PistonGuids"]) {
-            phase.piston_guids.push_back(pg.get<std::string>());
+
+        // Bridge joints
+        for (auto &jo : b["m_BridgeJoints"]) {
+            BridgeJoint joint;
+            joint.guid = jo["m_Guid"].get<std::string>();
+            joint.pos.x = jo["m_Pos"]["x"].get<float>();
+            joint.pos.y = jo["m_Pos"]["y"].get<float>();
+            joint.pos.z = jo["m_Pos"]["z"].get<float>();
+            joint.is_anchor = jo["m_IsAnchor"].get<bool>();
+            joint.is_split = jo["m_IsSplit"].get<bool>();
+            layout.bridge.joints.push_back(joint);
+        }
+
+        // Bridge springs
+        for (auto &s : b["m_BridgeSprings"]) {
+            BridgeSpring spring;
+            spring.guid = s["m_Guid"].get<std::string>();
+            spring.node_a_guid = s["m_NodeA_Guid"].get<std::string>();
+            spring.node_b_guid = s["m_NodeB_Guid"].get<std::string>();
+            spring.normalized_value = s["m_NormalizedValue"].get<float>();
+            layout.bridge.springs.push_back(spring);
+        }
+
+        // Hydraulic controller
+        for (auto &p : b["m_HydraulicsController"]["m_Phases"]) {
+            HydraulicsControllerPhase phase;
+            for (auto &sj : p["m_BridgeSplitJoints"]) {
+                BridgeSplitJoint split_joint;
+                split_joint.guid = sj["m_BridgeJointGuid"].get<std::string>();
+                split_joint.state = (SplitJointState)sj["m_SplitJointState"].get<int>();
+                phase.bridge_split_joints.push_back(split_joint);
+            }
+            phase.hydraulics_phase_guid = p["m_HydraulicsPhaseGuid"].get<std::string>();
+            for (auto &pg : p["m_PistonGuids"]) {
+                phase.piston_guids.emplace_back(pg.get<std::string>());
+            }
+            phase.disable_new_additions = p["m_DisableNewAdditions"];
+            layout.bridge.phases.push_back(phase);
         }
-        phase.disable_new_additions = p["m_DisableNewAdditions"];
-        layout.bridge.phases.push_back(phase);
-    }
 
-    // Bridge pistons
-    for (auto &ps : b["m_Pistons"]) {
-        Piston piston;
-        piston.guid = ps["m_Guid"].get<std::string>();
-        piston.node_a_guid = ps["m_NodeA_Guid"].get<std::string>();
-        piston.node_b_guid = ps["m_NodeB_Guid"].get<std::string>();
-        piston.normalized_value = ps["m_NormalizedValue"].get<float>();
-        layout.bridge.pistons.push_back(piston);
-    }
+        // Bridge pistons
+        for (auto &ps : b["m_Pistons"]) {
+            Piston piston;
+            piston.guid = ps["m_Guid"].get<std::string>();
+            piston.node_a_guid = ps["m_NodeA_Guid"].get<std::string>();
+            piston.node_b_guid = ps["m_NodeB_Guid"].get<std::string>();
+            piston.normalized_value = ps["m_NormalizedValue"].get<float>();
+            layout.bridge.pistons.push_back(piston);
+        }
 
-    // Bridge version
-    layout.bridge.version = b["m_Version"].get<int>();
+        // Bridge version
+        layout.bridge.version = b["m_Version"].get<int>();
+    }
 
     // Budget
     auto budget = j["m_Budget"];
@@ -3391,7 +6672,7 @@ Layout load_json(std::string &json_str) {
     layout.workshop.leaderboard_id = workshop["m_LeaderboardId"].get<std::string>();
     // tags
     for (auto &t : workshop["m_Tags"]) {
-        layout.workshop.tags.push_back(t.get<std::string>());
+        layout.workshop.tags.emplace_back(t.get<std::string>());
     }
     layout.workshop.title = workshop["m_Title"].get<std::string>();
 
@@ -3447,329 +6728,2165 @@ Layout load_json(std::string &json_str) {
         for (auto &p : cs["m_PointsLocalSpace"]) {
             shape.points_local_space.push_back(Vec2{p["x"].get<float>(), p["y"].get<float>()});
         }
-        shape.pos.x = cs["m_Pos"]["x"].get<float>();
-        shape.pos.y = cs["m_Pos"]["y"].get<float>();
-        shape.pos.z = cs["m_Pos"]["z"].get<float>();
+        shape.pos.x = cs["m_Pos"]["x"].get<float>();
+        shape.pos.y = cs["m_Pos"]["y"].get<float>();
+        shape.pos.z = cs["m_Pos"]["z"].get<float>();
+
+        shape.rot.x = cs["m_Rot"]["x"].get<float>();
+        shape.rot.y = cs["m_Rot"]["y"].get<float>();
+        shape.rot.z = cs["m_Rot"]["z"].get<float>();
+        shape.rot.w = cs["m_Rot"]["w"].get<float>();
+
+        shape.scale.x = cs["m_Scale"]["x"].get<float>();
+        shape.scale.y = cs["m_Scale"]["y"].get<float>();
+        shape.scale.z = cs["m_Scale"]["z"].get<float>();
+
+        shape.rotation_degrees = cs["m_RotationDegrees"].get<float>();
+
+        // static pins
+        for (auto &p : cs["m_StaticPins"]) {
+            shape.static_pins.push_back(Vec3{p["x"].get<float>(), p["y"].get<float>(), p["z"].get<float>()});
+        }
+
+        // dynamic anchor GUIDs
+        for (auto &g : cs["m_DynamicAnchorGuids"]) {
+            shape.dynamic_anchor_guids.emplace_back(g.get<std::string>());
+        }
+
+        layout.customShapes.push_back(shape);
+    }
+
+    // Flying Objects
+    for (auto &fo : j["m_FlyingObjects"]) {
+        FlyingObject object;
+        object.pos.x = fo["m_Pos"]["x"].get<float>();
+        object.pos.y = fo["m_Pos"]["y"].get<float>();
+        object.pos.z = fo["m_Pos"]["z"].get<float>();
+
+        object.scale.x = fo["m_Scale"]["x"].get<float>();
+        object.scale.y = fo["m_Scale"]["y"].get<float>();
+        object.scale.z = fo["m_Scale"]["z"].get<float>();
+
+        object.prefab_name = fo["m_PrefabName"].get<std::string>();
+
+        layout.flyingObjects.push_back(object);
+    }
+
+    // Pillars
+    for (auto &pl : j["m_Pillars"]) {
+        Pillar pillar;
+        pillar.height = pl["m_Height"].get<float>();
+
+        pillar.pos.x = pl["m_Pos"]["x"].get<float>();
+        pillar.pos.y = pl["m_Pos"]["y"].get<float>();
+        pillar.pos.z = pl["m_Pos"]["z"].get<float>();
+
+        pillar.prefab_name = pl["m_PrefabName"].get<std::string>();
+
+        layout.pillars.push_back(pillar);
+    }
+
+    // Support pillars
+    for (auto &sp : j["m_SupportPillars"]) {
+        SupportPillar pillar;
+
+        pillar.pos.x = sp["m_Pos"]["x"].get<float>();
+        pillar.pos.y = sp["m_Pos"]["y"].get<float>();
+        pillar.pos.z = sp["m_Pos"]["z"].get<float>();
+
+        pillar.scale.x = sp["m_Scale"]["x"].get<float>();
+        pillar.scale.y = sp["m_Scale"]["y"].get<float>();
+        pillar.scale.z = sp["m_Scale"]["z"].get<float>();
+
+        pillar.prefab_name = sp["m_PrefabName"].get<std::string>();
+
+        layout.supportPillars.push_back(pillar);
+    }
+
+    // Vehicle restart phases
+    for (auto &vr : j["m_VehicleRestartPhases"]) {
+        VehicleRestartPhase phase;
+        phase.guid = vr["m_Guid"].get<std::string>();
+        phase.time_delay = vr["m_TimeDelaySeconds"].get<float>();
+        phase.vehicle_guid = vr["m_VehicleGuid"].get<std::string>();
+
+        layout.vehicleRestartPhases.push_back(phase);
+    }
+
+    // Vehicle stop triggers
+    for (auto &st : j["m_VehicleStopTriggers"]) {
+        VehicleStopTrigger trigger;
+        trigger.flipped = st["m_Flipped"].get<bool>();
+        trigger.height = st["m_Height"].get<float>();
+
+        trigger.pos.x = st["m_Pos"]["x"].get<float>();
+        trigger.pos.y = st["m_Pos"]["y"].get<float>();
+
+        trigger.rot.x = st["m_Rot"]["x"].get<float>();
+        trigger.rot.y = st["m_Rot"]["y"].get<float>();
+        trigger.rot.z = st["m_Rot"]["z"].get<float>();
+        trigger.rot.w = st["m_Rot"]["w"].get<float>();
+
+        trigger.prefab_name = st["m_PrefabName"].get<std::string>();
+
+        trigger.rotation_degrees = st["m_RotationDegrees"].get<float>();
+        trigger.stop_vehicle_guid = st["m_StopVehicleGuid"].get<std::string>();
+
+        layout.vehicleStopTriggers.push_back(trigger);
+    }
+
+    // Vehicles
+    for (auto &v : j["m_Vehicles"]) {
+        Vehicle vh;
+        vh.acceleration = v["m_Acceleration"].get<float>();
+        vh.braking_force_multiplier = v["m_BrakingForceMultiplier"].get<float>();
+        // checkpoint guids
+        for (auto &g : v["m_CheckpointGuids"]) {
+            vh.checkpoint_guids.emplace_back(g.get<std::string>());
+        }
+        vh.desired_acceleration = v["m_DesiredAcceleration"].get<float>();
+        vh.display_name = v["m_DisplayName"].get<std::string>();
+        vh.flipped = v["m_Flipped"].get<bool>();
+        vh.guid = v["m_Guid"].get<std::string>();
+        vh.idle_on_downhill = v["m_IdleOnDownhill"].get<bool>();
+        vh.mass = v["m_Mass"].get<float>();
+        vh.max_slope = v["m_MaxSlope"].get<float>();
+        vh.ordered_checkpoints = v["m_OrderedCheckpoints"].get<bool>();
+
+        vh.pos.x = v["m_Pos"]["x"].get<float>();
+        vh.pos.y = v["m_Pos"]["y"].get<float>();
+
+        vh.prefab_name = v["m_PrefabName"].get<std::string>();
+
+        vh.rot.x = v["m_Rot"]["x"].get<float>();
+        vh.rot.y = v["m_Rot"]["y"].get<float>();
+        vh.rot.z = v["m_Rot"]["z"].get<float>();
+        vh.rot.w = v["m_Rot"]["w"].get<float>();
+
+        vh.rotation_degrees = v["m_RotationDegrees"].get<float>();
+        vh.strength_method = (StrengthMethod)v["m_StrengthMethod"].get<int>();
+        vh.time_delay = v["m_TimeDelaySeconds"].get<float>();
+        layout.vehicles.push_back(vh);
+    }
+
+    // Platforms
+    for (auto &p : j["m_Platforms"]) {
+        Platform platform{};
+        platform.flipped = p["m_Flipped"].get<bool>();
+        platform.height = p["m_Height"].get<float>();
+        platform.pos.x = p["m_Pos"]["x"].get<float>();
+        platform.pos.y = p["m_Pos"]["y"].get<float>();
+        platform.solid = p["m_Solid"].get<bool>();
+        platform.width = p["m_Width"].get<float>();
+        layout.platforms.push_back(platform);
+    }
+
+    // Ramps
+    for (auto &r : j["m_Ramps"]) {
+        Ramp ramp{};
+        ramp.flipped_vertical = r["m_FlippedVertical"].get<bool>();
+        ramp.flipped_horizontal = r["m_FlippedHorizontal"].get<bool>();
+        ramp.flipped_legs = r["m_FlippedLegs"].get<bool>();
+        ramp.height = r["m_Height"].get<float>();
+        ramp.hide_legs = r["m_HideLegs"].get<bool>();
+        ramp.num_segments = r["m_NumSegments"].get<int>();
+        ramp.spline_type = (SplineType)r["m_SplineType"].get<int>();
+
+        ramp.pos.x = r["m_Pos"]["x"].get<float>();
+        ramp.pos.y = r["m_Pos"]["y"].get<float>();
+
+        // Line points
+        for (auto &p : r["m_LinePoints"]) {
+            ramp.line_points.push_back(Vec2{p["x"].get<float>(), p["y"].get<float>()});
+        }
+
+        // Control points
+        for (auto &p : r["m_ControlPoints"]) {
+            ramp.control_points.push_back(Vec2{p["x"].get<float>(), p["y"].get<float>()});
+        }
+
+        layout.ramps.push_back(ramp);
+    }
+
+    // Finally, rocks
+    for (auto &r : j["m_Rocks"]) {
+        Rock rock{};
+        rock.flipped = r["m_Flipped"].get<bool>();
+
+        rock.pos.x = r["m_Pos"]["x"].get<float>();
+        rock.pos.y = r["m_Pos"]["y"].get<float>();
+        rock.pos.z = r["m_Pos"]["z"].get<float>();
+
+        rock.prefab_name = r["m_PrefabName"].get<std::string>();
+
+        rock.scale.x = r["m_Scale"]["x"].get<float>();
+        rock.scale.y = r["m_Scale"]["y"].get<float>();
+        rock.scale.z = r["m_Scale"]["z"].get<float>();
+
+        layout.rocks.push_back(rock);
+    }
+
+    return layout;
+}
+
+Layout load_json(std::string &json_str) {
+    json j = JsonReader(json_str).parse();
+    return layout_from_json(j);
+}
+
+// Incremental conversion for --watch
+//   A warm process keeps, for every watched file, the parsed document and a hash of each top-level member's text.
+//   When the file is saved again only the members whose text changed are parsed again, and the bridge, which is most
+//   of a big custom map, is only rebuilt and re-encoded when m_Bridge itself changed.
+
+// Splits a JSON object into the text of its top-level members without parsing them. Gives up on anything unusual,
+// like escaped keys, in which case the caller parses the whole document instead. The values aren't validated here,
+// JsonReader does that when a member is parsed.
+bool split_json_members(std::string_view text, std::vector<std::pair<std::string_view, std::string_view>> &members) {
+    members.clear();
+    auto is_whitespace = [](char c) { return c == ' ' || c == '\n' || c == '\r' || c == '\t'; };
+    std::size_t pos = 0;
+    auto skip_whitespace = [&]() {
+        while (pos < text.size() && is_whitespace(text[pos])) pos++;
+    };
+
+    skip_whitespace();
+    if (pos >= text.size() || text[pos] != '{') return false;
+    pos++;
+    skip_whitespace();
+    if (pos < text.size() && text[pos] == '}') {
+        pos++;
+        skip_whitespace();
+        return pos == text.size();
+    }
+    while (true) {
+        // Key
+        skip_whitespace();
+        if (pos >= text.size() || text[pos] != '"') return false;
+        std::size_t key_start = ++pos;
+        while (pos < text.size() && text[pos] != '"') {
+            if (text[pos] == '\\') return false;
+            pos++;
+        }
+        if (pos >= text.size()) return false;
+        std::string_view key = text.substr(key_start, pos - key_start);
+        pos++;
+        skip_whitespace();
+        if (pos >= text.size() || text[pos] != ':') return false;
+        pos++;
+        skip_whitespace();
+
+        // Value: runs to the first comma or closing brace outside of strings and nested containers. Most of a layout
+        // is numbers, which the table lets the loop step over without any branching on them.
+        static constexpr auto structural = [] {
+            std::array<bool, 256> table{};
+            for (unsigned char c : std::string_view("\"{}[],")) table[c] = true;
+            return table;
+        }();
+        std::size_t value_start = pos;
+        int depth = 0;
+        for (; pos < text.size(); pos++) {
+            while (pos < text.size() && !structural[(unsigned char)text[pos]]) pos++;
+            if (pos >= text.size()) break;
+            char c = text[pos];
+            if (c == '"') {
+                for (pos++; pos < text.size() && text[pos] != '"'; pos++) {
+                    if (text[pos] == '\\') pos++;
+                }
+                if (pos >= text.size()) return false;
+            } else if (c == '{' || c == '[') {
+                depth++;
+            } else if (c == '}' || c == ']') {
+                if (depth == 0) break;
+                depth--;
+            } else if (c == ',' && depth == 0) {
+                break;
+            }
+        }
+        if (pos >= text.size()) return false;
+        std::size_t value_end = pos;
+        while (value_end > value_start && is_whitespace(text[value_end - 1])) value_end--;
+        members.emplace_back(key, text.substr(value_start, value_end - value_start));
+
+        if (text[pos] == ',') {
+            pos++;
+            continue;
+        }
+        if (text[pos] != '}') return false;
+        pos++;
+        skip_whitespace();
+        return pos == text.size();
+    }
+}
+
+class IncrementalLayout {
+public:
+    std::size_t reparsed = 0;  // members parsed by the last convert(), all of them after a full parse
+    std::size_t total = 0;
+    bool reusedBridge = false;
+
+    // Converts the layout JSON text to a .layout at output_path, reusing whatever hasn't changed since the last call.
+    // Throws on malformed input, leaving the state as it was so the next save is compared against the last good one.
+    void convert(std::string_view text, const std::string &output_path) {
+        std::unordered_map<std::string, uint64_t> hashes;
+        bool split = split_json_members(text, this->members);
+        if (split) {
+            for (const auto &[key, value] : this->members) {
+                Hash::Xxh64 hash;
+                hash.update(value);
+                hashes[std::string(key)] = hash.digest();
+            }
+        }
 
-        shape.rot.x = cs["m_Rot"]["x"].get<float>();
-        shape.rot.y = cs["m_Rot"]["y"].get<float>();
-        shape.rot.z = cs["m_Rot"]["z"].get<float>();
-        shape.rot.w = cs["m_Rot"]["w"].get<float>();
+        if (!split || hashes.size() != this->members.size() || this->hashes.empty()) {
+            // First run, or the text couldn't be split (or has duplicate keys): parse everything
+            json document = JsonReader(text, true).parse();
+            this->document = std::move(document);
+            this->bridgeBytes.clear();
+            this->reparsed = this->total = split ? this->members.size() : this->document.size();
+        } else {
+            // Parse every changed member before touching the state, so one that fails leaves none of them applied.
+            std::vector<std::pair<std::string, json>> changed;
+            for (const auto &[key, value] : this->members) {
+                std::string name(key);
+                auto previous = this->hashes.find(name);
+                if (previous != this->hashes.end() && previous->second == hashes[name]) continue;
+                changed.emplace_back(name, JsonReader(value, true).parse());
+            }
+            std::vector<std::string> removed;
+            for (const auto &[name, hash] : this->hashes) {
+                if (!hashes.contains(name)) removed.push_back(name);
+            }
 
-        shape.scale.x = cs["m_Scale"]["x"].get<float>();
-        shape.scale.y = cs["m_Scale"]["y"].get<float>();
-        shape.scale.z = cs["m_Scale"]["z"].get<float>();
+            for (auto &[name, value] : changed) {
+                if (name == "m_Bridge") this->bridgeBytes.clear();
+                this->document[name] = std::move(value);
+            }
+            for (const std::string &name : removed) {
+                if (name == "m_Bridge") this->bridgeBytes.clear();
+                this->document.erase(name);
+            }
+            this->reparsed = changed.size() + removed.size();
+            this->total = this->members.size();
+        }
+        this->hashes = std::move(hashes);
 
-        shape.rotation_degrees = cs["m_RotationDegrees"].get<float>();
+        // Counts of unusual numbers are per conversion, not per process
+        unusualNumbers = 1;
+        this->reusedBridge = !this->bridgeBytes.empty();
+        Arena::Scope arena;
+        Layout layout = layout_from_json(this->document, !this->reusedBridge);
+        Serializer serializer(output_path, layout);
+        serializer.serializeLayout(&this->bridgeBytes);
+    }
+private:
+    json document;
+    std::unordered_map<std::string, uint64_t> hashes;
+    std::string bridgeBytes;
+    std::vector<std::pair<std::string_view, std::string_view>> members;
+};
 
-        // static pins
-        for (auto &p : cs["m_StaticPins"]) {
-            shape.static_pins.push_back(Vec3{p["x"].get<float>(), p["y"].get<float>(), p["z"].get<float>()});
+#ifdef __linux__
+bool is_layout_json(const std::string &path) {
+    return Compression::stripSuffix(path).ends_with(".layout.json");
+}
+
+// --watch: converts every .layout.json in the given files and folders, then converts them again whenever they are
+// saved. Editors either rewrite the file in place or rename a temporary over it, so both are watched for, on the
+// folder rather than the file, as a rename replaces the file's inode.
+int watch_layouts(const std::vector<std::string> &paths, const std::string &custom_output) {
+    int fd = inotify_init1(IN_CLOEXEC);
+    if (fd < 0) {
+        U::log_error("Failed to start watching: %s", strerror(errno));
+        return 1;
+    }
+
+    struct WatchedFolder {
+        std::string directory;
+        bool allLayouts = false;  // every .layout.json in it, or only the files below
+        std::vector<std::string> files;
+    };
+    std::unordered_map<int, WatchedFolder> folders;
+    std::vector<std::string> initial;
+    for (const std::string &path : paths) {
+        std::error_code error;
+        bool is_directory = std::filesystem::is_directory(path, error);
+        if (!is_directory && !is_layout_json(path)) {
+            U::log_error("--watch expects .layout.json files or folders containing them, got %s", path.c_str());
+            return 1;
+        }
+        std::filesystem::path target(path);
+        std::string directory = is_directory ? path : target.parent_path().string();
+        if (directory.empty()) directory = ".";
+
+        int wd = inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE | IN_MOVED_FROM);
+        if (wd < 0) {
+            U::log_error("Failed to watch %s: %s", directory.c_str(), strerror(errno));
+            return 1;
+        }
+        WatchedFolder &folder = folders[wd];
+        folder.directory = directory;
+        if (is_directory) {
+            folder.allLayouts = true;
+            for (const auto &entry : std::filesystem::directory_iterator(path, error)) {
+                if (entry.is_regular_file(error) && is_layout_json(entry.path().string())) {
+                    initial.push_back(entry.path().string());
+                }
+            }
+        } else {
+            folder.files.push_back(target.filename().string());
+            initial.push_back(path);
+        }
+    }
+    std::sort(initial.begin(), initial.end());
+    initial.erase(std::unique(initial.begin(), initial.end()), initial.end());
+
+    std::unordered_map<std::string, IncrementalLayout> states;
+    auto convert = [&](const std::string &path) {
+        auto start = std::chrono::steady_clock::now();
+        Compression::InputFile fs(path);
+        if (!fs.is_open()) {
+            U::log_warn("Could not open %s, skipped", path.c_str());
+            return;
+        }
+        std::string text;
+        std::error_code error;
+        std::uintmax_t size = std::filesystem::file_size(path, error);
+        if (!error) text.reserve(size);
+        char chunk[64 * 1024];
+        while (fs.read(chunk, sizeof(chunk)) || fs.gcount() > 0) text.append(chunk, (std::size_t)fs.gcount());
+        fs.close();
+
+        std::string format(Compression::stripSuffix(path));
+        std::string output_path = custom_output.empty()
+                ? format + ".layout" + path.substr(format.size())
+                : custom_output;
+        IncrementalLayout &state = states[path];
+        try {
+            state.convert(text, output_path);
+        } catch (const std::exception &e) {
+            U::log_error("Could not convert %s, waiting for the next save: %s", path.c_str(), e.what());
+            return;
+        }
+        double ms = (double)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count() / 1000.0;
+        Utils::log_info("Layout serialized to %s in %.2fms (parsed %s of %s sections%s)", output_path.c_str(), ms,
+                        std::to_string(state.reparsed).c_str(), std::to_string(state.total).c_str(),
+                        state.reusedBridge ? ", reused the bridge" : "");
+    };
+
+    for (const std::string &path : initial) convert(path);
+    Utils::log_info("Watching " + std::to_string(initial.size()) + " layouts, press Ctrl+C to stop");
+
+    alignas(inotify_event) char buffer[64 * 1024];
+    while (true) {
+        ssize_t length = read(fd, buffer, sizeof(buffer));
+        if (length < 0) {
+            if (errno == EINTR) continue;
+            U::log_error("Failed to read file events: %s", strerror(errno));
+            return 1;
+        }
+
+        // An editor's save can produce several events for the same file, each is converted once per batch
+        std::vector<std::string> changed;
+        for (char *p = buffer; p < buffer + length; p += sizeof(inotify_event) + ((inotify_event *)p)->len) {
+            auto *event = (inotify_event *)p;
+            auto folder = folders.find(event->wd);
+            if (event->len == 0 || folder == folders.end()) continue;
+            std::string name = event->name;
+            bool watched = folder->second.allLayouts
+                    ? is_layout_json(name)
+                    : std::find(folder->second.files.begin(), folder->second.files.end(), name) != folder->second.files.end();
+            if (!watched) continue;
+
+            std::string path = (std::filesystem::path(folder->second.directory) / name).string();
+            if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+                states.erase(path);
+                changed.erase(std::remove(changed.begin(), changed.end(), path), changed.end());
+            } else if (std::find(changed.begin(), changed.end(), path) == changed.end()) {
+                changed.push_back(path);
+            }
         }
+        for (const std::string &path : changed) convert(path);
+    }
+}
+#endif
 
-        // dynamic anchor GUIDs
-        for (auto &g : cs["m_DynamicAnchorGuids"]) {
-            shape.dynamic_anchor_guids.push_back(g.get<std::string>());
+// Reads a layout from any of the formats it can be converted from: .layout, .layout.json, .layout.msgpack or
+// .layout.cbor, compressed or not. The layout is allocated in the caller's arena.
+Layout load_layout(const std::string &path) {
+    std::string format(Compression::stripSuffix(path));
+    if (format.ends_with(".layout")) {
+        Deserializer deserializer(path);
+        return deserializer.deserializeLayout();
+    }
+    if (format.ends_with(".layout.json")) {
+        Compression::InputFile fs(path);
+        if (!fs.is_open()) {
+            U::log_error("Could not open %s", path.c_str());
+            exit(1);
         }
+        std::string text((std::istreambuf_iterator<char>(fs)), std::istreambuf_iterator<char>());
+        fs.close();
+        return load_json(text);
+    }
+    if (format.ends_with(".layout.msgpack") || format.ends_with(".layout.cbor")) {
+        json document = read_binary_document(path, format.ends_with(".msgpack") ? MSGPACK_DOCUMENT : CBOR_DOCUMENT);
+        return layout_from_json(document);
+    }
+    U::log_error("%s is not a layout.", path.c_str());
+    exit(1);
+}
 
-        layout.customShapes.push_back(shape);
+// Field lists
+//   Fields<T>::visit(a, b, field) calls field(name, a.member, b.member) for every member of T, named as in the layout
+//   documents. a and b may be const or not, so the same list serves to compare two elements, to write one out and
+//   to read one back in. Types with a GUID also give key(), what they're matched by across two layouts.
+template<typename T>
+struct Fields {
+    static constexpr bool listed = false;
+};
+template<>
+struct Fields<BridgeJoint> {
+    static constexpr bool listed = true;
+    static std::string_view key(const BridgeJoint &joint) { return joint.guid; }
+    template<typename A, typename B, typename F>
+    static void visit(A &a, B &b, F &&field) {
+        field("m_Guid", a.guid, b.guid);
+        field("m_Pos", a.pos, b.pos);
+        field("m_IsAnchor", a.is_anchor, b.is_anchor);
+        field("m_IsSplit", a.is_split, b.is_split);
+    }
+};
+template<>
+struct Fields<BridgeEdge> {
+    static constexpr bool listed = true;
+    static std::string_view key(const BridgeEdge &edge) { return edge.guid; }  // empty before v11 and in documents
+    template<typename A, typename B, typename F>
+    static void visit(A &a, B &b, F &&field) {
+        field("m_Guid", a.guid, b.guid);
+        field("m_Material", a.material_type, b.material_type);
+        field("m_NodeA_Guid", a.node_a_guid, b.node_a_guid);
+        field("m_NodeB_Guid", a.node_b_guid, b.node_b_guid);
+        field("m_JointAPart", a.joint_a_part, b.joint_a_part);
+        field("m_JointBPart", a.joint_b_part, b.joint_b_part);
+    }
+};
+template<>
+struct Fields<BridgeSpring> {
+    static constexpr bool listed = true;
+    static std::string_view key(const BridgeSpring &spring) { return spring.guid; }
+    template<typename A, typename B, typename F>
+    static void visit(A &a, B &b, F &&field) {
+        field("m_Guid", a.guid, b.guid);
+        field("m_NodeA_Guid", a.node_a_guid, b.node_a_guid);
+        field("m_NodeB_Guid", a.node_b_guid, b.node_b_guid);
+        field("m_NormalizedValue", a.normalized_value, b.normalized_value);
+    }
+};
+template<>
+struct Fields<Piston> {
+    static constexpr bool listed = true;
+    static std::string_view key(const Piston &piston) { return piston.guid; }
+    template<typename A, typename B, typename F>
+    static void visit(A &a, B &b, F &&field) {
+        field("m_Guid", a.guid, b.guid);
+        field("m_NodeA_Guid", a.node_a_guid, b.node_a_guid);
+        field("m_NodeB_Guid", a.node_b_guid, b.node_b_guid);
+        field("m_NormalizedValue", a.normalized_value, b.normalized_value);
+    }
+};
+template<>
+struct Fields<BridgeSplitJoint> {
+    static constexpr bool listed = true;
+    template<typename A, typename B, typename F>
+    static void visit(A &a, B &b, F &&field) {
+        field("m_BridgeJointGuid", a.guid, b.guid);
+        field("m_SplitJointState", a.state, b.state);
+    }
+};
+template<>
+struct Fields<HydraulicsControllerPhase> {
+    static constexpr bool listed = true;
+    static std::string_view key(const HydraulicsControllerPhase &phase) { return phase.hydraulics_phase_guid; }
+    template<typename A, typename B, typename F>
+    static void visit(A &a, B &b, F &&field) {
+        field("m_HydraulicsPhaseGuid", a.hydraulics_phase_guid, b.hydraulics_phase_guid);
+        field("m_PistonGuids", a.piston_guids, b.piston_guids);
+        field("m_BridgeSplitJoints", a.bridge_split_joints, b.bridge_split_joints);
+        field("m_DisableNewAdditions", a.disable_new_additions, b.disable_new_additions);
+    }
+};
+template<>
+struct Fields<HydraulicPhase> {
+    static constexpr bool listed = true;
+    static std::string_view key(const HydraulicPhase &phase) { return phase.guid; }
+    template<typename A, typename B, typename F>
+    static void visit(A &a, B &b, F &&field) {
+        field("m_TimeDelaySeconds", a.time_delay, b.time_delay);
+        field("m_Guid", a.guid, b.guid);
+    }
+};
+template<>
+struct Fields<ZAxisVehicle> {
+    static constexpr bool listed = true;
+    static std::string_view key(const ZAxisVehicle &vehicle) { return vehicle.guid; }
+    template<typename A, typename B, typename F>
+    static void visit(A &a, B &b, F &&field) {
+        field("m_Guid", a.guid, b.guid);
+        field("m_Pos", a.pos, b.pos);
+        field("m_TimeDelaySeconds", a.time_delay, b.time_delay);
+        field("m_PrefabName", a.prefab_name, b.prefab_name);
+        field("m_Speed", a.speed, b.speed);
+        field("m_Rot", a.rot, b.rot);
+        field("m_RotationDegrees", a.rotation_degrees, b.rotation_degrees);
+    }
+};
+template<>
+struct Fields<Vehicle> {
+    static constexpr bool listed = true;
+    static std::string_view key(const Vehicle &vehicle) { return vehicle.guid; }
+    template<typename A, typename B, typename F>
+    static void visit(A &a, B &b, F &&field) {
+        field("m_Guid", a.guid, b.guid);
+        field("m_Pos", a.pos, b.pos);
+        field("m_Rot", a.rot, b.rot);
+        field("m_PrefabName", a.prefab_name, b.prefab_name);
+        field("m_TimeDelaySeconds", a.time_delay, b.time_delay);
+        field("m_CheckpointGuids", a.checkpoint_guids, b.checkpoint_guids);
+        field("m_Acceleration", a.acceleration, b.acceleration);
+        field("m_Mass", a.mass, b.mass);
+        field("m_BrakingForceMultiplier", a.braking_force_multiplier, b.braking_force_multiplier);
+        field("m_StrengthMethod", a.strength_method, b.strength_method);
+        field("m_MaxSlope", a.max_slope, b.max_slope);
+        field("m_DesiredAcceleration", a.desired_acceleration, b.desired_acceleration);
+        field("m_ShocksMultiplier", a.shocks_multiplier, b.shocks_multiplier);
+        field("m_IdleOnDownhill", a.idle_on_downhill, b.idle_on_downhill);
+        field("m_Flipped", a.flipped, b.flipped);
+        field("m_OrderedCheckpoints", a.ordered_checkpoints, b.ordered_checkpoints);
+        field("m_DisplayName", a.display_name, b.display_name);
+        field("m_RotationDegrees", a.rotation_degrees, b.rotation_degrees);
+        field("m_TargetSpeed", a.target_speed, b.target_speed);
+    }
+};
+template<>
+struct Fields<VehicleStopTrigger> {
+    static constexpr bool listed = true;
+    template<typename A, typename B, typename F>
+    static void visit(A &a, B &b, F &&field) {
+        field("m_Pos", a.pos, b.pos);
+        field("m_Rot", a.rot, b.rot);
+        field("m_PrefabName", a.prefab_name, b.prefab_name);
+        field("m_Height", a.height, b.height);
+        field("m_RotationDegrees", a.rotation_degrees, b.rotation_degrees);
+        field("m_StopVehicleGuid", a.stop_vehicle_guid, b.stop_vehicle_guid);
+        field("m_Flipped", a.flipped, b.flipped);
+    }
+};
+template<>
+struct Fields<EventUnit> {
+    static constexpr bool listed = true;
+    template<typename A, typename B, typename F>
+    static void visit(A &a, B &b, F &&field) {
+        field("m_Guid", a.guid, b.guid);
+    }
+};
+template<>
+struct Fields<EventStage> {
+    static constexpr bool listed = true;
+    template<typename A, typename B, typename F>
+    static void visit(A &a, B &b, F &&field) {
+        field("m_Units", a.units, b.units);
+    }
+};
+template<>
+struct Fields<EventTimeline> {
+    static constexpr bool listed = true;
+    template<typename A, typename B, typename F>
+    static void visit(A &a, B &b, F &&field) {
+        field("m_CheckpointGuid", a.checkpoint_guid, b.checkpoint_guid);
+        field("m_Stages", a.stages, b.stages);
+    }
+};
+template<>
+struct Fields<Checkpoint> {
+    static constexpr bool listed = true;
+    static std::string_view key(const Checkpoint &checkpoint) { return checkpoint.guid; }
+    template<typename A, typename B, typename F>
+    static void visit(A &a, B &b, F &&field) {
+        field("m_Guid", a.guid, b.guid);
+        field("m_Pos", a.pos, b.pos);
+        field("m_PrefabName", a.prefab_name, b.prefab_name);
+        field("m_VehicleGuid", a.vehicle_guid, b.vehicle_guid);
+        field("m_VehicleRestartPhaseGuid", a.vehicle_restart_phase_guid, b.vehicle_restart_phase_guid);
+        field("m_TriggerTimeline", a.trigger_timeline, b.trigger_timeline);
+        field("m_StopVehicle", a.stop_vehicle, b.stop_vehicle);
+        field("m_ReverseVehicleOnRestart", a.reverse_vehicle_on_restart, b.reverse_vehicle_on_restart);
+    }
+};
+template<>
+struct Fields<TerrainIsland> {
+    static constexpr bool listed = true;
+    template<typename A, typename B, typename F>
+    static void visit(A &a, B &b, F &&field) {
+        field("m_Pos", a.pos, b.pos);
+        field("m_PrefabName", a.prefab_name, b.prefab_name);
+        field("m_HeightAdded", a.height_added, b.height_added);
+        field("m_RightEdgeWaterHeight", a.right_edge_water_height, b.right_edge_water_height);
+        field("m_TerrainIslandType", a.terrain_island_type, b.terrain_island_type);
+        field("m_VariantIndex", a.variant_index, b.variant_index);
+        field("m_Flipped", a.flipped, b.flipped);
+        field("m_LockPosition", a.lock_position, b.lock_position);
+        field("m_Hidden", a.hidden, b.hidden);
+    }
+};
+template<>
+struct Fields<Platform> {
+    static constexpr bool listed = true;
+    template<typename A, typename B, typename F>
+    static void visit(A &a, B &b, F &&field) {
+        field("m_Pos", a.pos, b.pos);
+        field("m_Width", a.width, b.width);
+        field("m_Height", a.height, b.height);
+        field("m_Flipped", a.flipped, b.flipped);
+        field("m_Solid", a.solid, b.solid);
+    }
+};
+template<>
+struct Fields<Ramp> {
+    static constexpr bool listed = true;
+    template<typename A, typename B, typename F>
+    static void visit(A &a, B &b, F &&field) {
+        field("m_Pos", a.pos, b.pos);
+        field("m_ControlPoints", a.control_points, b.control_points);
+        field("m_Height", a.height, b.height);
+        field("m_NumSegments", a.num_segments, b.num_segments);
+        field("m_SplineType", a.spline_type, b.spline_type);
+        field("m_FlippedVertical", a.flipped_vertical, b.flipped_vertical);
+        field("m_FlippedHorizontal", a.flipped_horizontal, b.flipped_horizontal);
+        field("m_HideLegs", a.hide_legs, b.hide_legs);
+        field("m_FlippedLegs", a.flipped_legs, b.flipped_legs);
+        field("m_LinePoints", a.line_points, b.line_points);
+    }
+};
+template<>
+struct Fields<VehicleRestartPhase> {
+    static constexpr bool listed = true;
+    static std::string_view key(const VehicleRestartPhase &phase) { return phase.guid; }
+    template<typename A, typename B, typename F>
+    static void visit(A &a, B &b, F &&field) {
+        field("m_TimeDelaySeconds", a.time_delay, b.time_delay);
+        field("m_Guid", a.guid, b.guid);
+        field("m_VehicleGuid", a.vehicle_guid, b.vehicle_guid);
+    }
+};
+template<>
+struct Fields<FlyingObject> {
+    static constexpr bool listed = true;
+    template<typename A, typename B, typename F>
+    static void visit(A &a, B &b, F &&field) {
+        field("m_Pos", a.pos, b.pos);
+        field("m_Scale", a.scale, b.scale);
+        field("m_PrefabName", a.prefab_name, b.prefab_name);
+    }
+};
+template<>
+struct Fields<Rock> {
+    static constexpr bool listed = true;
+    template<typename A, typename B, typename F>
+    static void visit(A &a, B &b, F &&field) {
+        field("m_Pos", a.pos, b.pos);
+        field("m_Scale", a.scale, b.scale);
+        field("m_PrefabName", a.prefab_name, b.prefab_name);
+        field("m_Flipped", a.flipped, b.flipped);
+    }
+};
+template<>
+struct Fields<WaterBlock> {
+    static constexpr bool listed = true;
+    template<typename A, typename B, typename F>
+    static void visit(A &a, B &b, F &&field) {
+        field("m_Pos", a.pos, b.pos);
+        field("m_Width", a.width, b.width);
+        field("m_Height", a.height, b.height);
+        field("m_LockPosition", a.lock_position, b.lock_position);
+    }
+};
+template<>
+struct Fields<Budget> {
+    static constexpr bool listed = true;
+    template<typename A, typename B, typename F>
+    static void visit(A &a, B &b, F &&field) {
+        field("m_CashBudget", a.cash, b.cash);
+        field("m_RoadBudget", a.road, b.road);
+        field("m_WoodBudget", a.wood, b.wood);
+        field("m_SteelBudget", a.steel, b.steel);
+        field("m_HydraulicBudget", a.hydraulics, b.hydraulics);
+        field("m_RopeBudget", a.rope, b.rope);
+        field("m_CableBudget", a.cable, b.cable);
+        field("m_SpringBudget", a.spring, b.spring);
+        field("m_BungieRopeBudget", a.bungee_rope, b.bungee_rope);
+        field("m_AllowWood", a.allow_wood, b.allow_wood);
+        field("m_AllowSteel", a.allow_steel, b.allow_steel);
+        field("m_AllowHydraulic", a.allow_hydraulics, b.allow_hydraulics);
+        field("m_AllowRope", a.allow_rope, b.allow_rope);
+        field("m_AllowCable", a.allow_cable, b.allow_cable);
+        field("m_AllowSpring", a.allow_spring, b.allow_spring);
+        field("m_AllowReinforcedRoad", a.allow_reinforced_road, b.allow_reinforced_road);
+    }
+};
+template<>
+struct Fields<Settings> {
+    static constexpr bool listed = true;
+    template<typename A, typename B, typename F>
+    static void visit(A &a, B &b, F &&field) {
+        field("m_HydraulicControllerEnabled", a.hydraulics_controller_enabled, b.hydraulics_controller_enabled);
+        field("m_Unbreakable", a.unbreakable, b.unbreakable);
+        field("m_NoWater", a.no_water, b.no_water);
+    }
+};
+template<>
+struct Fields<CustomShape> {
+    static constexpr bool listed = true;
+    template<typename A, typename B, typename F>
+    static void visit(A &a, B &b, F &&field) {
+        field("m_Pos", a.pos, b.pos);
+        field("m_Rot", a.rot, b.rot);
+        field("m_Scale", a.scale, b.scale);
+        field("m_Flipped", a.flipped, b.flipped);
+        field("m_Dynamic", a.dynamic, b.dynamic);
+        field("m_CollidesWithRoad", a.collides_with_road, b.collides_with_road);
+        field("m_CollidesWithNodes", a.collides_with_nodes, b.collides_with_nodes);
+        field("m_CollidesWithSplitNodes", a.collides_with_split_nodes, b.collides_with_split_nodes);
+        field("m_RotationDegrees", a.rotation_degrees, b.rotation_degrees);
+        field("m_Color", a.color, b.color);
+        field("m_Mass", a.mass, b.mass);
+        field("m_Bounciness", a.bounciness, b.bounciness);
+        field("m_PinMotorStrength", a.pin_motor_strength, b.pin_motor_strength);
+        field("m_PinTargetVelocity", a.pin_target_velocity, b.pin_target_velocity);
+        field("m_PointsLocalSpace", a.points_local_space, b.points_local_space);
+        field("m_StaticPins", a.static_pins, b.static_pins);
+        field("m_DynamicAnchorGuids", a.dynamic_anchor_guids, b.dynamic_anchor_guids);
+    }
+};
+template<>
+struct Fields<Workshop> {
+    static constexpr bool listed = true;
+    template<typename A, typename B, typename F>
+    static void visit(A &a, B &b, F &&field) {
+        field("m_Id", a.id, b.id);
+        field("m_LeaderboardId", a.leaderboard_id, b.leaderboard_id);
+        field("m_Title", a.title, b.title);
+        field("m_Description", a.description, b.description);
+        field("m_AutoPlay", a.autoplay, b.autoplay);
+        field("m_Tags", a.tags, b.tags);
+    }
+};
+template<>
+struct Fields<SupportPillar> {
+    static constexpr bool listed = true;
+    template<typename A, typename B, typename F>
+    static void visit(A &a, B &b, F &&field) {
+        field("m_Pos", a.pos, b.pos);
+        field("m_Scale", a.scale, b.scale);
+        field("m_PrefabName", a.prefab_name, b.prefab_name);
+    }
+};
+template<>
+struct Fields<Pillar> {
+    static constexpr bool listed = true;
+    template<typename A, typename B, typename F>
+    static void visit(A &a, B &b, F &&field) {
+        field("m_Pos", a.pos, b.pos);
+        field("m_Height", a.height, b.height);
+        field("m_PrefabName", a.prefab_name, b.prefab_name);
+    }
+};
+template<typename T>
+concept ListedFields = Fields<T>::listed;
+template<typename T>
+concept KeyedFields = ListedFields<T> && requires(const T &element) { Fields<T>::key(element); };
+
+// Floats compare by their bits, so that -0 and 0 differ and a NaN equals itself.
+inline bool same_value(float a, float b) {
+    return std::memcmp(&a, &b, sizeof(float)) == 0;
+}
+inline bool same_value(const Vec2 &a, const Vec2 &b) {
+    return same_value(a.x, b.x) && same_value(a.y, b.y);
+}
+inline bool same_value(const Vec3 &a, const Vec3 &b) {
+    return same_value(a.x, b.x) && same_value(a.y, b.y) && same_value(a.z, b.z);
+}
+inline bool same_value(const Quaternion &a, const Quaternion &b) {
+    return same_value(a.x, b.x) && same_value(a.y, b.y) && same_value(a.z, b.z) && same_value(a.w, b.w);
+}
+inline bool same_value(const Color &a, const Color &b) {
+    return same_value(a.r, b.r) && same_value(a.g, b.g) && same_value(a.b, b.b) && same_value(a.a, b.a);
+}
+template<typename T>
+bool same_value(const ArenaVector<T> &a, const ArenaVector<T> &b);
+template<typename T>
+bool same_value(const T &a, const T &b) {
+    if constexpr (ListedFields<T>) {
+        bool same = true;
+        Fields<T>::visit(a, b, [&same](std::string_view, const auto &x, const auto &y) {
+            same = same && same_value(x, y);
+        });
+        return same;
+    } else {
+        return a == b;
+    }
+}
+template<typename T>
+bool same_value(const ArenaVector<T> &a, const ArenaVector<T> &b) {
+    if (a.size() != b.size()) return false;
+    for (std::size_t i = 0; i < a.size(); i++) {
+        if (!same_value(a[i], b[i])) return false;
     }
+    return true;
+}
 
-    // Flying Objects
-    for (auto &fo : j["m_FlyingObjects"]) {
-        FlyingObject object;
-        object.pos.x = fo["m_Pos"]["x"].get<float>();
-        object.pos.y = fo["m_Pos"]["y"].get<float>();
-        object.pos.z = fo["m_Pos"]["z"].get<float>();
+// Structural diff
+//   Elements are matched by GUID rather than by position, so reordering a section isn't a change and an edit shows
+//   up as exactly the elements it touched. One side of each section goes into a GuidMap and the other is looked up
+//   in it, which keeps matching linear however big the bridges are. Edges only carry a GUID from version 11 on;
+//   when either layout lacks them, edges are matched by their two endpoints instead.
+struct SectionDiff {
+    ArenaVector<int32_t> added;  // indices into b
+    ArenaVector<int32_t> removed;  // indices into a
+    ArenaVector<std::pair<int32_t, int32_t>> changed;  // (a, b) pairs with the same key but different contents
+    std::size_t unchanged{};
 
-        object.scale.x = fo["m_Scale"]["x"].get<float>();
-        object.scale.y = fo["m_Scale"]["y"].get<float>();
-        object.scale.z = fo["m_Scale"]["z"].get<float>();
+    bool empty() const {
+        return this->added.empty() && this->removed.empty() && this->changed.empty();
+    }
+};
 
-        object.prefab_name = fo["m_PrefabName"].get<std::string>();
+// A field's value as a document value: enums as their number, structs with a field list as objects.
+template<typename Writer, typename T>
+void write_field_value(Writer &w, const T &v) {
+    if constexpr (std::is_enum_v<T>) {
+        w.value((int32_t)v);
+    } else if constexpr (std::is_same_v<T, ArenaString>) {
+        w.value(std::string_view(v));
+    } else if constexpr (std::is_same_v<T, Vec2>) {
+        w.beginObject();
+        w.key("x"); w.value(v.x);
+        w.key("y"); w.value(v.y);
+        w.endObject();
+    } else if constexpr (std::is_same_v<T, Vec3>) {
+        w.beginObject();
+        w.key("x"); w.value(v.x);
+        w.key("y"); w.value(v.y);
+        w.key("z"); w.value(v.z);
+        w.endObject();
+    } else if constexpr (std::is_same_v<T, Quaternion>) {
+        w.beginObject();
+        w.key("x"); w.value(v.x);
+        w.key("y"); w.value(v.y);
+        w.key("z"); w.value(v.z);
+        w.key("w"); w.value(v.w);
+        w.endObject();
+    } else if constexpr (std::is_same_v<T, Color>) {
+        w.beginObject();
+        w.key("r"); w.value(v.r);
+        w.key("g"); w.value(v.g);
+        w.key("b"); w.value(v.b);
+        w.key("a"); w.value(v.a);
+        w.endObject();
+    } else if constexpr (ListedFields<T>) {
+        w.beginObject();
+        Fields<T>::visit(v, v, [&w](std::string_view name, const auto &x, const auto &) {
+            w.key(name);
+            write_field_value(w, x);
+        });
+        w.endObject();
+    } else {
+        w.value(v);
+    }
+}
+template<typename Writer, typename T>
+void write_field_value(Writer &w, const ArenaVector<T> &v) {
+    w.beginArray();
+    for (const T &element : v) write_field_value(w, element);
+    w.endArray();
+}
 
-        layout.flyingObjects.push_back(object);
+// Whether a and b are the same apart from the ignored field.
+template<typename T>
+bool same_fields(const T &a, const T &b, std::string_view ignored) {
+    bool same = true;
+    Fields<T>::visit(a, b, [&same, ignored](std::string_view name, const auto &x, const auto &y) {
+        same = same && (name == ignored || same_value(x, y));
+    });
+    return same;
+}
+
+// The fields that differ between a and b, as "field": {"from": a, "to": b}, into the current object.
+template<typename Writer, typename T>
+void write_field_changes(Writer &w, const T &a, const T &b, std::string_view ignored = {}) {
+    Fields<T>::visit(a, b, [&w, ignored](std::string_view name, const auto &x, const auto &y) {
+        if (name == ignored || same_value(x, y)) return;
+        w.key(name);
+        w.beginObject();
+        w.key("from"); write_field_value(w, x);
+        w.key("to"); write_field_value(w, y);
+        w.endObject();
+    });
+}
+
+// a_key(i) and b_key(j) give what the elements of either side are matched by. A field that one of the sides
+// doesn't have (edge GUIDs in documents) can be left out of the comparison.
+template<typename T, typename AKey, typename BKey>
+SectionDiff diff_section(const ArenaVector<T> &a, const ArenaVector<T> &b, AKey a_key, BKey b_key,
+                         std::string_view ignored = {}) {
+    SectionDiff diff;
+    GuidMap b_index;
+    b_index.reserve(b.size());
+    for (std::size_t j = 0; j < b.size(); j++) b_index.add(b_key(j), (int32_t)j);
+
+    ArenaVector<bool> matched(b.size(), false);
+    for (std::size_t i = 0; i < a.size(); i++) {
+        int32_t j = b_index.find(a_key(i));
+        if (j < 0 || matched[j]) {
+            diff.removed.push_back((int32_t)i);
+            continue;
+        }
+        matched[j] = true;
+        if (same_fields(a[i], b[j], ignored)) {
+            diff.unchanged++;
+        } else {
+            diff.changed.emplace_back((int32_t)i, j);
+        }
+    }
+    for (std::size_t j = 0; j < b.size(); j++) {
+        if (!matched[j]) diff.added.push_back((int32_t)j);
     }
+    return diff;
+}
+template<typename T>
+SectionDiff diff_section(const ArenaVector<T> &a, const ArenaVector<T> &b) {
+    return diff_section(a, b, [&a](std::size_t i) { return Fields<T>::key(a[i]); },
+                        [&b](std::size_t j) { return Fields<T>::key(b[j]); });
+}
 
-    // Pillars
-    for (auto &pl : j["m_Pillars"]) {
-        Pillar pillar;
-        pillar.height = pl["m_Height"].get<float>();
+// Added and removed elements are written in full. Changed ones list what identifies them, then only the fields
+// that differ.
+template<typename Writer, typename T, typename Identify>
+void write_section_diff(Writer &w, std::string_view name, const SectionDiff &diff, const ArenaVector<T> &a,
+                        const ArenaVector<T> &b, Identify identify, std::string_view ignored = {}) {
+    if (diff.empty()) return;
+    w.key(name);
+    w.beginObject();
+    w.key("added");
+    w.beginArray();
+    for (int32_t j : diff.added) write_field_value(w, b[j]);
+    w.endArray();
+    w.key("removed");
+    w.beginArray();
+    for (int32_t i : diff.removed) write_field_value(w, a[i]);
+    w.endArray();
+    w.key("changed");
+    w.beginArray();
+    for (const auto &[i, j] : diff.changed) {
+        w.beginObject();
+        identify(w, b[j]);
+        write_field_changes(w, a[i], b[j], ignored);
+        w.endObject();
+    }
+    w.endArray();
+    w.endObject();
+}
+template<typename Writer, typename T>
+void write_section_diff(Writer &w, std::string_view name, const SectionDiff &diff, const ArenaVector<T> &a,
+                        const ArenaVector<T> &b) {
+    write_section_diff(w, name, diff, a, b, [](Writer &w, const T &element) {
+        w.key("m_Guid");
+        w.value(Fields<T>::key(element));
+    });
+}
 
-        pillar.pos.x = pl["m_Pos"]["x"].get<float>();
-        pillar.pos.y = pl["m_Pos"]["y"].get<float>();
-        pillar.pos.z = pl["m_Pos"]["z"].get<float>();
+// Fields of a struct that isn't a list (budget, settings) that differ, as {"field": {"from": a, "to": b}}.
+template<typename Writer, typename T>
+void write_fields_diff(Writer &w, std::string_view name, const T &a, const T &b) {
+    if (same_value(a, b)) return;
+    w.key(name);
+    w.beginObject();
+    write_field_changes(w, a, b);
+    w.endObject();
+}
 
-        pillar.prefab_name = pl["m_PrefabName"].get<std::string>();
+struct LayoutDiff {
+    const Layout &a;
+    const Layout &b;
+    SectionDiff anchors;
+    SectionDiff joints;
+    SectionDiff edges;
+    SectionDiff springs;
+    SectionDiff pistons;
+    SectionDiff zAxisVehicles;
+    SectionDiff vehicles;
+    SectionDiff checkpoints;
+    bool edgesByGuid{};
+    ArenaVector<ArenaString> aEdgeKeys;  // endpoint keys, when edges can't be matched by GUID
+    ArenaVector<ArenaString> bEdgeKeys;
+
+    LayoutDiff(const Layout &a, const Layout &b) : a(a), b(b) {
+        auto has_guid = [](const BridgeEdge &edge) { return !edge.guid.empty(); };
+        this->edgesByGuid = std::all_of(a.bridge.edges.begin(), a.bridge.edges.end(), has_guid) &&
+                            std::all_of(b.bridge.edges.begin(), b.bridge.edges.end(), has_guid);
+
+        this->anchors = diff_section(a.anchors, b.anchors);
+        this->joints = diff_section(a.bridge.joints, b.bridge.joints);
+        if (this->edgesByGuid) {
+            this->edges = diff_section(a.bridge.edges, b.bridge.edges);
+        } else {
+            auto endpoint_keys = [](const Layout &layout, ArenaVector<ArenaString> &keys) {
+                keys.reserve(layout.bridge.edges.size());
+                for (const BridgeEdge &edge : layout.bridge.edges) {
+                    ArenaString key(edge.node_a_guid);
+                    key += (char)('A' + edge.joint_a_part);  // split joints connect several edges at one GUID
+                    key += '/';
+                    key += edge.node_b_guid;
+                    key += (char)('A' + edge.joint_b_part);
+                    keys.push_back(std::move(key));
+                }
+            };
+            endpoint_keys(a, this->aEdgeKeys);
+            endpoint_keys(b, this->bEdgeKeys);
+            this->edges = diff_section(a.bridge.edges, b.bridge.edges,
+                                       [this](std::size_t i) -> std::string_view { return this->aEdgeKeys[i]; },
+                                       [this](std::size_t j) -> std::string_view { return this->bEdgeKeys[j]; },
+                                       "m_Guid");
+        }
+        this->springs = diff_section(a.bridge.springs, b.bridge.springs);
+        this->pistons = diff_section(a.bridge.pistons, b.bridge.pistons);
+        this->zAxisVehicles = diff_section(a.zAxisVehicles, b.zAxisVehicles);
+        this->vehicles = diff_section(a.vehicles, b.vehicles);
+        this->checkpoints = diff_section(a.checkpoints, b.checkpoints);
+    }
+};
 
-        layout.pillars.push_back(pillar);
+template<typename Writer>
+void write_layout_diff(Writer &w, const LayoutDiff &diff, std::string_view a_path, std::string_view b_path) {
+    const Layout &a = diff.a;
+    const Layout &b = diff.b;
+    w.beginObject();
+    w.key("a"); w.value(a_path);
+    w.key("b"); w.value(b_path);
+    if (a.version != b.version) {
+        w.key("m_Version");
+        w.beginObject();
+        w.key("from"); w.value((int32_t)a.version);
+        w.key("to"); w.value((int32_t)b.version);
+        w.endObject();
+    }
+    write_section_diff(w, "m_Anchors", diff.anchors, a.anchors, b.anchors);
+    write_section_diff(w, "m_BridgeJoints", diff.joints, a.bridge.joints, b.bridge.joints);
+    write_section_diff(w, "m_BridgeEdges", diff.edges, a.bridge.edges, b.bridge.edges, [&diff](Writer &w, const BridgeEdge &edge) {
+        if (diff.edgesByGuid) {
+            w.key("m_Guid"); w.value(std::string_view(edge.guid));
+        } else {
+            w.key("m_NodeA_Guid"); w.value(std::string_view(edge.node_a_guid));
+            w.key("m_NodeB_Guid"); w.value(std::string_view(edge.node_b_guid));
+        }
+    }, diff.edgesByGuid ? "" : "m_Guid");
+    write_section_diff(w, "m_BridgeSprings", diff.springs, a.bridge.springs, b.bridge.springs);
+    write_section_diff(w, "m_Pistons", diff.pistons, a.bridge.pistons, b.bridge.pistons);
+    write_section_diff(w, "m_ZedAxisVehicles", diff.zAxisVehicles, a.zAxisVehicles, b.zAxisVehicles);
+    write_section_diff(w, "m_Vehicles", diff.vehicles, a.vehicles, b.vehicles);
+    write_section_diff(w, "m_Checkpoints", diff.checkpoints, a.checkpoints, b.checkpoints);
+    write_fields_diff(w, "m_Budget", a.budget, b.budget);
+    write_fields_diff(w, "m_Settings", a.settings, b.settings);
+    w.endObject();
+}
+
+void dump_layout_diff(const LayoutDiff &diff, const std::string &a_path, const std::string &b_path, const std::string &path, const OutputOptions &options = {}) {
+    if (options.format == YAML_DOCUMENT) {
+        Compression::OutputFile of(path, std::ios::out);
+        if (!of.is_open()) {
+            U::log_error("Could not open %s for writing", path.c_str());
+            exit(1);
+        }
+        YamlWriter writer(of, options.precision);
+        write_layout_diff(writer, diff, a_path, b_path);
+        writer.finish();
+        return;
     }
+    JsonDomWriter writer;
+    write_layout_diff(writer, diff, a_path, b_path);
+    write_json(writer.document, path, options);
+}
 
-    // Support pillars
-    for (auto &sp : j["m_SupportPillars"]) {
-        SupportPillar pillar;
+// A cost document: the usage of every material the bridge has edges of and the total, in whole dollars, compared
+// with the layout's budget or with the cost the slot was saved with when those are given. Materials without a price
+// get "priced": false instead of a cost, and the total leaves them out; "partial" then says the total is incomplete.
+// "structure" holds the BridgeStructure counts and every member endpoint that doesn't resolve.
+template<typename Writer>
+void write_bridge_cost(Writer &w, std::string_view path, const BridgeCost &cost, const BridgeGraph &graph,
+                       const BridgeStructure &structure, const Budget *budget, const int32_t *saved_cost) {
+    bool over_budget = budget && cost.total > budget->cash;
+    w.beginObject();
+    w.key("path"); w.value(path);
+    w.key("materials");
+    w.beginObject();
+    for (int material = 0; material < MATERIAL_COUNT; material++) {
+        const MaterialUsage &usage = cost.materials[material];
+        if (usage.edges == 0) continue;
+        w.key(MATERIAL_NAMES[material]);
+        w.beginObject();
+        w.key("edges"); w.value(usage.edges);
+        w.key("length"); w.value((float)usage.length);
+        if (usage.priced) {
+            w.key("cost"); w.value((int64_t)std::llround(usage.cost));
+        } else {
+            w.key("priced"); w.value(false);
+        }
+        if (budget) {
+            int32_t limit = material_budget(*budget, (BridgeMaterialType)material);
+            bool allowed = material_allowed(*budget, (BridgeMaterialType)material);
+            bool over = !allowed || (limit >= 0 && usage.length > limit);
+            if (limit >= 0) {
+                w.key("budget"); w.value(limit);
+            }
+            w.key("allowed"); w.value(allowed);
+            w.key("overBudget"); w.value(over);
+            over_budget = over_budget || over;
+        }
+        w.endObject();
+    }
+    w.endObject();
+    w.key("cost"); w.value((int64_t)std::llround(cost.total));
+    w.key("partial"); w.value(cost.unpriced > 0);
+    w.key("danglingEdges"); w.value(cost.dangling);
+    w.key("unpricedEdges"); w.value(cost.unpriced);
+    w.key("structure");
+    w.beginObject();
+    w.key("joints"); w.value(structure.joints);
+    w.key("members"); w.value(structure.members);
+    w.key("splitJoints"); w.value(structure.split);
+    w.key("isolatedJoints"); w.value(structure.isolated);
+    w.key("unanchoredJoints"); w.value(structure.unanchored);
+    w.key("length"); w.value(structure.length);
+    w.key("bounds");
+    w.beginObject();
+    for (auto [name, corner] : {std::pair{"min", structure.bounds.min}, std::pair{"max", structure.bounds.max}}) {
+        w.key(name);
+        w.beginObject();
+        w.key("x"); w.value(corner.x);
+        w.key("y"); w.value(corner.y);
+        w.key("z"); w.value(corner.z);
+        w.endObject();
+    }
+    w.endObject();
+    w.key("danglingReferences");
+    w.beginArray();
+    for (const DanglingReference &reference : graph.dangling) {
+        w.beginObject();
+        w.key("member"); w.value(std::string_view(BRIDGE_MEMBER_NAMES[reference.member_type]));
+        w.key("index"); w.value(reference.member_index);
+        w.key("node"); w.value(std::string_view(reference.node_b ? "b" : "a"));
+        w.key("m_Guid"); w.value(std::string_view(reference.guid));
+        w.endObject();
+    }
+    w.endArray();
+    w.endObject();
+    if (budget) {
+        w.key("cashBudget"); w.value((int32_t)budget->cash);
+        w.key("overBudget"); w.value(over_budget);
+    }
+    if (saved_cost) {
+        w.key("savedCost"); w.value(*saved_cost);
+        w.key("difference"); w.value((int64_t)std::llround(cost.total) - *saved_cost);
+    }
+    w.endObject();
+}
 
-        pillar.pos.x = sp["m_Pos"]["x"].get<float>();
-        pillar.pos.y = sp["m_Pos"]["y"].get<float>();
-        pillar.pos.z = sp["m_Pos"]["z"].get<float>();
+void dump_bridge_cost(const BridgeCost &cost, const BridgeGraph &graph, const BridgeStructure &structure, const std::string &source,
+                      const Budget *budget, const int32_t *saved_cost, const std::string &path, const OutputOptions &options = {}) {
+    if (options.format == YAML_DOCUMENT) {
+        Compression::OutputFile of(path, std::ios::out);
+        if (!of.is_open()) {
+            U::log_error("Could not open %s for writing", path.c_str());
+            exit(1);
+        }
+        YamlWriter writer(of, options.precision);
+        write_bridge_cost(writer, source, cost, graph, structure, budget, saved_cost);
+        writer.finish();
+        return;
+    }
+    JsonDomWriter writer;
+    write_bridge_cost(writer, source, cost, graph, structure, budget, saved_cost);
+    write_json(writer.document, path, options);
+}
 
-        pillar.scale.x = sp["m_Scale"]["x"].get<float>();
-        pillar.scale.y = sp["m_Scale"]["y"].get<float>();
-        pillar.scale.z = sp["m_Scale"]["z"].get<float>();
+// Joint overlaps
+//   Every bridge joint (joints, then anchors, as BridgeGraph numbers them) is looked up in a SpatialIndex with a box
+//   of radius around it, and whatever in the scene its box touches is reported, along with the closest the bridge
+//   comes to any terrain stretch. With check, every query is answered by a full scan of the objects as well, and
+//   mismatches counts the joints where the two disagree.
+struct JointOverlap {
+    int32_t joint;
+    ArenaVector<SpatialObject> objects;
+};
+struct OverlapReport {
+    ArenaVector<JointOverlap> overlaps;
+    int32_t closestJoint = -1;
+    SpatialObject closestTerrain{TERRAIN_OBJECT, -1};
+    float closestDistance = std::numeric_limits<float>::infinity();
+    std::size_t mismatches{};
+};
 
-        pillar.prefab_name = sp["m_PrefabName"].get<std::string>();
+const BridgeJoint &bridge_joint(const Bridge &bridge, int32_t joint) {
+    return (std::size_t)joint < bridge.joints.size() ? bridge.joints[joint] : bridge.anchors[joint - bridge.joints.size()];
+}
 
-        layout.supportPillars.push_back(pillar);
+OverlapReport find_joint_overlaps(const Layout &layout, const SpatialIndex &index, float radius, bool check) {
+    constexpr uint32_t SCENE = ALL_SPATIAL_OBJECTS & ~(1u << JOINT_OBJECT);
+    constexpr uint32_t TERRAIN = 1u << TERRAIN_OBJECT;
+    auto sorted = [](ArenaVector<SpatialObject> objects) {
+        std::sort(objects.begin(), objects.end(), [](const SpatialObject &a, const SpatialObject &b) {
+            return a.type != b.type ? a.type < b.type : a.index < b.index;
+        });
+        return objects;
+    };
+    OverlapReport report;
+    int32_t joint_count = (int32_t)(layout.bridge.joints.size() + layout.bridge.anchors.size());
+    for (int32_t joint = 0; joint < joint_count; joint++) {
+        const Vec3 &pos = bridge_joint(layout.bridge, joint).pos;
+        Vec2 p{pos.x, pos.y};
+        Vec2 min{p.x - radius, p.y - radius};
+        Vec2 max{p.x + radius, p.y + radius};
+        ArenaVector<SpatialObject> touching = sorted(index.range(min, max, SCENE));
+        float distance;
+        SpatialObject terrain = index.nearest(p, TERRAIN, &distance);
+        if (check) {
+            ArenaVector<SpatialObject> scanned = sorted(index.scanRange(min, max, SCENE));
+            float scanned_distance;
+            SpatialObject scanned_terrain = index.scanNearest(p, TERRAIN, &scanned_distance);
+            bool same = touching.size() == scanned.size() && terrain.index == scanned_terrain.index &&
+                        (terrain.index < 0 || distance == scanned_distance);
+            for (std::size_t i = 0; same && i < touching.size(); i++) {
+                same = touching[i].type == scanned[i].type && touching[i].index == scanned[i].index;
+            }
+            report.mismatches += !same;
+        }
+        if (!touching.empty()) report.overlaps.push_back(JointOverlap{joint, std::move(touching)});
+        if (terrain.index >= 0 && distance < report.closestDistance) {
+            report.closestDistance = distance;
+            report.closestJoint = joint;
+            report.closestTerrain = terrain;
+        }
     }
+    return report;
+}
 
-    // Vehicle restart phases
-    for (auto &vr : j["m_VehicleRestartPhases"]) {
-        VehicleRestartPhase phase;
-        phase.guid = vr["m_Guid"].get<std::string>();
-        phase.time_delay = vr["m_TimeDelaySeconds"].get<float>();
-        phase.vehicle_guid = vr["m_VehicleGuid"].get<std::string>();
+template<typename Writer>
+void write_joint_overlaps(Writer &w, std::string_view path, const Layout &layout, const OverlapReport &report, float radius) {
+    w.beginObject();
+    w.key("path"); w.value(path);
+    w.key("radius"); w.value(radius);
+    w.key("overlaps");
+    w.beginArray();
+    for (const JointOverlap &overlap : report.overlaps) {
+        w.beginObject();
+        w.key("m_Guid"); w.value(std::string_view(bridge_joint(layout.bridge, overlap.joint).guid));
+        w.key("objects");
+        w.beginArray();
+        for (const SpatialObject &object : overlap.objects) {
+            w.beginObject();
+            w.key("type"); w.value(std::string_view(SPATIAL_OBJECT_NAMES[object.type]));
+            w.key("index"); w.value(object.index);
+            w.endObject();
+        }
+        w.endArray();
+        w.endObject();
+    }
+    w.endArray();
+    if (report.closestJoint >= 0) {
+        w.key("closestTerrain");
+        w.beginObject();
+        w.key("m_Guid"); w.value(std::string_view(bridge_joint(layout.bridge, report.closestJoint).guid));
+        w.key("index"); w.value(report.closestTerrain.index);
+        w.key("distance"); w.value(report.closestDistance);
+        w.endObject();
+    }
+    w.endObject();
+}
 
-        layout.vehicleRestartPhases.push_back(phase);
+void dump_joint_overlaps(const OverlapReport &report, const Layout &layout, const std::string &source, float radius, const std::string &path, const OutputOptions &options = {}) {
+    if (options.format == YAML_DOCUMENT) {
+        Compression::OutputFile of(path, std::ios::out);
+        if (!of.is_open()) {
+            U::log_error("Could not open %s for writing", path.c_str());
+            exit(1);
+        }
+        YamlWriter writer(of, options.precision);
+        write_joint_overlaps(writer, source, layout, report, radius);
+        writer.finish();
+        return;
     }
+    JsonDomWriter writer;
+    write_joint_overlaps(writer, source, layout, report, radius);
+    write_json(writer.document, path, options);
+}
 
-    // Vehicle stop triggers
-    for (auto &st : j["m_VehicleStopTriggers"]) {
-        VehicleStopTrigger trigger;
-        trigger.flipped = st["m_Flipped"].get<bool>();
-        trigger.height = st["m_Height"].get<float>();
+// Layout patches
+//   A patch turns one revision of a layout into the next. Each section is stored as the instructions to build the
+//   new section from the old one: copy a run of old elements, take an old element and change some of its fields,
+//   or add a new element. Elements are matched by GUID where they have one, and by their whole contents otherwise
+//   (terrain, rocks and the like), so an edit to a big bridge costs a few bytes per touched element. Old elements
+//   are referred to by index, which is why a patch records the size and hash of the revision it applies to.
+//   Patches cover everything Serializer writes.
+namespace LayoutPatch {
+    constexpr char MAGIC[4] = {'P', 'P', 'L', 'P'};
+    constexpr uint32_t FORMAT_VERSION = 1;
+
+    enum Op : uint8_t {
+        COPY_OP,  // start, count: old elements [start, start + count)
+        CHANGE_OP,  // index, changes: the old element with some fields replaced
+        ADD_OP  // element
+    };
+
+    // Size and XXH64 of the decoded contents of path, so a compressed and an uncompressed copy of a layout match.
+    inline bool fingerprint(const std::string &path, uint64_t &size, uint64_t &hash) {
+        Compression::InputFile in(path);
+        if (!in.is_open()) return false;
+        Hash::Xxh64 content;
+        std::vector<char> chunk(1 << 16);
+        size = 0;
+        while (in.read(chunk.data(), (std::streamsize)chunk.size()) || in.gcount() > 0) {
+            content.update(chunk.data(), (std::size_t)in.gcount());
+            size += (uint64_t)in.gcount();
+        }
+        hash = content.digest();
+        return true;
+    }
+}
 
-        trigger.pos.x = st["m_Pos"]["x"].get<float>();
-        trigger.pos.y = st["m_Pos"]["y"].get<float>();
+class PatchWriter {
+public:
+    std::string out;
 
-        trigger.rot.x = st["m_Rot"]["x"].get<float>();
-        trigger.rot.y = st["m_Rot"]["y"].get<float>();
-        trigger.rot.z = st["m_Rot"]["z"].get<float>();
-        trigger.rot.w = st["m_Rot"]["w"].get<float>();
+    void writeVarint(uint64_t value) {
+        while (value >= 0x80) {
+            this->out += (char)(value | 0x80);
+            value >>= 7;
+        }
+        this->out += (char)value;
+    }
+    template<typename T>
+    void writeRaw(T value) {
+        this->out.append(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+    template<typename T>
+    void write(const T &value) {
+        if constexpr (std::is_enum_v<T>) {
+            this->writeRaw((int32_t)value);
+        } else if constexpr (std::is_same_v<T, ArenaString>) {
+            this->writeVarint(value.size());
+            this->out.append(value);
+        } else if constexpr (ListedFields<T>) {
+            Fields<T>::visit(value, value, [this](std::string_view, const auto &x, const auto &) { this->write(x); });
+        } else {
+            static_assert(std::is_trivially_copyable_v<T>);
+            this->writeRaw(value);  // numbers, bools, vectors, quaternions, colors
+        }
+    }
+    template<typename T>
+    void write(const ArenaVector<T> &values) {
+        this->writeVarint(values.size());
+        for (const T &value : values) this->write(value);
+    }
+    // A mask of the fields of b that differ from a, then those fields.
+    template<typename T>
+    void writeChanges(const T &a, const T &b) {
+        uint64_t mask = 0;
+        int bit = 0;
+        Fields<T>::visit(a, b, [&mask, &bit](std::string_view, const auto &x, const auto &y) {
+            if (!same_value(x, y)) mask |= 1ULL << bit;
+            bit++;
+        });
+        this->writeVarint(mask);
+        Fields<T>::visit(a, b, [this](std::string_view, const auto &x, const auto &y) {
+            if (!same_value(x, y)) this->write(y);
+        });
+    }
+    // The operations that build now from old, with their count in front.
+    template<typename T>
+    void writeSection(const ArenaVector<T> &old, const ArenaVector<T> &now) {
+        // GUIDs where the element type has them; the encoded element otherwise, or when the GUID is missing.
+        // Encoded keys live in a deque, which doesn't move them, as the index keeps views of them.
+        std::deque<std::string> contents;
+        auto key_of = [&contents](const T &element) -> std::string_view {
+            if constexpr (KeyedFields<T>) {
+                std::string_view key = Fields<T>::key(element);
+                if (!key.empty()) return key;
+            }
+            PatchWriter encoded;
+            encoded.out += '\x01';  // can't be mistaken for a GUID
+            encoded.write(element);
+            contents.push_back(std::move(encoded.out));
+            return contents.back();
+        };
+        GuidMap old_index;
+        old_index.reserve(old.size());
+        for (std::size_t i = 0; i < old.size(); i++) old_index.add(key_of(old[i]), (int32_t)i);
+
+        PatchWriter ops;
+        uint64_t op_count = 0;
+        uint64_t run_start = 0;
+        uint64_t run_count = 0;
+        auto flush_run = [&]() {
+            if (run_count == 0) return;
+            ops.writeRaw(LayoutPatch::COPY_OP);
+            ops.writeVarint(run_start);
+            ops.writeVarint(run_count);
+            op_count++;
+            run_count = 0;
+        };
+        for (const T &element : now) {
+            int32_t i = old_index.find(key_of(element));
+            if (i >= 0 && same_value(old[i], element)) {
+                if (run_count > 0 && run_start + run_count == (uint64_t)i) {
+                    run_count++;
+                } else {
+                    flush_run();
+                    run_start = (uint64_t)i;
+                    run_count = 1;
+                }
+                continue;
+            }
+            flush_run();
+            if (i >= 0) {
+                ops.writeRaw(LayoutPatch::CHANGE_OP);
+                ops.writeVarint((uint64_t)i);
+                ops.writeChanges(old[i], element);
+            } else {
+                ops.writeRaw(LayoutPatch::ADD_OP);
+                ops.write(element);
+            }
+            op_count++;
+        }
+        flush_run();
 
-        trigger.prefab_name = st["m_PrefabName"].get<std::string>();
+        this->writeVarint(op_count);
+        this->out += ops.out;
+    }
+};
 
-        trigger.rotation_degrees = st["m_RotationDegrees"].get<float>();
-        trigger.stop_vehicle_guid = st["m_StopVehicleGuid"].get<std::string>();
+class PatchReader {
+public:
+    explicit PatchReader(std::string_view in) : in(in) {}
 
-        layout.vehicleStopTriggers.push_back(trigger);
+    bool atEnd() const {
+        return this->pos == this->in.size();
     }
-
-    // Vehicles
-    for (auto &v : j["m_Vehicles"]) {
-        Vehicle vh;
-        vh.acceleration = v["m_Acceleration"].get<float>();
-        vh.braking_force_multiplier = v["m_BrakingForceMultiplier"].get<float>();
-        // checkpoint guids
-        for (auto &g : v["m_CheckpointGuids"]) {
-            vh.checkpoint_guids.push_back(g.get<std::string>());
+    uint64_t readVarint() {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            uint8_t byte = this->readRaw<uint8_t>();
+            value |= (uint64_t)(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) return value;
+        }
+        this->fail("Overlong number");
+    }
+    template<typename T>
+    T readRaw() {
+        this->need(sizeof(T));
+        T value;
+        std::memcpy(&value, this->in.data() + this->pos, sizeof(T));
+        this->pos += sizeof(T);
+        return value;
+    }
+    template<typename T>
+    void read(T &value) {
+        if constexpr (std::is_enum_v<T>) {
+            value = (T)this->readRaw<int32_t>();
+        } else if constexpr (std::is_same_v<T, ArenaString>) {
+            uint64_t size = this->readVarint();
+            this->need(size);
+            value.assign(this->in.data() + this->pos, size);
+            this->pos += size;
+        } else if constexpr (ListedFields<T>) {
+            Fields<T>::visit(value, value, [this](std::string_view, auto &x, auto &) { this->read(x); });
+        } else {
+            value = this->readRaw<T>();
+        }
+    }
+    template<typename T>
+    void read(ArenaVector<T> &values) {
+        uint64_t count = this->readVarint();
+        this->need(count);  // every element takes at least a byte, so this rejects absurd counts early
+        values.clear();
+        values.resize(count);
+        for (T &value : values) this->read(value);
+    }
+    template<typename T>
+    void readChanges(T &element) {
+        uint64_t mask = this->readVarint();
+        int bit = 0;
+        Fields<T>::visit(element, element, [this, mask, &bit](std::string_view, auto &x, auto &) {
+            if (mask & 1ULL << bit) this->read(x);
+            bit++;
+        });
+    }
+    template<typename T>
+    void readSection(const ArenaVector<T> &old, ArenaVector<T> &now) {
+        uint64_t op_count = this->readVarint();
+        now.clear();
+        for (uint64_t op = 0; op < op_count; op++) {
+            switch (this->readRaw<uint8_t>()) {
+                case LayoutPatch::COPY_OP: {
+                    uint64_t start = this->readVarint();
+                    uint64_t count = this->readVarint();
+                    if (start > old.size() || count > old.size() - start) this->fail("Copy out of range");
+                    now.insert(now.end(), old.begin() + (std::ptrdiff_t)start, old.begin() + (std::ptrdiff_t)(start + count));
+                    break;
+                }
+                case LayoutPatch::CHANGE_OP: {
+                    uint64_t index = this->readVarint();
+                    if (index >= old.size()) this->fail("Change out of range");
+                    now.push_back(old[index]);
+                    this->readChanges(now.back());
+                    break;
+                }
+                case LayoutPatch::ADD_OP:
+                    now.emplace_back();
+                    this->read(now.back());
+                    break;
+                default:
+                    this->fail("Unknown operation");
+            }
         }
-        vh.desired_acceleration = v["m_DesiredAcceleration"].get<float>();
-        vh.display_name = v["m_DisplayName"].get<std::string>();
-        vh.flipped = v["m_Flipped"].get<bool>();
-        vh.guid = v["m_Guid"].get<std::string>();
-        vh.idle_on_downhill = v["m_IdleOnDownhill"].get<bool>();
-        vh.mass = v["m_Mass"].get<float>();
-        vh.max_slope = v["m_MaxSlope"].get<float>();
-        vh.ordered_checkpoints = v["m_OrderedCheckpoints"].get<bool>();
+    }
+private:
+    std::string_view in;
+    std::size_t pos = 0;
 
-        vh.pos.x = v["m_Pos"]["x"].get<float>();
-        vh.pos.y = v["m_Pos"]["y"].get<float>();
+    [[noreturn]] void fail(const char *message) const {
+        U::log_error("Invalid patch at offset %s: %s", U::add_commas((int)this->pos).c_str(), message);
+        exit(1);
+    }
+    void need(uint64_t size) const {
+        if (size > this->in.size() - this->pos) this->fail("Unexpected end of patch");
+    }
+};
 
-        vh.prefab_name = v["m_PrefabName"].get<std::string>();
+// The list sections of a layout, in the order a patch stores them; section(old_list, new_list) is called for each.
+template<typename Old, typename New, typename F>
+void patch_sections(Old &old, New &now, F &&section) {
+    section(old.anchors, now.anchors);
+    section(old.phases, now.phases);
+    section(old.bridge.joints, now.bridge.joints);
+    section(old.bridge.edges, now.bridge.edges);
+    section(old.bridge.springs, now.bridge.springs);
+    section(old.bridge.pistons, now.bridge.pistons);
+    section(old.bridge.phases, now.bridge.phases);
+    section(old.bridge.anchors, now.bridge.anchors);
+    section(old.zAxisVehicles, now.zAxisVehicles);
+    section(old.vehicles, now.vehicles);
+    section(old.vehicleStopTriggers, now.vehicleStopTriggers);
+    section(old.eventTimelines, now.eventTimelines);
+    section(old.checkpoints, now.checkpoints);
+    section(old.terrainStretches, now.terrainStretches);
+    section(old.platforms, now.platforms);
+    section(old.ramps, now.ramps);
+    section(old.vehicleRestartPhases, now.vehicleRestartPhases);
+    section(old.flyingObjects, now.flyingObjects);
+    section(old.rocks, now.rocks);
+    section(old.waterBlocks, now.waterBlocks);
+    section(old.customShapes, now.customShapes);
+    section(old.supportPillars, now.supportPillars);
+    section(old.pillars, now.pillars);
+}
 
-        vh.rot.x = v["m_Rot"]["x"].get<float>();
-        vh.rot.y = v["m_Rot"]["y"].get<float>();
-        vh.rot.z = v["m_Rot"]["z"].get<float>();
-        vh.rot.w = v["m_Rot"]["w"].get<float>();
+// old_size and old_hash are LayoutPatch::fingerprint of the file old was read from.
+std::string make_layout_patch(const Layout &old, uint64_t old_size, uint64_t old_hash, const Layout &now) {
+    PatchWriter w;
+    w.out.append(LayoutPatch::MAGIC, sizeof(LayoutPatch::MAGIC));
+    w.writeRaw(LayoutPatch::FORMAT_VERSION);
+    w.writeRaw(old_size);
+    w.writeRaw(old_hash);
+
+    w.writeRaw((int32_t)now.version);
+    w.write(now.stubKey);
+    w.writeRaw((int32_t)now.bridge.version);
+    patch_sections(old, now, [&w](const auto &a, const auto &b) { w.writeSection(a, b); });
+    w.writeChanges(old.budget, now.budget);
+    w.writeChanges(old.settings, now.settings);
+    w.writeChanges(old.workshop, now.workshop);
+    return std::move(w.out);
+}
 
-        vh.rotation_degrees = v["m_RotationDegrees"].get<float>();
-        vh.strength_method = (StrengthMethod)v["m_StrengthMethod"].get<int>();
-        vh.time_delay = v["m_TimeDelaySeconds"].get<float>();
-        layout.vehicles.push_back(vh);
+Layout apply_layout_patch(const Layout &old, uint64_t old_size, uint64_t old_hash, std::string_view patch) {
+    PatchReader r(patch);
+    if (patch.size() < sizeof(LayoutPatch::MAGIC) || std::memcmp(patch.data(), LayoutPatch::MAGIC, sizeof(LayoutPatch::MAGIC)) != 0) {
+        U::log_error("Not a layout patch.");
+        exit(1);
     }
-
-    // Platforms
-    for (auto &p : j["m_Platforms"]) {
-        Platform platform{};
-        platform.flipped = p["m_Flipped"].get<bool>();
-        platform.height = p["m_Height"].get<float>();
-        platform.pos.x = p["m_Pos"]["x"].get<float>();
-        platform.pos.y = p["m_Pos"]["y"].get<float>();
-        platform.solid = p["m_Solid"].get<bool>();
-        platform.width = p["m_Width"].get<float>();
-        layout.platforms.push_back(platform);
+    for (std::size_t i = 0; i < sizeof(LayoutPatch::MAGIC); i++) r.readRaw<char>();
+    uint32_t format_version = r.readRaw<uint32_t>();
+    if (format_version != LayoutPatch::FORMAT_VERSION) {
+        U::log_error("Unsupported patch format version %s.", std::to_string(format_version).c_str());
+        exit(1);
+    }
+    uint64_t expected_size = r.readRaw<uint64_t>();
+    uint64_t expected_hash = r.readRaw<uint64_t>();
+    if (expected_size != old_size || expected_hash != old_hash) {
+        U::log_error("The patch was made for a different revision of this layout.");
+        exit(1);
     }
 
-    // Ramps
-    for (auto &r : j["m_Ramps"]) {
-        Ramp ramp{};
-        ramp.flipped_vertical = r["m_FlippedVertical"].get<bool>();
-        ramp.flipped_horizontal = r["m_FlippedHorizontal"].get<bool>();
-        ramp.flipped_legs = r["m_FlippedLegs"].get<bool>();
-        ramp.height = r["m_Height"].get<float>();
-        ramp.hide_legs = r["m_HideLegs"].get<bool>();
-        ramp.num_segments = r["m_NumSegments"].get<int>();
-        ramp.spline_type = (SplineType)r["m_SplineType"].get<int>();
-
-        ramp.pos.x = r["m_Pos"]["x"].get<float>();
-        ramp.pos.y = r["m_Pos"]["y"].get<float>();
+    Layout now;
+    now.version = r.readRaw<int32_t>();
+    r.read(now.stubKey);
+    now.bridge.version = r.readRaw<int32_t>();
+    patch_sections(old, now, [&r](const auto &a, auto &b) { r.readSection(a, b); });
+    now.budget = old.budget;
+    r.readChanges(now.budget);
+    now.settings = old.settings;
+    r.readChanges(now.settings);
+    now.workshop = old.workshop;
+    r.readChanges(now.workshop);
+    if (!r.atEnd()) {
+        U::log_error("Unexpected data after the end of the patch.");
+        exit(1);
+    }
+    return now;
+}
 
-        // Line points
-        for (auto &p : r["m_LinePoints"]) {
-            ramp.line_points.push_back(Vec2{p["x"].get<float>(), p["y"].get<float>()});
+// Canonical hashing
+//   Layout::canonicalHash identifies a level by what's in it rather than by its bytes, so the same level saved by
+//   different game versions, or re-saved by PolyParser at MAX_VERSION, hashes the same. Each element is hashed on
+//   its own from its field list, and a section from the sorted hashes of its elements, which makes the order they
+//   are stored in irrelevant; lists inside an element keep their order. Left out is everything that only depends on
+//   how the file was written: the layout and bridge versions, edge GUIDs (only stored from version 11 on), and the
+//   obsolete theme objects and mod data, which Serializer doesn't write back. The workshop block describes an upload
+//   rather than the level and is left out too. Nothing is built besides one hash per element of the section at hand.
+class ContentHasher {
+public:
+    void add(float value) {
+        if (value == 0) value = 0;  // -0
+        if (std::isnan(value)) value = std::numeric_limits<float>::quiet_NaN();
+        this->hash.updateValue(value);
+    }
+    void add(const Vec2 &v) {
+        this->add(v.x);
+        this->add(v.y);
+    }
+    void add(const Vec3 &v) {
+        this->add(v.x);
+        this->add(v.y);
+        this->add(v.z);
+    }
+    void add(const Quaternion &q) {
+        this->add(q.x);
+        this->add(q.y);
+        this->add(q.z);
+        this->add(q.w);
+    }
+    void add(const Color &c) {
+        this->add(c.r);
+        this->add(c.g);
+        this->add(c.b);
+        this->add(c.a);
+    }
+    template<typename T>
+    void add(const T &value) {
+        if constexpr (std::is_enum_v<T>) {
+            this->hash.updateValue((int32_t)value);
+        } else if constexpr (std::is_same_v<T, bool>) {
+            this->hash.updateValue((uint8_t)value);
+        } else if constexpr (std::is_same_v<T, ArenaString>) {
+            this->hash.updateValue((uint64_t)value.size());
+            this->hash.update(value);
+        } else if constexpr (ListedFields<T>) {
+            Fields<T>::visit(value, value, [this](std::string_view name, const auto &x, const auto &) {
+                if (std::is_same_v<T, BridgeEdge> && name == "m_Guid") return;
+                this->add(x);
+            });
+        } else {
+            static_assert(std::is_integral_v<T>);
+            this->hash.updateValue(value);
         }
-
-        // Control points
-        for (auto &p : r["m_ControlPoints"]) {
-            ramp.control_points.push_back(Vec2{p["x"].get<float>(), p["y"].get<float>()});
+    }
+    template<typename T>
+    void add(const ArenaVector<T> &values) {
+        this->hash.updateValue((uint64_t)values.size());
+        for (const T &value : values) this->add(value);
+    }
+    // A whole section, regardless of the order of its elements.
+    template<typename T>
+    void addSection(const ArenaVector<T> &elements) {
+        ArenaVector<uint64_t> hashes;
+        hashes.reserve(elements.size());
+        for (const T &element : elements) {
+            ContentHasher element_hash;
+            element_hash.add(element);
+            hashes.push_back(element_hash.digest());
         }
-
-        layout.ramps.push_back(ramp);
+        std::sort(hashes.begin(), hashes.end());
+        this->hash.updateValue((uint64_t)hashes.size());
+        this->hash.update(hashes.data(), hashes.size() * sizeof(uint64_t));
     }
+    uint64_t digest() const {
+        return this->hash.digest();
+    }
+private:
+    Hash::Xxh64 hash;
+};
 
-    // Finally, rocks
-    for (auto &r : j["m_Rocks"]) {
-        Rock rock{};
-        rock.flipped = r["m_Flipped"].get<bool>();
+uint64_t Layout::canonicalHash() const {
+    ContentHasher h;
+    h.add(this->stubKey);
+    patch_sections(*this, *this, [&h](const auto &section, const auto &) { h.addSection(section); });
+    h.add(this->budget);
+    h.add(this->settings);
+    return h.digest();
+}
 
-        rock.pos.x = r["m_Pos"]["x"].get<float>();
-        rock.pos.y = r["m_Pos"]["y"].get<float>();
-        rock.pos.z = r["m_Pos"]["z"].get<float>();
+// The fields SlotDeserializer::deserializeSlotHeader reads, as keys of the current object.
+template<typename Writer>
+void write_slot_header(Writer &w, const SaveSlot &slot) {
+    w.key("m_Version"); w.value((int32_t)slot.version);
+    w.key("m_PhysicsVersion"); w.value((int32_t)slot.physicsVersion);
+    w.key("m_SlotID"); w.value((int32_t)slot.slotId);
+    w.key("m_DisplayName"); w.value(std::string_view(slot.displayName));
+    w.key("m_SlotFileName"); w.value(std::string_view(slot.fileName));
+    w.key("m_Budget"); w.value((int32_t)slot.budget);
+    w.key("m_LastWriteTimeTicks"); w.value((int64_t)slot.lastWriteTimeTicks);
+}
 
-        rock.prefab_name = r["m_PrefabName"].get<std::string>();
+template<typename Writer>
+void write_slot(Writer &w, const SaveSlot &slot) {
+    w.beginObject();
+    write_slot_header(w, slot);
+
+    w.key("m_Bridge");
+    w.beginObject();
+    w.key("m_Version"); w.value((int32_t)slot.bridge.version);
+    w.key("m_BridgeJoints");
+    w.beginArray();
+    for (const BridgeJoint& joint : slot.bridge.joints) write_joint(w, joint, false);
+    w.endArray();
+    w.key("m_BridgeEdges");
+    w.beginArray();
+    for (const BridgeEdge& e : slot.bridge.edges) {
+        w.beginObject();
+        w.key("m_MaterialType"); w.value((int32_t)e.material_type);
+        w.key("m_NodeA_Guid"); w.value(std::string_view(e.node_a_guid));
+        w.key("m_NodeB_Guid"); w.value(std::string_view(e.node_b_guid));
+        w.key("m_JointAPart"); w.value((int32_t)e.joint_a_part);
+        w.key("m_JointBPart"); w.value((int32_t)e.joint_b_part);
+        w.endObject();
+    }
+    w.endArray();
+    w.key("m_BridgeSprings");
+    w.beginArray();
+    for (const BridgeSpring& s : slot.bridge.springs) {
+        w.beginObject();
+        w.key("m_NormalizedValue"); w.value(s.normalized_value);
+        w.key("m_NodeA_Guid"); w.value(std::string_view(s.node_a_guid));
+        w.key("m_NodeB_Guid"); w.value(std::string_view(s.node_b_guid));
+        w.key("m_Guid"); w.value(std::string_view(s.guid));
+        w.endObject();
+    }
+    w.endArray();
+    w.key("m_Pistons");
+    w.beginArray();
+    for (const Piston& p : slot.bridge.pistons) {
+        w.beginObject();
+        w.key("m_NormalizedValue"); w.value(p.normalized_value);
+        w.key("m_NodeA_Guid"); w.value(std::string_view(p.node_a_guid));
+        w.key("m_NodeB_Guid"); w.value(std::string_view(p.node_b_guid));
+        w.key("m_Guid"); w.value(std::string_view(p.guid));
+        w.endObject();
+    }
+    w.endArray();
+    w.key("m_Anchors");
+    w.beginArray();
+    for (const BridgeJoint& a : slot.bridge.anchors) write_joint(w, a, false);
+    w.endArray();
+    w.key("m_HydraulicsController");
+    w.beginObject();
+    w.key("m_Phases");
+    w.beginArray();
+    for (const HydraulicsControllerPhase& p : slot.bridge.phases) {
+        w.beginObject();
+        w.key("m_HydraulicsPhaseGuid"); w.value(std::string_view(p.hydraulics_phase_guid));
+        write_strings(w, "m_PistonGuids", p.piston_guids);
+        w.key("m_BridgeSplitJoints");
+        w.beginArray();
+        for (const BridgeSplitJoint& joint : p.bridge_split_joints) {
+            w.beginObject();
+            w.key("m_BridgeJointGuid"); w.value(std::string_view(joint.guid));
+            w.key("m_SplitJointState"); w.value((int32_t)joint.state);
+            w.endObject();
+        }
+        w.endArray();
+        w.endObject();
+    }
+    w.endArray();
+    w.endObject();
+    w.endObject();
+
+    w.key("m_UsingUnlimitedMaterials"); w.value(slot.unlimitedMaterials);
+    w.key("m_UsingUnlimitedBudget"); w.value(slot.unlimitedBudget);
+    w.endObject();
+}
 
-        rock.scale.x = r["m_Scale"]["x"].get<float>();
-        rock.scale.y = r["m_Scale"]["y"].get<float>();
-        rock.scale.z = r["m_Scale"]["z"].get<float>();
+json slot_to_json(const SaveSlot& slot) {
+    JsonDomWriter writer;
+    write_slot(writer, slot);
+    return std::move(writer.document);
+}
 
-        layout.rocks.push_back(rock);
+void dump_slot_json(const SaveSlot& slot, const std::string& path, const OutputOptions &options = {}) {
+    if (options.format == YAML_DOCUMENT) {
+        Compression::OutputFile of(path, std::ios::out);
+        if (!of.is_open()) {
+            U::log_error("Could not open %s for writing", path.c_str());
+            exit(1);
+        }
+        YamlWriter writer(of, options.precision);
+        write_slot(writer, slot);
+        writer.finish();
+        return;
     }
-
-    return layout;
+    json j = slot_to_json(slot);
+    write_json(j, path, options);
 }
 
-void dump_slot_json(const SaveSlot& slot, const std::string& path) {
-    json j;
-    j["m_Version"] = slot.version;
-    j["m_PhysicsVersion"] = slot.physicsVersion;
-    j["m_SlotID"] = slot.slotId;
-    j["m_DisplayName"] = slot.displayName;
-    j["m_SlotFileName"] = slot.fileName;
-    j["m_Budget"] = slot.budget;
-    j["m_LastWriteTimeTicks"] = slot.lastWriteTimeTicks;
-    auto b = nlohmann::json::object();
-    b["m_Version"] = slot.bridge.version;
-    b["m_BridgeJoints"] = nlohmann::json::array();
-    for (const BridgeJoint& jnt : slot.bridge.joints) {
-        auto joint = nlohmann::json::object();
-        joint["m_Pos"]["x"] = jnt.pos.x;
-        joint["m_Pos"]["y"] = jnt.pos.y;
-        joint["m_Pos"]["z"] = jnt.pos.z;
-
-        joint["m_IsAnchor"] = jnt.is_anchor;
-        joint["m_IsSplit"] = jnt.is_split;
-
-        joint["m_Guid"] = jnt.guid;
-        b["m_BridgeJoints"].push_back(joint);
-    }
-    b["m_BridgeEdges"] = nlohmann::json::array();
-    for (const BridgeEdge& e : slot.bridge.edges) {
-        auto edge = nlohmann::json::object();
-        edge["m_MaterialType"] = e.material_type;
-        edge["m_NodeA_Guid"] = e.node_a_guid;
-        edge["m_NodeB_Guid"] = e.node_b_guid;
-        edge["m_JointAPart"] = e.joint_a_part;
-        edge["m_JointBPart"] = e.joint_b_part;
+// A slot listing: one object per slot with the path it was read from and its header fields.
+struct SlotListing {
+    std::string path;
+    SaveSlot slot;
+};
 
-        b["m_BridgeEdges"].push_back(edge);
+template<typename Writer>
+void write_slot_listing(Writer &w, const std::vector<SlotListing> &listing) {
+    w.beginArray();
+    for (const SlotListing &entry : listing) {
+        w.beginObject();
+        w.key("path"); w.value(std::string_view(entry.path));
+        write_slot_header(w, entry.slot);
+        w.endObject();
     }
-    b["m_BridgeSprings"] = nlohmann::json::array();
-    for (const BridgeSpring& s : slot.bridge.springs) {
-        auto spring = nlohmann::json::object();
-        spring["m_NormalizedValue"] = s.normalized_value;
-        spring["m_NodeA_Guid"] = s.node_a_guid;
-        spring["m_NodeB_Guid"] = s.node_b_guid;
-        spring["m_Guid"] = s.guid;
+    w.endArray();
+}
 
-        b["m_BridgeSprings"].push_back(spring);
+void dump_slot_listing(const std::vector<SlotListing> &listing, const std::string& path, const OutputOptions &options = {}) {
+    if (options.format == YAML_DOCUMENT) {
+        Compression::OutputFile of(path, std::ios::out);
+        if (!of.is_open()) {
+            U::log_error("Could not open %s for writing", path.c_str());
+            exit(1);
+        }
+        YamlWriter writer(of, options.precision);
+        write_slot_listing(writer, listing);
+        writer.finish();
+        return;
     }
-    b["m_Pistons"] = nlohmann::json::array();
-    for (const Piston& p : slot.bridge.pistons) {
-        auto piston = nlohmann::json::object();
-        piston["m_NormalizedValue"] = p.normalized_value;
-        piston["m_NodeA_Guid"] = p.node_a_guid;
-        piston["m_NodeB_Guid"] = p.node_b_guid;
-        piston["m_Guid"] = p.guid;
+    JsonDomWriter writer;
+    write_slot_listing(writer, listing);
+    write_json(writer.document, path, options);
+}
 
-        b["m_Pistons"].push_back(piston);
+SaveSlot slot_from_json(json &j) {
+    SaveSlot slot;
+    slot.version = j["m_Version"].get<int>();
+    slot.physicsVersion = j["m_PhysicsVersion"].get<int>();
+    slot.slotId = j["m_SlotID"].get<int>();
+    slot.displayName = j["m_DisplayName"].get<std::string>();
+    slot.fileName = j["m_SlotFileName"].get<std::string>();
+    slot.budget = j["m_Budget"].get<int>();
+    slot.lastWriteTimeTicks = j["m_LastWriteTimeTicks"].get<long>();
+
+    auto &b = j["m_Bridge"];
+    slot.bridge.version = b["m_Version"].get<int>();
+    for (auto &jo : b["m_BridgeJoints"]) {
+        BridgeJoint joint;
+        joint.pos.x = jo["m_Pos"]["x"].get<float>();
+        joint.pos.y = jo["m_Pos"]["y"].get<float>();
+        joint.pos.z = jo["m_Pos"]["z"].get<float>();
+        joint.is_anchor = jo["m_IsAnchor"].get<bool>();
+        joint.is_split = jo["m_IsSplit"].get<bool>();
+        joint.guid = jo["m_Guid"].get<std::string>();
+        slot.bridge.joints.push_back(joint);
     }
-    b["m_Anchors"] = nlohmann::json::array();
-    for (const BridgeJoint& a : slot.bridge.anchors) {
-        auto anchor = nlohmann::json::object();
-        anchor["m_Pos"]["x"] = a.pos.x;
-        anchor["m_Pos"]["y"] = a.pos.y;
-        anchor["m_Pos"]["z"] = a.pos.z;
-
-        anchor["m_IsAnchor"] = a.is_anchor;
-        anchor["m_IsSplit"] = a.is_split;
-
-        anchor["m_Guid"] = a.guid;
-        b["m_Anchors"].push_back(anchor);
+    for (auto &e : b["m_BridgeEdges"]) {
+        BridgeEdge edge;
+        edge.material_type = (BridgeMaterialType)e["m_MaterialType"].get<int>();
+        edge.node_a_guid = e["m_NodeA_Guid"].get<std::string>();
+        edge.node_b_guid = e["m_NodeB_Guid"].get<std::string>();
+        edge.joint_a_part = (SplitJointPart)e["m_JointAPart"].get<int>();
+        edge.joint_b_part = (SplitJointPart)e["m_JointBPart"].get<int>();
+        slot.bridge.edges.push_back(edge);
     }
-    b["m_HydraulicsController"]["m_Phases"] = nlohmann::json::array();
-    for (const HydraulicsControllerPhase& p : slot.bridge.phases) {
-        auto phase = nlohmann::json::object();
-        phase["m_HydraulicsPhaseGuid"] = p.hydraulics_phase_guid;
-        phase["m_PistonGuids"] = nlohmann::json::array();
-        for (const std::string& g : p.piston_guids) {
-            phase["m_PistonGuids"].push_back(g);
+    for (auto &s : b["m_BridgeSprings"]) {
+        BridgeSpring spring;
+        spring.normalized_value = s["m_NormalizedValue"].get<float>();
+        spring.node_a_guid = s["m_NodeA_Guid"].get<std::string>();
+        spring.node_b_guid = s["m_NodeB_Guid"].get<std::string>();
+        spring.guid = s["m_Guid"].get<std::string>();
+        slot.bridge.springs.push_back(spring);
+    }
+    for (auto &ps : b["m_Pistons"]) {
+        Piston piston;
+        piston.normalized_value = ps["m_NormalizedValue"].get<float>();
+        piston.node_a_guid = ps["m_NodeA_Guid"].get<std::string>();
+        piston.node_b_guid = ps["m_NodeB_Guid"].get<std::string>();
+        piston.guid = ps["m_Guid"].get<std::string>();
+        slot.bridge.pistons.push_back(piston);
+    }
+    for (auto &a : b["m_Anchors"]) {
+        BridgeJoint anchor;
+        anchor.pos.x = a["m_Pos"]["x"].get<float>();
+        anchor.pos.y = a["m_Pos"]["y"].get<float>();
+        anchor.pos.z = a["m_Pos"]["z"].get<float>();
+        anchor.is_anchor = a["m_IsAnchor"].get<bool>();
+        anchor.is_split = a["m_IsSplit"].get<bool>();
+        anchor.guid = a["m_Guid"].get<std::string>();
+        slot.bridge.anchors.push_back(anchor);
+    }
+    for (auto &p : b["m_HydraulicsController"]["m_Phases"]) {
+        HydraulicsControllerPhase phase;
+        phase.hydraulics_phase_guid = p["m_HydraulicsPhaseGuid"].get<std::string>();
+        for (auto &pg : p["m_PistonGuids"]) {
+            phase.piston_guids.emplace_back(pg.get<std::string>());
         }
-        phase["m_BridgeSplitJoints"] = nlohmann::json::array();
-        for (const BridgeSplitJoint& jobj : p.bridge_split_joints) {
-            auto sj = nlohmann::json::object();
-            sj["m_BridgeJointGuid"] = jobj.guid;
-            sj["m_SplitJointState"] = jobj.state;
+        for (auto &sj : p["m_BridgeSplitJoints"]) {
+            BridgeSplitJoint split_joint;
+            split_joint.guid = sj["m_BridgeJointGuid"].get<std::string>();
+            split_joint.state = (SplitJointState)sj["m_SplitJointState"].get<int>();
+            phase.bridge_split_joints.push_back(split_joint);
         }
-        b["m_HydraulicsController"]["m_Phases"].push_back(phase);
+        slot.bridge.phases.push_back(phase);
     }
-    j["m_Bridge"] = b;
-
-    j["m_UsingUnlimitedMaterials"] = slot.unlimitedMaterials;
-    j["m_UsingUnlimitedBudget"] = slot.unlimitedBudget;
 
-    std::ofstream of(path, std::ios::out);
-    of << j.dump(2);
-    of.close();
+    slot.unlimitedMaterials = j["m_UsingUnlimitedMaterials"].get<bool>();
+    slot.unlimitedBudget = j["m_UsingUnlimitedBudget"].get<bool>();
+    return slot;
 }
 
 
 int main(int argc, char **argv) {
     const std::string help_msg = R"END(
     Usage:
-        %s [-h] [-s | --silent] [-v | --verbose] [-o | --output <path>] [-t | --type (json|yaml)] <path>
+        %s [options] diff <a> <b>
+        %s [options] patch <old> <new>
+        %s [options] apply <old> <patch>
+        %s [options] hash <path>...
+        %s [options] cost <path>
+        %s [options] overlaps <path>
+        %s [-h] [-s | --silent] [-v | --verbose] [-o | --output <path>] [-t | --type (json|yaml|msgpack|cbor)] [-p | --precision <digits>] [-c | --compact] [-i | --indent <n>] [-C | --columnar <dir>] [-T | --thumbnail <path>] [-m | --metadata] [-f | --fields <list>] [-I | --index <file>] [-K | --cache <dir>] [--cache-size <MiB>] [-w | --watch] <path>...
     Options:
         -h, --help              Show this help message and exit.
         -s, --silent            Don't print anything to stdout.
-        -o, --output <path>     Define the output path, otherwise will be <path>.json or <path>.layout.
-        -t, --type <type>       The type of the output. Either JSON or YAML. Not yet implemented, defaults to JSON.
+        -o, --output <path>     Define the output path, otherwise will be <path>.<type> or <path>.layout.
+        -t, --type <type>       The type of the output: json (default), yaml, msgpack or cbor. All use the same keys.
+        -p, --precision <n>     Round floats in JSON output to n decimal places. By default, each float is written
+                                with the fewest digits that read back as exactly the same value.
+        -c, --compact           Write JSON on a single line without any whitespace.
+        -i, --indent <n>        Indent JSON output by n spaces per level (default 2). With 0, every value is still on
+                                a line of its own, just not indented; use --compact for a single line.
+        -C, --columnar <dir>    Also append the layout to the columnar dataset in dir (see schema.json there).
+        -T, --thumbnail <path>  Also write a save slot's thumbnail to path, byte for byte as stored in the slot.
+        -m, --metadata          List save slots instead of converting them: <path> is a .slot file or a folder of
+                                them, and only the header of each (ID, names, budget, last write time) is read. The
+                                list is written to <path>.<type>, or <folder>/slots.<type> for a folder.
+        -f, --fields <list>     Only decode and write these layout sections, comma separated, e.g.
+                                bridge,budget,workshop. The others are skipped in the file. Sections: anchors, phases,
+                                bridge, zAxisVehicles, vehicles, vehicleStopTriggers, themeObjects, eventTimelines,
+                                checkpoints, terrainStretches, platforms, ramps, vehicleRestartPhases, flyingObjects,
+                                rocks, waterBlocks, budget, settings, customShapes, workshop, supportPillars, pillars,
+                                modData. A projected document can't be converted back into a layout.
+        -I, --index <file>      With --fields, keep the layout's section offsets in file, so later runs on the same
+                                layout jump straight to the requested sections.
+        -K, --cache <dir>       Keep converted layout and slot documents in dir, keyed by the input's contents and the
+                                output options. Converting identical bytes again copies the cached document instead.
+        --cache-size <MiB>      Size limit for the cache; least recently used documents are removed (default 1024).
+        -w, --watch             Keep running and convert .layout.json files to .layout again every time they are
+                                saved. Each <path> is a file or a folder, whose .layout.json files are all watched.
+                                Only the parts of a layout that changed since the last save are parsed again.
+        --prices <list>         Prices per meter for cost, comma separated, e.g. road=200,steel=450. Materials: road,
+                                reinforcedRoad, wood, steel, hydraulics, rope, cable, bungeeRope, spring. Bungee
+                                rope and springs have no default price and are left out of the cost without one.
+        --radius <m>            How close a joint has to be to an object for overlaps to report it (default 0.5).
+        --check                 Have overlaps answer every query by scanning all objects too, and fail if the two
+                                ever disagree.
+    Commands:
+        diff <a> <b>            Compare two layouts element by element, matched by GUID, and write what was added,
+                                removed or changed in b to <b>.diff.<type> (or --output). Either may be any layout
+                                format PolyParser reads.
+        patch <old> <new>       Write the changes that turn layout old into new to <new>.patch (or --output). Only
+                                what changed is stored, so patches of small edits are a few hundred bytes.
+        apply <old> <patch>     Apply a patch to the layout it was made from and write the new revision as .layout:
+                                <patch> without .patch, or --output.
+        hash <path>...          Print a hash of each layout's contents, the same for copies of a level whatever order
+                                its elements are stored in and whichever version saved it.
+        cost <path>             Work out what the bridge in a layout or save slot costs and how many meters of each
+                                material it uses, and write that to <path>.cost.<type> (or --output), checked against
+                                the layout's budget or the cost the slot was saved with. Also reports the bridge's
+                                extent and total edge length, joints that aren't connected to an anchor and member
+                                ends that refer to a missing joint.
+        overlaps <path>         List the bridge joints within --radius of terrain, rocks, custom shapes, water blocks
+                                or platforms, and how close the bridge comes to the terrain, in <path>.overlaps.<type>
+                                (or --output). Terrain and rocks are only positions and other objects are boxes
+                                around them, so this finds candidates rather than exact collisions.
     Notes:
         Files formats are based on the extension. If you feed the converter a file with the extension .layout that is
-        not a layout file, it will cause issues.
+        not a layout file, it will cause issues. Layouts can also be read from .layout.msgpack and .layout.cbor.
+        Save slots convert to documents the same way, and .slot.json (.msgpack, .cbor) files convert back to .slot.
+        Any of them may end in .gz or .zst to be read or written compressed, e.g. bridge.layout.json.zst.
 
     )END";
 
     if (argc < 2) {
-        printf(help_msg.c_str(), argv[0]);
+        printf(help_msg.c_str(), argv[0], argv[0], argv[0], argv[0], argv[0], argv[0], argv[0]);
         return 1;
     }
 
+    const option long_options[] = {
+            {"help", no_argument, nullptr, 'h'},
+            {"silent", no_argument, nullptr, 's'},
+            {"output", required_argument, nullptr, 'o'},
+            {"type", required_argument, nullptr, 't'},
+            {"precision", required_argument, nullptr, 'p'},
+            {"compact", no_argument, nullptr, 'c'},
+            {"indent", required_argument, nullptr, 'i'},
+            {"columnar", required_argument, nullptr, 'C'},
+            {"thumbnail", required_argument, nullptr, 'T'},
+            {"metadata", no_argument, nullptr, 'm'},
+            {"fields", required_argument, nullptr, 'f'},
+            {"index", required_argument, nullptr, 'I'},
+            {"cache", required_argument, nullptr, 'K'},
+            {"cache-size", required_argument, nullptr, 1000},
+            {"prices", required_argument, nullptr, 1001},
+            {"radius", required_argument, nullptr, 1002},
+            {"check", no_argument, nullptr, 1003},
+            {"watch", no_argument, nullptr, 'w'},
+            {nullptr, 0, nullptr, 0}
+    };
+
     int c;
     bool custom_path = false;
     std::string output_path;
-    while ((c = getopt(argc, argv, "hso:")) != -1) {
+    OutputOptions output_options;
+    std::string columnar_directory;
+    std::string thumbnail_path;
+    bool metadata_only = false;
+    std::string index_path;
+    std::string cache_directory;
+    uint64_t cache_size = 1024;
+    bool watch = false;
+    MaterialPrices prices;
+    float overlap_radius = 0.5f;
+    bool check_overlaps = false;
+    while ((c = getopt_long(argc, argv, "hso:t:p:ci:C:T:mf:I:K:w", long_options, nullptr)) != -1) {
         switch (c) {
             case 'h':
-                printf(help_msg.c_str(), argv[0]);
+                printf(help_msg.c_str(), argv[0], argv[0], argv[0], argv[0], argv[0], argv[0], argv[0]);
                 return 0;
             case 's':
                 silent = true;
@@ -3784,6 +8901,86 @@ int main(int argc, char **argv) {
                     return 1;
                 }
 
+                break;
+            case 't':
+                if (strcmp(optarg, "json") == 0) {
+                    output_options.format = JSON_DOCUMENT;
+                } else if (strcmp(optarg, "yaml") == 0) {
+                    output_options.format = YAML_DOCUMENT;
+                } else if (strcmp(optarg, "msgpack") == 0) {
+                    output_options.format = MSGPACK_DOCUMENT;
+                } else if (strcmp(optarg, "cbor") == 0) {
+                    output_options.format = CBOR_DOCUMENT;
+                } else {
+                    U::log_error("Unknown output type %s, expected json, yaml, msgpack or cbor.", optarg);
+                    return 1;
+                }
+                break;
+            case 'p':
+                output_options.precision = (int)std::strtol(optarg, nullptr, 10);
+                if (output_options.precision < 0 || output_options.precision > 9) {
+                    U::log_error("Precision must be between 0 and 9.");
+                    return 1;
+                }
+                break;
+            case 'c':
+                output_options.indent = -1;
+                break;
+            case 'i':
+                output_options.indent = (int)std::strtol(optarg, nullptr, 10);
+                if (output_options.indent < 0 || output_options.indent > 16) {
+                    U::log_error("Indent must be between 0 and 16.");
+                    return 1;
+                }
+                break;
+            case 'C':
+                columnar_directory = optarg;
+                break;
+            case 'T':
+                thumbnail_path = optarg;
+                if (!U::directory_of_file_exists(thumbnail_path)) {
+                    U::log_error("Directory of thumbnail path does not exist.");
+                    return 1;
+                }
+                break;
+            case 'm':
+                metadata_only = true;
+                break;
+            case 'f':
+                if (!parse_section_list(optarg, output_options.fields)) {
+                    return 1;
+                }
+                break;
+            case 'I':
+                index_path = optarg;
+                break;
+            case 'K':
+                cache_directory = optarg;
+                break;
+            case 1000:
+                cache_size = std::strtoull(optarg, nullptr, 10);
+                if (cache_size == 0) {
+                    U::log_error("Cache size must be at least 1 MiB.");
+                    return 1;
+                }
+                break;
+            case 'w':
+                watch = true;
+                break;
+            case 1001:
+                if (!parse_price_list(optarg, prices)) {
+                    return 1;
+                }
+                break;
+            case 1002:
+                overlap_radius = std::strtof(optarg, nullptr);
+                if (!(overlap_radius >= 0) || std::isinf(overlap_radius)) {
+                    U::log_error("Radius must be a distance of 0 or more.");
+                    return 1;
+                }
+                break;
+            case 1003:
+                check_overlaps = true;
                 break;
             default:
                 break;
@@ -3791,6 +8988,221 @@ int main(int argc, char **argv) {
     }
 
     std::string path = argv[argc - 1];
+
+    if (argc - optind == 3 && strcmp(argv[optind], "diff") == 0) {
+        std::string a_path = argv[optind + 1];
+        std::string b_path = argv[optind + 2];
+        Arena::Scope arena;
+        Layout a = load_layout(a_path);
+        Layout b = load_layout(b_path);
+
+        auto diff_start = std::chrono::steady_clock::now();
+        LayoutDiff diff(a, b);
+        double ms = (double)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - diff_start).count() / 1000.0;
+
+        std::string diff_path = custom_path
+                ? output_path
+                : std::string(Compression::stripSuffix(b_path)) + ".diff." + document_extension(output_options.format);
+        dump_layout_diff(diff, a_path, b_path, diff_path, output_options);
+        auto counts = [](const char *name, const SectionDiff &section) {
+            return std::string(name) + " +" + std::to_string(section.added.size()) +
+                   " -" + std::to_string(section.removed.size()) +
+                   " ~" + std::to_string(section.changed.size());
+        };
+        Utils::log_info("Compared in %.2fms: %s, %s, %s, %s", ms, counts("joints", diff.joints).c_str(),
+                        counts("edges", diff.edges).c_str(), counts("vehicles", diff.vehicles).c_str(),
+                        same_value(a.budget, b.budget) ? "budget unchanged" : "budget changed");
+        Utils::log_info("Wrote diff to " + diff_path);
+        return 0;
+    }
+
+    if (argc - optind == 2 && strcmp(argv[optind], "overlaps") == 0) {
+        std::string source = argv[optind + 1];
+        Arena::Scope arena;
+        Layout layout = load_layout(source);
+
+        auto start = std::chrono::steady_clock::now();
+        SpatialIndex index = SpatialIndex::build(layout);
+        OverlapReport report = find_joint_overlaps(layout, index, overlap_radius, check_overlaps);
+        double ms = (double)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count() / 1000.0;
+
+        std::string overlaps_path = custom_path
+                ? output_path
+                : std::string(Compression::stripSuffix(source)) + ".overlaps." + document_extension(output_options.format);
+        dump_joint_overlaps(report, layout, source, overlap_radius, overlaps_path, output_options);
+        Utils::log_info("%s of %s joints touch the scene (%s objects indexed, %.2fms)", U::add_commas((int64_t)report.overlaps.size()).c_str(),
+                        U::add_commas((int64_t)(layout.bridge.joints.size() + layout.bridge.anchors.size())).c_str(),
+                        U::add_commas((int64_t)index.size()).c_str(), ms);
+        Utils::log_info("Wrote overlaps to " + overlaps_path);
+        if (check_overlaps) {
+            if (report.mismatches > 0) {
+                U::log_error("The spatial index disagreed with a full scan for %s joints.", U::add_commas((int64_t)report.mismatches).c_str());
+                return 1;
+            }
+            Utils::log_info("Every query matched a full scan.");
+        }
+        return 0;
+    }
+
+    if (argc - optind == 2 && strcmp(argv[optind], "cost") == 0) {
+        std::string source = argv[optind + 1];
+        std::string_view format = Compression::stripSuffix(source);
+        std::string cost_path = custom_path ? output_path : std::string(format) + ".cost." + document_extension(output_options.format);
+        Arena::Scope arena;
+        BridgeCost cost;
+        BridgeStructure structure;
+        std::string summary;
+        auto report = [&](const Bridge &bridge, const Budget *budget, const int32_t *saved_cost) {
+            BridgeGraph graph = BridgeGraph::resolve(bridge);
+            BridgeSoA soa = BridgeSoA::fromBridge(bridge, graph);
+            cost = BridgeCost::compute(soa, prices);
+            structure = BridgeStructure::analyze(graph, soa);
+            dump_bridge_cost(cost, graph, structure, source, budget, saved_cost, cost_path, output_options);
+            for (std::size_t i = 0; i < graph.dangling.size() && i < 10; i++) {
+                const DanglingReference &reference = graph.dangling[i];
+                U::log_warn("Node %s of %s %d refers to joint %s, which doesn't exist.", reference.node_b ? "B" : "A",
+                            BRIDGE_MEMBER_NAMES[reference.member_type], reference.member_index, reference.guid.c_str());
+            }
+            if (graph.dangling.size() > 10) {
+                U::log_warn("... and %s more missing joint references, all listed in %s.",
+                            U::add_commas((int64_t)graph.dangling.size() - 10).c_str(), cost_path.c_str());
+            }
+        };
+        if (format.ends_with(".slot")) {
+            SlotDeserializer deserializer(source);
+            SaveSlot slot = deserializer.deserializeSlot();
+            report(slot.bridge, nullptr, &slot.budget);
+            summary = "saved as $" + U::add_commas(slot.budget);
+        } else {
+            Layout layout = load_layout(source);
+            report(layout.bridge, &layout.budget, nullptr);
+            summary = "budget $" + U::add_commas(layout.budget.cash);
+        }
+        Utils::log_info("Bridge costs $%s (%s)", U::add_commas((int64_t)std::llround(cost.total)).c_str(), summary.c_str());
+        if (structure.unanchored > 0) {
+            U::log_warn("%s of %s joints aren't connected to an anchor.", U::add_commas(structure.unanchored).c_str(),
+                        U::add_commas(structure.joints).c_str());
+        }
+        if (cost.unpriced > 0) {
+            U::log_warn("%s bungee rope or spring edges aren't in that cost, as they have no price; set one with --prices.",
+                        U::add_commas(cost.unpriced).c_str());
+        }
+        return 0;
+    }
+
+    if (argc - optind >= 2 && strcmp(argv[optind], "hash") == 0) {
+        for (int i = optind + 1; i < argc; i++) {
+            Arena::Scope arena;
+            unusualNumbers = 1;
+            Layout layout = load_layout(argv[i]);
+            printf("%s  %s\n", Hash::hex(layout.canonicalHash()).c_str(), argv[i]);
+        }
+        return 0;
+    }
+
+    if (argc - optind == 3 && (strcmp(argv[optind], "patch") == 0 || strcmp(argv[optind], "apply") == 0)) {
+        bool make_patch = strcmp(argv[optind], "patch") == 0;
+        std::string old_path = argv[optind + 1];
+        std::string other_path = argv[optind + 2];
+        uint64_t old_size, old_hash;
+        if (!LayoutPatch::fingerprint(old_path, old_size, old_hash)) {
+            U::log_error("Could not open %s", old_path.c_str());
+            return 1;
+        }
+        Arena::Scope arena;
+        Layout old = load_layout(old_path);
+
+        if (make_patch) {
+            Layout now = load_layout(other_path);
+            std::string patch = make_layout_patch(old, old_size, old_hash, now);
+            std::string patch_path = custom_path ? output_path : std::string(Compression::stripSuffix(other_path)) + ".patch";
+            Compression::OutputFile of(patch_path);
+            if (!of.is_open()) {
+                U::log_error("Could not open %s for writing", patch_path.c_str());
+                return 1;
+            }
+            of.write(patch.data(), (std::streamsize)patch.size());
+            of.close();
+            Utils::log_info("Wrote patch to %s (%s bytes)", patch_path.c_str(), U::add_commas((int)patch.size()).c_str());
+            return 0;
+        }
+
+        Compression::InputFile in(other_path);
+        if (!in.is_open()) {
+            U::log_error("Could not open %s", other_path.c_str());
+            return 1;
+        }
+        std::string patch((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        in.close();
+        Layout now = apply_layout_patch(old, old_size, old_hash, patch);
+        unusualNumbers = 1;  // the warnings reading old counted towards aborting
+
+        std::string layout_path = output_path;
+        if (!custom_path) {
+            layout_path = std::string(Compression::stripSuffix(other_path));
+            if (layout_path.ends_with(".patch")) layout_path.resize(layout_path.size() - 6);
+            if (!layout_path.ends_with(".layout")) layout_path += ".layout";
+        }
+        Serializer serializer(layout_path, now);
+        serializer.serializeLayout();
+        Utils::log_info("Layout serialized to " + layout_path);
+        return 0;
+    }
+
+    if (watch) {
+#ifdef __linux__
+        std::vector<std::string> watch_paths(argv + optind, argv + argc);
+        if (watch_paths.empty()) {
+            U::log_error("--watch needs at least one file or folder to watch.");
+            return 1;
+        }
+        if (custom_path && (watch_paths.size() > 1 || std::filesystem::is_directory(watch_paths[0]))) {
+            U::log_error("--output can only be used when watching a single file.");
+            return 1;
+        }
+        return watch_layouts(watch_paths, custom_path ? output_path : "");
+#else
+        U::log_error("--watch is only supported on Linux.");
+        return 1;
+#endif
+    }
+
+    if (metadata_only) {
+        // Slot listings only read the header entries, through a small read buffer, so indexing a folder touches a
+        // few hundred bytes per slot rather than whole files.
+        std::vector<std::string> slot_paths;
+        std::string listing_path;
+        std::error_code error;
+        if (std::filesystem::is_directory(path, error)) {
+            for (const auto &entry : std::filesystem::directory_iterator(path, error)) {
+                std::string file = entry.path().string();
+                if (entry.is_regular_file(error) && Compression::stripSuffix(file).ends_with(".slot")) {
+                    slot_paths.push_back(file);
+                }
+            }
+            std::sort(slot_paths.begin(), slot_paths.end());
+            listing_path = (std::filesystem::path(path) / "slots").string() + "." + document_extension(output_options.format);
+        } else if (Compression::stripSuffix(path).ends_with(".slot")) {
+            slot_paths.push_back(path);
+            listing_path = std::string(Compression::stripSuffix(path)) + "." + document_extension(output_options.format);
+        } else {
+            U::log_error("--metadata expects a .slot file or a folder containing them.");
+            return 1;
+        }
+        if (custom_path) listing_path = output_path;
+
+        Arena::Scope arena;
+        std::vector<SlotListing> listing;
+        listing.reserve(slot_paths.size());
+        for (const std::string &slot_path : slot_paths) {
+            SlotDeserializer deserializer(slot_path, 512);
+            listing.push_back(SlotListing{slot_path, deserializer.deserializeSlotHeader()});
+        }
+        dump_slot_listing(listing, listing_path, output_options);
+        Utils::log_info("Listed " + std::to_string(listing.size()) + " save slots in " + listing_path);
+        return 0;
+    }
+
     // first, check if the file is a json file
     std::ifstream ifs(path);
     if (!ifs.is_open()) {
@@ -3800,58 +9212,148 @@ int main(int argc, char **argv) {
 
     auto start = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch());
 
-    if (path.ends_with(".layout.json")) {
-        std::string json;
-        std::ifstream fs(path);
-        std::string line;
-        while (std::getline(fs, line)) {
-            json += line;
-        }
-        fs.close();
+    // A .gz or .zst suffix only says how the file is compressed, the format comes from what's in front of it.
+    // Default output paths keep the same compression.
+    std::string format(Compression::stripSuffix(path));
+    std::string codec_suffix = path.substr(format.size());
+
+    // Layouts and slots converted to documents can be served from the conversion cache. Anything with side effects
+    // beyond the document (columnar export, thumbnails) always goes through the deserializer.
+    std::unique_ptr<ConversionCache> cache;
+    std::string cache_key;
+    bool cacheable = (format.ends_with(".layout") && columnar_directory.empty()) || (format.ends_with(".slot") && thumbnail_path.empty());
+    if (!cache_directory.empty() && cacheable) {
+        std::string document_path = custom_path ? output_path : format + "." + document_extension(output_options.format) + codec_suffix;
+        std::string variant = std::string(format.ends_with(".slot") ? "slot" : "layout") +
+                ";" + document_extension(output_options.format) +
+                ";" + std::to_string(Compression::codecForPath(document_path)) +
+                ";" + std::to_string(output_options.precision) +
+                ";" + std::to_string(output_options.indent) +
+                ";" + output_options.fields.to_string();
+        cache = std::make_unique<ConversionCache>(cache_directory, cache_size * 1024 * 1024);
+        cache_key = cache->key(path, variant);
+        if (cache->fetch(cache_key, document_path)) {
+            Utils::log_info("Wrote cached document to " + document_path);
+            return 0;
+        }
+    }
+
+    if (format.ends_with(".layout.json") || format.ends_with(".layout.msgpack") || format.ends_with(".layout.cbor")) {
+        Arena::Scope arena;
+        Layout layout;
+        if (format.ends_with(".layout.json")) {
+            Compression::InputFile fs(path);
+            std::string json((std::istreambuf_iterator<char>(fs)), std::istreambuf_iterator<char>());
+            fs.close();
 
-        U::log_info("Parsing JSON file...");
-        Layout layout = load_json(json);
+            U::log_info("Parsing JSON file...");
+            layout = load_json(json);
+        } else {
+            U::log_info("Decoding document...");
+            json document = read_binary_document(path, format.ends_with(".msgpack") ? MSGPACK_DOCUMENT : CBOR_DOCUMENT);
+            layout = layout_from_json(document);
+        }
 
         if (custom_path) {
             path = output_path;
         } else {
-            path += ".layout";
+            path = format + ".layout" + codec_suffix;
         }
 
         Serializer serializer(path, layout);
         serializer.serializeLayout();
         Utils::log_info("Layout serialized to " + path);
-    } else if (path.ends_with(".layout")) {
+    } else if (format.ends_with(".layout") && !index_path.empty() && !output_options.fields.all()) {
+        // Projected conversion through the section index: only the requested sections are read at all
+        Arena::Scope arena;
+        LazyLayout lazy(path, index_path);
+        lazy.load(output_options.fields);
+
+        if (custom_path) {
+            path = output_path;
+        } else {
+            path = format + "." + document_extension(output_options.format) + codec_suffix;
+        }
+
+        dump_json(lazy.layout, path, output_options);
+        Utils::log_info("Wrote document to " + path);
+    } else if (format.ends_with(".layout")) {
+        Arena::Scope arena;
         Deserializer deserializer(path);
-        Layout layout = deserializer.deserializeLayout();
+        Layout layout = deserializer.deserializeLayout(output_options.fields);
+
+        if (!columnar_directory.empty()) {
+            ColumnarExport(columnar_directory).append(layout, path);
+            Utils::log_info("Appended columns to " + columnar_directory);
+        }
 
         if (custom_path) {
             path = output_path;
         } else {
-            path += ".json";
+            path = format + "." + document_extension(output_options.format) + codec_suffix;
         }
 
-        dump_json(layout, path);
-        Utils::log_info("Wrote JSON to " + path);
-    } else if (path.ends_with(".slot")) {
+        dump_json(layout, path, output_options);
+        Utils::log_info("Wrote document to " + path);
+    } else if (format.ends_with(".slot")) {
+        Arena::Scope arena;
         SlotDeserializer deserializer(path);
         SaveSlot slot = deserializer.deserializeSlot();
 
+        if (!thumbnail_path.empty()) {
+            const SlotThumbnail &thumbnail = slot.thumbnail;
+            if (thumbnail.size == 0) {
+                U::log_warn("Save slot has no thumbnail, nothing written to %s", thumbnail_path.c_str());
+            } else if (!Compression::copyRange(thumbnail.path, thumbnail.offset, thumbnail.size, thumbnail_path)) {
+                U::log_error("Failed to write thumbnail to %s", thumbnail_path.c_str());
+                return 1;
+            } else {
+                Utils::log_info("Wrote thumbnail to " + thumbnail_path);
+            }
+        }
+
+        if (custom_path) {
+            path = output_path;
+        } else {
+            path = format + "." + document_extension(output_options.format) + codec_suffix;
+        }
+
+        dump_slot_json(slot, path, output_options);
+        Utils::log_info("Wrote document to " + path);
+    } else if (format.ends_with(".slot.json") || format.ends_with(".slot.msgpack") || format.ends_with(".slot.cbor")) {
+        Arena::Scope arena;
+        json document;
+        if (format.ends_with(".slot.json")) {
+            Compression::InputFile fs(path);
+            std::string text((std::istreambuf_iterator<char>(fs)), std::istreambuf_iterator<char>());
+            fs.close();
+
+            U::log_info("Parsing JSON file...");
+            document = JsonReader(text).parse();
+        } else {
+            U::log_info("Decoding document...");
+            document = read_binary_document(path, format.ends_with(".msgpack") ? MSGPACK_DOCUMENT : CBOR_DOCUMENT);
+        }
+        SaveSlot slot = slot_from_json(document);
+
         if (custom_path) {
             path = output_path;
         } else {
-            path += ".json";
+            path = format + ".slot" + codec_suffix;
         }
 
-        dump_slot_json(slot, path);
-        Utils::log_info("Wrote JSON to " + path);
-    } else if (path.ends_with(".slot.json")) {
-        U::log_info_d("Slot JSON files are not yet supported.");
+        SlotSerializer serializer(path, slot);
+        serializer.serializeSlot();
+        Utils::log_info("Slot serialized to " + path);
     } else {
         U::log_error("File format not supported.");
         return 1;
     }
 
+    if (cache) {
+        cache->store(cache_key, path);
+    }
+
     std::cout << "\n";
 
     auto end = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch());